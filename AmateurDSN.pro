@@ -49,18 +49,35 @@ SOURCES += \
     DriftToolFactory.cpp \
     ExternalTool.cpp \
     ExternalToolFactory.cpp \
+    FileSink.cpp \
+    FileWriter.cpp \
+    ForwarderSink.cpp \
     ForwarderWidget.cpp \
+    HookExecutor.cpp \
+    NoiseWindowLocator.cpp \
+    PipeSink.cpp \
     PowerProcessor.cpp \
+    PSDProcessor.cpp \
     ProcessForwarder.cpp \
     Registration.cpp \
+    Resampler.cpp \
+    ReturnReader.cpp \
+    SampleConverter.cpp \
+    SampleWriter.cpp \
+    SegmentedLog.cpp \
+    SegmentedLogReader.cpp \
+    ShmRingSink.cpp \
+    SigMFSidecar.cpp \
+    SNRLogger.cpp \
     SNRTool.cpp \
-    SNRToolFactory.cpp
+    SNRToolFactory.cpp \
+    SocketSink.cpp
 
 
 INCLUDEPATH += $$SUWIDGETS_INSTALL_HEADERS $$SIGDIGGER_INSTALL_HEADERS
 
 unix: CONFIG += link_pkgconfig
-unix: PKGCONFIG += suscan sigutils fftw3 sndfile volk
+unix: PKGCONFIG += suscan sigutils fftw3 sndfile volk zlib
 
 darwin: QMAKE_LFLAGS += -undefined dynamic_lookup
 darwin: LIBS += -lsuwidgets
@@ -75,7 +92,9 @@ FORMS += \
   SNRTool.ui
 
 HEADERS += \
+  AmateurDSNFrame.h \
   AmateurDSNHelpers.h \
+  AmateurDSNRing.h \
   ChirpCorrector.h \
   DetachableProcess.h \
   DopplerTool.h \
@@ -85,8 +104,25 @@ HEADERS += \
   DriftToolFactory.h \
   ExternalTool.h \
   ExternalToolFactory.h \
+  FileSink.h \
+  FileWriter.h \
+  ForwarderSink.h \
   ForwarderWidget.h \
+  HookExecutor.h \
+  NoiseWindowLocator.h \
+  PipeSink.h \
   PowerProcessor.h \
+  PSDProcessor.h \
   ProcessForwarder.h \
+  Resampler.h \
+  ReturnReader.h \
+  SampleConverter.h \
+  SampleWriter.h \
+  SegmentedLog.h \
+  SegmentedLogReader.h \
+  ShmRingSink.h \
+  SigMFSidecar.h \
+  SNRLogger.h \
   SNRTool.h \
-  SNRToolFactory.h
+  SNRToolFactory.h \
+  SocketSink.h
@@ -0,0 +1,124 @@
+/*
+ *    AmateurDSNFrame.h: Framing of forwarded sample streams
+ *    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with this program.  If not, see
+ *    <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * When framing is enabled, every packet sent by an AmateurDSN forwarder
+ * starts with this header, in native byte order, followed by
+ * payload_size bytes of samples. Over UDP, every datagram is exactly one
+ * packet. Over stream sockets, packets follow each other.
+ *
+ * Sequence numbers increase by one per packet, including packets the
+ * forwarder had to drop, so a gap means data was lost on the way.
+ * Readers must skip header_size bytes to reach the payload: later
+ * versions may append fields.
+ *
+ * If ADSN_FRAME_FLAG_METADATA is set, an adsn_frame_metadata follows the
+ * header, describing the first sample of the payload. Sample offsets
+ * count every sample the channel produced since the stream started,
+ * dropped ones included, so they can be used to place the payload in
+ * time even across losses.
+ */
+
+#ifndef AMATEURDSNFRAME_H
+#define AMATEURDSNFRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ADSN_FRAME_MAGIC   0x46534441u /* "ADSF" */
+#define ADSN_FRAME_VERSION 1
+
+#define ADSN_FRAME_FLAG_METADATA      1 /* adsn_frame_metadata follows */
+#define ADSN_FRAME_FLAG_RETUNE        2 /* Frequency changed since last packet */
+#define ADSN_FRAME_FLAG_DISCONTINUITY 4 /* Samples were dropped before this one */
+
+/* Values of adsn_frame_metadata.format */
+#define ADSN_FRAME_FORMAT_CF32 0
+#define ADSN_FRAME_FORMAT_CF64 1
+#define ADSN_FRAME_FORMAT_CS16 2
+#define ADSN_FRAME_FORMAT_CS8  3
+
+struct adsn_frame_header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;  /* Bytes from the start of the packet to the payload */
+  uint32_t sequence;
+  uint32_t payload_size; /* Bytes */
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+struct adsn_frame_metadata {
+  double   timestamp;     /* Source time of the first sample, Unix seconds */
+  double   frequency;     /* Center frequency of the channel, Hz */
+  double   sample_rate;   /* Of the payload, samples per second */
+  uint64_t sample_offset; /* Stream index of the first sample */
+  uint64_t dropped;       /* Samples dropped since the stream started */
+  uint32_t sample_size;   /* Bytes per sample */
+  uint32_t format;        /* ADSN_FRAME_FORMAT_* */
+};
+
+/*
+ * Validates the header at the start of buf. Returns the header size if
+ * it looks right, or 0 otherwise.
+ */
+static inline size_t
+adsn_frame_check(const void *buf, size_t len, struct adsn_frame_header *hdr)
+{
+  if (len < sizeof(struct adsn_frame_header))
+    return 0;
+
+  memcpy(hdr, buf, sizeof(struct adsn_frame_header));
+
+  if (hdr->magic != ADSN_FRAME_MAGIC
+      || hdr->header_size < sizeof(struct adsn_frame_header))
+    return 0;
+
+  return hdr->header_size;
+}
+
+/* Copies the metadata of a packet, if it has any. Returns 0 if not. */
+static inline int
+adsn_frame_get_metadata(
+    const void *buf,
+    const struct adsn_frame_header *hdr,
+    struct adsn_frame_metadata *meta)
+{
+  if (!(hdr->flags & ADSN_FRAME_FLAG_METADATA)
+      || hdr->header_size < sizeof(struct adsn_frame_header)
+                            + sizeof(struct adsn_frame_metadata))
+    return 0;
+
+  memcpy(
+        meta,
+        (const uint8_t *) buf + sizeof(struct adsn_frame_header),
+        sizeof(struct adsn_frame_metadata));
+
+  return 1;
+}
+
+/* Packets lost between two consecutive headers */
+static inline uint32_t
+adsn_frame_lost(uint32_t prev_seq, uint32_t seq)
+{
+  return seq - prev_seq - 1;
+}
+
+#endif /* AMATEURDSNFRAME_H */
@@ -20,6 +20,12 @@
 #include "AmateurDSNHelpers.h"
 #include <QLabel>
 #include <QFont>
+#include <sigutils/types.h>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <clocale>
 
 using namespace SigDigger;
 
@@ -31,3 +37,392 @@ SigDigger::setLabelTextElided(QLabel *label, QString const &text)
   QString clippedText = metrics.elidedText(text, Qt::ElideRight, width);
   label->setText(clippedText);
 }
+
+void
+SigDigger::setLabelText(QLabel *label, const char *text, size_t len)
+{
+  label->setText(QString::fromUtf8(text, SCAST(int, len)));
+}
+
+///////////////////////////// Number formatting ////////////////////////////////
+static const double g_pow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const uint64_t g_ipow10[] = {
+  1ull,
+  10ull,
+  100ull,
+  1000ull,
+  10000ull,
+  100000ull,
+  1000000ull,
+  10000000ull,
+  100000000ull,
+  1000000000ull,
+  10000000000ull,
+  100000000000ull,
+  1000000000000ull,
+  10000000000000ull,
+  100000000000000ull,
+  1000000000000000ull,
+  10000000000000000ull,
+  100000000000000000ull,
+  1000000000000000000ull
+};
+
+// Beyond 15 significant digits the scaled value is no longer exact and we
+// would disagree with printf, which expands the full binary value.
+#define ADSN_MAX_FAST_DECIMALS 15
+#define ADSN_MAX_FAST_SCALED   1e15
+
+// Multiplying or dividing by an exact power of 10 rounds once. When the
+// result lands too close to a rounding boundary, that error may flip the
+// last digit, and we let printf decide.
+static inline bool
+isAmbiguous(double scaled)
+{
+  double frac = scaled - floor(scaled);
+
+  return fabs(frac - .5) <= scaled * 4.5e-16;
+}
+
+// Copies len bytes of src into buf, right-justified to width
+static size_t
+copyOut(char *buf, size_t size, const char *src, size_t len, unsigned width)
+{
+  size_t pad = width > len ? width - len : 0;
+  size_t i = 0, j;
+
+  if (size == 0)
+    return 0;
+
+  while (i < pad && i + 1 < size)
+    buf[i++] = ' ';
+
+  for (j = 0; j < len && i + 1 < size; ++j)
+    buf[i++] = src[j];
+
+  buf[i] = '\0';
+
+  return i;
+}
+
+// Writes the decimal digits of n right before end. Returns the first digit.
+static char *
+writeDigits(char *end, uint64_t n, unsigned minDigits)
+{
+  unsigned count = 0;
+
+  do {
+    *--end = SCAST(char, '0' + n % 10);
+    n /= 10;
+    ++count;
+  } while (n != 0 || count < minDigits);
+
+  return end;
+}
+
+// snprintf honors LC_NUMERIC, which we undo here
+static void
+fixDecimalPoint(char *buf, size_t len)
+{
+  const char *point = localeconv()->decimal_point;
+  size_t i;
+
+  if (point != nullptr && point[0] != '.' && point[0] != '\0')
+    for (i = 0; i < len; ++i)
+      if (buf[i] == point[0])
+        buf[i] = '.';
+}
+
+// Slow path for values the integer path cannot handle. snprintf does not
+// allocate for these formats.
+static size_t
+fallbackFormat(char *buf, size_t size, const char *fmt, ...)
+{
+  va_list ap;
+  int ret;
+  size_t len;
+
+  if (size == 0)
+    return 0;
+
+  va_start(ap, fmt);
+  ret = vsnprintf(buf, size, fmt, ap);
+  va_end(ap);
+
+  if (ret < 0) {
+    *buf = '\0';
+    return 0;
+  }
+
+  len = SCAST(size_t, ret) < size ? SCAST(size_t, ret) : size - 1;
+  fixDecimalPoint(buf, len);
+
+  return len;
+}
+
+size_t
+SigDigger::formatFixed(
+    char *buf,
+    size_t size,
+    double value,
+    unsigned decimals,
+    bool sign,
+    unsigned width)
+{
+  char tmp[48];
+  char *end = tmp + sizeof(tmp);
+  char *p;
+  double mag = fabs(value);
+  uint64_t scaled;
+
+  if (!std::isfinite(value)
+      || decimals > ADSN_MAX_FAST_DECIMALS
+      || mag * g_pow10[decimals] >= ADSN_MAX_FAST_SCALED)
+    return fallbackFormat(
+          buf,
+          size,
+          sign ? "%+*.*f" : "%*.*f",
+          SCAST(int, width),
+          SCAST(int, decimals),
+          value);
+
+  if (isAmbiguous(mag * g_pow10[decimals]))
+    return fallbackFormat(
+          buf,
+          size,
+          sign ? "%+*.*f" : "%*.*f",
+          SCAST(int, width),
+          SCAST(int, decimals),
+          value);
+
+  scaled = SCAST(uint64_t, mag * g_pow10[decimals] + .5);
+  p      = end;
+
+  if (decimals > 0) {
+    p    = writeDigits(p, scaled % g_ipow10[decimals], decimals);
+    *--p = '.';
+  }
+
+  p = writeDigits(p, scaled / g_ipow10[decimals], 1);
+
+  if (std::signbit(value))
+    *--p = '-';
+  else if (sign)
+    *--p = '+';
+
+  return copyOut(buf, size, p, SCAST(size_t, end - p), width);
+}
+
+size_t
+SigDigger::formatExponential(
+    char *buf,
+    size_t size,
+    double value,
+    unsigned decimals)
+{
+  char tmp[48];
+  char *end = tmp + sizeof(tmp);
+  char *p;
+  double mag = fabs(value);
+  double scaled;
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int k;
+
+  if (!std::isfinite(value) || decimals > ADSN_MAX_FAST_DECIMALS - 1)
+    return fallbackFormat(buf, size, "%.*e", SCAST(int, decimals), value);
+
+  if (mag > 0) {
+    exponent = SCAST(int, floor(log10(mag)));
+
+    for (;;) {
+      // We want mag * 10^k to have exactly decimals + 1 integer digits
+      k = SCAST(int, decimals) - exponent;
+
+      if (k > 22 || k < -22)
+        return fallbackFormat(buf, size, "%.*e", SCAST(int, decimals), value);
+
+      scaled   = k >= 0 ? mag * g_pow10[k] : mag / g_pow10[-k];
+
+      if (isAmbiguous(scaled))
+        return fallbackFormat(buf, size, "%.*e", SCAST(int, decimals), value);
+
+      mantissa = SCAST(uint64_t, scaled + .5);
+
+      // log10 may be off by one near powers of 10
+      if (mantissa < g_ipow10[decimals]) {
+        --exponent;
+      } else {
+        if (mantissa >= g_ipow10[decimals + 1]) {
+          mantissa /= 10;
+          ++exponent;
+        }
+        break;
+      }
+    }
+  }
+
+  p = writeDigits(end, SCAST(uint64_t, exponent < 0 ? -exponent : exponent), 2);
+  *--p = exponent < 0 ? '-' : '+';
+  *--p = 'e';
+
+  if (decimals > 0) {
+    p    = writeDigits(p, mantissa % g_ipow10[decimals], decimals);
+    *--p = '.';
+  }
+
+  p = writeDigits(p, mantissa / g_ipow10[decimals], 1);
+
+  if (std::signbit(value))
+    *--p = '-';
+
+  return copyOut(buf, size, p, SCAST(size_t, end - p), 0);
+}
+
+size_t
+SigDigger::formatInteger(char *buf, size_t size, int64_t value, unsigned width)
+{
+  char tmp[32];
+  char *end = tmp + sizeof(tmp);
+  char *p;
+  uint64_t mag = value < 0
+      ? SCAST(uint64_t, -(value + 1)) + 1
+      : SCAST(uint64_t, value);
+
+  p = writeDigits(end, mag, width);
+
+  if (value < 0)
+    *--p = '-';
+
+  return copyOut(buf, size, p, SCAST(size_t, end - p), 0);
+}
+
+size_t
+SigDigger::formatQuantity(
+    char *buf,
+    size_t size,
+    double value,
+    unsigned digits,
+    const char *units,
+    bool sign)
+{
+  static const char *multipliers[] = {
+    "p", "n", "\xc2\xb5", "m", "", "k", "M", "G", "T"
+  };
+  double mag = fabs(value);
+  unsigned intDigits, decimals;
+  size_t len;
+  int i = 4;
+
+  if (size == 0)
+    return 0;
+
+  if (std::isfinite(mag) && mag > 0) {
+    while (mag >= 1e3 && i < 8) {
+      mag *= 1e-3;
+      ++i;
+    }
+
+    while (mag < 1 && i > 0) {
+      mag *= 1e3;
+      --i;
+    }
+  }
+
+  if (digits == 0)
+    digits = 1;
+
+  intDigits = mag >= 100 ? 3 : mag >= 10 ? 2 : 1;
+  decimals  = digits > intDigits ? digits - intDigits : 0;
+
+  // Rounding may take us to the next prefix (999.99 -> 1000)
+  if (i < 8 && std::isfinite(mag)
+      && floor(mag * g_pow10[decimals] + .5) >= 1e3 * g_pow10[decimals]) {
+    mag *= 1e-3;
+    ++i;
+    intDigits = 1;
+    decimals  = digits > intDigits ? digits - intDigits : 0;
+  }
+
+  len = formatFixed(
+        buf,
+        size,
+        std::signbit(value) ? -mag : mag,
+        decimals,
+        sign);
+
+  // Drop trailing zeros, as %g would do
+  if (decimals > 0 && std::isfinite(mag)) {
+    while (len > 0 && buf[len - 1] == '0')
+      --len;
+    if (len > 0 && buf[len - 1] == '.')
+      --len;
+    buf[len] = '\0';
+  }
+
+  len += copyOut(buf + len, size - len, " ", 1, 0);
+  len += copyOut(buf + len, size - len, multipliers[i], strlen(multipliers[i]), 0);
+  len += copyOut(buf + len, size - len, units, strlen(units), 0);
+
+  return len;
+}
+
+double
+SigDigger::normalQuantile(double p)
+{
+  static const double a[] = {
+    -3.969683028665376e+01, +2.209460984245205e+02, -2.759285104469687e+02,
+    +1.383577518672690e+02, -3.066479806614716e+01, +2.506628277459239e+00};
+  static const double b[] = {
+    -5.447609879822406e+01, +1.615858368580409e+02, -1.556989798598866e+02,
+    +6.680131188771972e+01, -1.328068155288572e+01};
+  static const double c[] = {
+    -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+    -2.549732539343734e+00, +4.374664141464968e+00, +2.938163982698783e+00};
+  static const double d[] = {
+    +7.784695709041462e-03, +3.224671290700398e-01, +2.445134137142996e+00,
+    +3.754408661907416e+00};
+  double q, r;
+
+  if (p <= 0)
+    return -INFINITY;
+
+  if (p >= 1)
+    return +INFINITY;
+
+  if (p < .02425) {
+    q = sqrt(-2 * log(p));
+    return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+        / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+  }
+
+  if (p > 1 - .02425) {
+    q = sqrt(-2 * log(1 - p));
+    return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+        / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+  }
+
+  q = p - .5;
+  r = q * q;
+
+  return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+      / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+double
+SigDigger::chiSquaredQuantile(double p, double nu)
+{
+  double h, x;
+
+  if (nu <= 0)
+    return NAN;
+
+  h = 2. / (9. * nu);
+  x = 1 - h + normalQuantile(p) * sqrt(h);
+
+  return x > 0 ? nu * x * x * x : 0;
+}
@@ -19,6 +19,9 @@
 #ifndef AMATEURDSNHELPERS_H
 #define AMATEURDSNHELPERS_H
 
+#include <cstddef>
+#include <cstdint>
+
 #define ADSN_SPEED_OF_LIGHT 299792458. // [m/s]
 
 class QLabel;
@@ -56,6 +59,151 @@ namespace SigDigger{
   }
 
   void setLabelTextElided(QLabel *, QString const &);
+
+  //
+  // Approximate quantiles used to build confidence intervals. The normal
+  // quantile is accurate to ~1e-9 (Acklam), the chi-squared one uses the
+  // Wilson-Hilferty transform and is good to a few percent for nu > 2.
+  //
+  double normalQuantile(double p);
+  double chiSquaredQuantile(double p, double nu);
+
+  //
+  // Allocation-free number formatting. All these functions write into a
+  // caller-owned buffer of the given size, NUL-terminate it and return the
+  // number of characters written (excluding the terminator). Output that
+  // does not fit is truncated. The decimal separator is always '.',
+  // regardless of the current locale.
+  //
+
+  // Like %<width>.<decimals>f (or %+<width>.<decimals>f if sign is set)
+  size_t formatFixed(
+      char *buf,
+      size_t size,
+      double value,
+      unsigned decimals,
+      bool sign = false,
+      unsigned width = 0);
+
+  // Like %.<decimals>e
+  size_t formatExponential(
+      char *buf,
+      size_t size,
+      double value,
+      unsigned decimals);
+
+  // Like %0<width>lld
+  size_t formatInteger(
+      char *buf,
+      size_t size,
+      int64_t value,
+      unsigned width = 0);
+
+  // SI-prefixed quantity with the given significant digits (e.g. 1.234 kHz)
+  size_t formatQuantity(
+      char *buf,
+      size_t size,
+      double value,
+      unsigned digits,
+      const char *units,
+      bool sign = false);
+
+  //
+  // Small stack buffer to compose text lines out of the functions above
+  // without touching the heap.
+  //
+  template <size_t N>
+  class FormatBuffer {
+    char   m_buf[N];
+    size_t m_len = 0;
+
+  public:
+    FormatBuffer()
+    {
+      m_buf[0] = '\0';
+    }
+
+    FormatBuffer &
+    clear()
+    {
+      m_len    = 0;
+      m_buf[0] = '\0';
+
+      return *this;
+    }
+
+    const char *
+    data() const
+    {
+      return m_buf;
+    }
+
+    size_t
+    size() const
+    {
+      return m_len;
+    }
+
+    FormatBuffer &
+    put(char c)
+    {
+      if (m_len + 1 < N) {
+        m_buf[m_len++] = c;
+        m_buf[m_len]   = '\0';
+      }
+
+      return *this;
+    }
+
+    FormatBuffer &
+    put(const char *str)
+    {
+      while (*str != '\0' && m_len + 1 < N)
+        m_buf[m_len++] = *str++;
+
+      m_buf[m_len] = '\0';
+
+      return *this;
+    }
+
+    FormatBuffer &
+    fixed(double value, unsigned decimals, bool sign = false, unsigned width = 0)
+    {
+      m_len += formatFixed(m_buf + m_len, N - m_len, value, decimals, sign, width);
+      return *this;
+    }
+
+    FormatBuffer &
+    exponential(double value, unsigned decimals)
+    {
+      m_len += formatExponential(m_buf + m_len, N - m_len, value, decimals);
+      return *this;
+    }
+
+    FormatBuffer &
+    integer(int64_t value, unsigned width = 0)
+    {
+      m_len += formatInteger(m_buf + m_len, N - m_len, value, width);
+      return *this;
+    }
+
+    FormatBuffer &
+    quantity(double value, unsigned digits, const char *units, bool sign = false)
+    {
+      m_len += formatQuantity(m_buf + m_len, N - m_len, value, digits, units, sign);
+      return *this;
+    }
+  };
+
+  // Sets the text of a label from a UTF-8 buffer
+  void setLabelText(QLabel *, const char *, size_t);
+
+  template <size_t N>
+  static inline void
+  setLabelText(QLabel *label, FormatBuffer<N> const &buf)
+  {
+    setLabelText(label, buf.data(), buf.size());
+  }
 }
 
 #endif // AMATEURDSNHELPERS_H
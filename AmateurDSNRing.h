@@ -0,0 +1,274 @@
+/*
+ *    AmateurDSNRing.h: Shared-memory sample ring, reader side
+ *    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with this program.  If not, see
+ *    <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Header-only C library to consume the sample rings exported by the
+ * AmateurDSN forwarders (Linux only). Copy it next to your program.
+ *
+ * The ring lives in a memfd: a one-page header followed by the data area.
+ * The data area is mapped twice back to back, so any span of up to
+ * `capacity` bytes starting anywhere in the ring is contiguous in memory
+ * and can be used in place.
+ *
+ * There is exactly one producer and one consumer. The producer never
+ * overwrites unread data: if the consumer falls behind, new blocks are
+ * dropped and accounted in `dropped`.
+ *
+ * Programs launched by the forwarder inherit the memfd and an eventfd,
+ * whose numbers are passed in %SHMFD% and %EVENTFD%. Other local programs
+ * can open the ring through %SHMPATH% (/proc/<pid>/fd/<n>) and must pass
+ * -1 as eventfd, in which case adsn_ring_wait() polls.
+ *
+ *   struct adsn_ring ring;
+ *   const void *data;
+ *   size_t len;
+ *
+ *   if (adsn_ring_open(&ring, shmfd, evfd) < 0)
+ *     fail();
+ *
+ *   while (adsn_ring_wait(&ring, 1000) >= 0) {
+ *     while ((len = adsn_ring_peek(&ring, &data)) > 0) {
+ *       consume(data, len);
+ *       adsn_ring_advance(&ring, len);
+ *     }
+ *   }
+ *
+ *   adsn_ring_close(&ring);
+ */
+
+#ifndef AMATEURDSNRING_H
+#define AMATEURDSNRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+
+#define ADSN_RING_MAGIC       0x52534441u /* "ADSR" */
+#define ADSN_RING_VERSION     1
+#define ADSN_RING_HEADER_SIZE 4096
+
+#define ADSN_RING_FLAG_EOS    1 /* The producer is gone */
+
+struct adsn_ring_header {
+  /* Written once by the producer */
+  uint32_t magic;
+  uint32_t version;
+  uint64_t data_offset;    /* Bytes from the start of the memfd */
+  uint64_t capacity;       /* Bytes, multiple of the page size */
+  uint32_t sample_size;    /* Bytes per sample */
+  uint32_t reserved0;
+  double   sample_rate;
+  uint8_t  pad0[24];
+
+  /* Producer cache line */
+  uint64_t write_pos;      /* Total bytes ever written */
+  uint64_t dropped;        /* Total bytes dropped */
+  uint32_t flags;
+  uint32_t reserved1;
+  uint8_t  pad1[40];
+
+  /* Consumer cache line */
+  uint64_t read_pos;       /* Total bytes ever consumed */
+  uint32_t reader_waiting; /* Set before sleeping on the eventfd */
+  uint32_t reserved2;
+  uint8_t  pad2[48];
+};
+
+struct adsn_ring {
+  struct adsn_ring_header *hdr;
+  uint8_t *data;
+  void    *base;
+  size_t   map_size;
+  int      evfd;
+};
+
+/*
+ * Maps a ring (header + mirrored data area) from its memfd. Used by both
+ * ends. If `capacity` is 0, it is read from the header.
+ */
+static inline int
+adsn_ring_map(struct adsn_ring *ring, int fd, uint64_t offset, uint64_t capacity)
+{
+  struct adsn_ring_header hdr;
+  uint8_t *base;
+
+  memset(ring, 0, sizeof(struct adsn_ring));
+  ring->evfd = -1;
+
+  if (capacity == 0) {
+    if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr))
+      return -1;
+
+    if (hdr.magic != ADSN_RING_MAGIC || hdr.version != ADSN_RING_VERSION)
+      return -1;
+
+    offset   = hdr.data_offset;
+    capacity = hdr.capacity;
+  }
+
+  ring->map_size = offset + 2 * capacity;
+
+  /* Reserve the address range, then map the pieces over it */
+  base = (uint8_t *) mmap(
+        NULL,
+        ring->map_size,
+        PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+  if (base == MAP_FAILED)
+    return -1;
+
+  if (mmap(base, offset, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)
+        == MAP_FAILED
+      || mmap(
+        base + offset,
+        capacity,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_FIXED,
+        fd,
+        (off_t) offset) == MAP_FAILED
+      || mmap(
+        base + offset + capacity,
+        capacity,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_FIXED,
+        fd,
+        (off_t) offset) == MAP_FAILED) {
+    munmap(base, ring->map_size);
+    return -1;
+  }
+
+  ring->base = base;
+  ring->hdr  = (struct adsn_ring_header *) base;
+  ring->data = base + offset;
+
+  return 0;
+}
+
+static inline void
+adsn_ring_unmap(struct adsn_ring *ring)
+{
+  if (ring->base != NULL)
+    munmap(ring->base, ring->map_size);
+
+  ring->base = NULL;
+  ring->hdr  = NULL;
+  ring->data = NULL;
+}
+
+/* Consumer side */
+static inline int
+adsn_ring_open(struct adsn_ring *ring, int shmfd, int evfd)
+{
+  if (adsn_ring_map(ring, shmfd, 0, 0) < 0)
+    return -1;
+
+  ring->evfd = evfd;
+
+  return 0;
+}
+
+static inline void
+adsn_ring_close(struct adsn_ring *ring)
+{
+  adsn_ring_unmap(ring);
+}
+
+/* Returns the number of contiguous readable bytes, starting at *data */
+static inline size_t
+adsn_ring_peek(struct adsn_ring *ring, const void **data)
+{
+  uint64_t w = __atomic_load_n(&ring->hdr->write_pos, __ATOMIC_ACQUIRE);
+  uint64_t r = ring->hdr->read_pos;
+
+  *data = ring->data + (r % ring->hdr->capacity);
+
+  return (size_t) (w - r);
+}
+
+static inline void
+adsn_ring_advance(struct adsn_ring *ring, size_t len)
+{
+  __atomic_store_n(
+        &ring->hdr->read_pos,
+        ring->hdr->read_pos + len,
+        __ATOMIC_SEQ_CST);
+}
+
+static inline int
+adsn_ring_eos(const struct adsn_ring *ring)
+{
+  return (__atomic_load_n(&ring->hdr->flags, __ATOMIC_ACQUIRE)
+          & ADSN_RING_FLAG_EOS) != 0;
+}
+
+/*
+ * Waits until there is data to read. Returns 1 if there is data, 0 on
+ * timeout and -1 if the producer is gone and the ring is empty.
+ */
+static inline int
+adsn_ring_wait(struct adsn_ring *ring, int timeout_ms)
+{
+  const void *data;
+  struct pollfd pfd;
+  uint64_t count;
+  int elapsed = 0;
+
+  for (;;) {
+    if (adsn_ring_peek(ring, &data) > 0)
+      return 1;
+
+    if (adsn_ring_eos(ring))
+      return -1;
+
+    if (ring->evfd < 0) {
+      if (timeout_ms >= 0 && elapsed >= timeout_ms)
+        return 0;
+      poll(NULL, 0, 1);
+      ++elapsed;
+      continue;
+    }
+
+    __atomic_store_n(&ring->hdr->reader_waiting, 1, __ATOMIC_SEQ_CST);
+
+    /* The producer may have written right before we raised the flag */
+    if (adsn_ring_peek(ring, &data) > 0 || adsn_ring_eos(ring)) {
+      __atomic_store_n(&ring->hdr->reader_waiting, 0, __ATOMIC_SEQ_CST);
+      continue;
+    }
+
+    pfd.fd     = ring->evfd;
+    pfd.events = POLLIN;
+
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+      __atomic_store_n(&ring->hdr->reader_waiting, 0, __ATOMIC_SEQ_CST);
+      return adsn_ring_peek(ring, &data) > 0 ? 1 : 0;
+    }
+
+    if (read(ring->evfd, &count, sizeof(count)) < 0) {
+      /* Spurious, try again */
+    }
+  }
+}
+
+#endif /* AMATEURDSNRING_H */
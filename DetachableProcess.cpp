@@ -17,13 +17,16 @@
 //    <http://www.gnu.org/licenses/>
 //
 #include "DetachableProcess.h"
+#include <unistd.h>
 
 using namespace SigDigger;
 
 //////////////////////////////// Detachable process ////////////////////////////
 DetachableProcess::DetachableProcess(QObject *parent) : QProcess(parent)
 {
-
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+  setChildProcessModifier([this] () { redirectStandardChannels(); });
+#endif
 }
 
 DetachableProcess::~DetachableProcess()
@@ -31,6 +34,37 @@ DetachableProcess::~DetachableProcess()
 
 }
 
+// Runs in the child, between fork() and exec()
+void
+DetachableProcess::redirectStandardChannels()
+{
+  if (m_stdinFd != -1)
+    dup2(m_stdinFd, STDIN_FILENO);
+
+  if (m_stdoutFd != -1)
+    dup2(m_stdoutFd, STDOUT_FILENO);
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+void
+DetachableProcess::setupChildProcess()
+{
+  redirectStandardChannels();
+}
+#endif
+
+void
+DetachableProcess::setStandardInputFd(int fd)
+{
+  m_stdinFd = fd;
+}
+
+void
+DetachableProcess::setStandardOutputFd(int fd)
+{
+  m_stdoutFd = fd;
+}
+
 void
 DetachableProcess::detach()
 {
@@ -26,10 +26,27 @@ namespace SigDigger {
   {
     Q_OBJECT
 
+    int m_stdinFd  = -1;
+    int m_stdoutFd = -1;
+
+    void redirectStandardChannels();
+
+  protected:
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    void setupChildProcess() override;
+#endif
+
   public:
     DetachableProcess(QObject *parent = nullptr);
     ~DetachableProcess() override;
 
+    // The child gets this descriptor as standard input, -1 to let
+    // QProcess manage it. It must remain open until start() returns.
+    void setStandardInputFd(int);
+
+    // Same, for the standard output of the child
+    void setStandardOutputFd(int);
+
     void detach();
   };
 };
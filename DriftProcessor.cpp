@@ -278,6 +278,15 @@ DriftProcessor::getTrueFeedbackInterval() const
   return m_trueFeedback;
 }
 
+qreal
+DriftProcessor::getTrueStabilization() const
+{
+  if (m_state == DRIFT_PROCESSOR_STREAMING)
+    return m_trueStabilization;
+  else
+    return 0;
+}
+
 qreal
 DriftProcessor::getTrueCutOff() const
 {
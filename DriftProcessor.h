@@ -127,6 +127,7 @@ namespace SigDigger {
     qreal    getTrueBandwidth() const;
     qreal    getTrueCutOff() const;
     qreal    getTrueFeedbackInterval() const;
+    qreal    getTrueStabilization() const;
     qreal    getTrueThreshold() const;
 
     struct timeval getLastLock() const;
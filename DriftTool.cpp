@@ -23,7 +23,6 @@
 #include <QFileDialog>
 #include <QDir>
 #include <GlobalProperty.h>
-#include <QTextStream>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #  include <QRegularExpression>
@@ -35,7 +34,7 @@
 #include "DriftTool.h"
 #include "DriftProcessor.h"
 #include "AmateurDSNHelpers.h"
-#include "DetachableProcess.h"
+#include "HookExecutor.h"
 
 #include "ui_DriftTool.h"
 
@@ -43,6 +42,16 @@
 #define STORE(field) obj.set(STRINGFY(field), this->field)
 #define LOAD(field) this->field = conf.get(STRINGFY(field), this->field)
 
+#define DRIFTTOOL_LOG_INDEX_INTERVAL 256
+
+// Predictive steps smaller than this fraction of the bandwidth are skipped
+#define DRIFTTOOL_MIN_TRACK_STEP     5e-3
+
+// Closed-loop Doppler correction: largest shift step (fraction of the
+// bandwidth) and hold-off between updates (in stabilization times)
+#define DRIFTTOOL_LOOP_MAX_STEP      .25
+#define DRIFTTOOL_LOOP_SETTLE        3
+
 using namespace SigDigger;
 
 bool DriftTool::g_propsCreated = false;
@@ -56,11 +65,23 @@ DriftToolConfig::deserialize(Suscan::Object const &conf)
   LOAD(lockThres);
   LOAD(retune);
   LOAD(retuneTrigger);
+  LOAD(predictiveTrack);
+  LOAD(trackInterval);
+  LOAD(closedLoop);
+  LOAD(loopShiftGain);
+  LOAD(loopRateGain);
+  LOAD(loopMaxShift);
+  LOAD(loopMaxRate);
   LOAD(logToDir);
   LOAD(logDirPath);
+  LOAD(logRotateSize);
+  LOAD(logRotateHourly);
+  LOAD(logCompress);
   LOAD(runOnLock);
   LOAD(programPath);
   LOAD(programArgs);
+  LOAD(hookDebounce);
+  LOAD(hookInterval);
 }
 
 Suscan::Object &&
@@ -75,11 +96,23 @@ DriftToolConfig::serialize()
   STORE(lockThres);
   STORE(retune);
   STORE(retuneTrigger);
+  STORE(predictiveTrack);
+  STORE(trackInterval);
+  STORE(closedLoop);
+  STORE(loopShiftGain);
+  STORE(loopRateGain);
+  STORE(loopMaxShift);
+  STORE(loopMaxRate);
   STORE(logToDir);
   STORE(logDirPath);
+  STORE(logRotateSize);
+  STORE(logRotateHourly);
+  STORE(logCompress);
   STORE(runOnLock);
   STORE(programPath);
   STORE(programArgs);
+  STORE(hookDebounce);
+  STORE(hookInterval);
 
   return persist(obj);
 }
@@ -97,6 +130,7 @@ DriftTool::DriftTool(
   assertConfig();
 
   m_processor = new DriftProcessor(mediator, this);
+  m_lockHook  = new HookExecutor(this);
   m_mediator  = mediator;
   m_spectrum  = mediator->getMainSpectrum();
 
@@ -156,6 +190,7 @@ DriftTool::DriftTool(
 
 DriftTool::~DriftTool()
 {
+  m_lockHook->stop();
   delete ui;
 }
 
@@ -234,6 +269,42 @@ DriftTool::connectAll()
         this,
         SLOT(onConfigChanged()));
 
+  connect(
+        ui->closedLoopCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onToggleClosedLoop()));
+
+  connect(
+        ui->predictiveCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->trackIntervalSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->rotateSizeSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->rotateHourlyCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->compressCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
 
   connect(
         ui->runCommandGroup,
@@ -418,6 +489,10 @@ DriftTool::refreshUi()
   ui->pllBwSpin->setEnabled(canAdjust);
 
   ui->retuneTriggerSpin->setEnabled(ui->retuneCheck->isChecked());
+  ui->predictiveCheck->setEnabled(ui->retuneCheck->isChecked());
+  ui->trackIntervalSpin->setEnabled(
+        ui->closedLoopCheck->isChecked()
+        || (ui->retuneCheck->isChecked() && ui->predictiveCheck->isChecked()));
   ui->runningLed->setOn(running);
   ui->lockLed->setOn(m_processor->hasLock());
   ui->stableLed->setOn(m_processor->isStable());
@@ -434,6 +509,9 @@ DriftTool::refreshUi()
   ui->logDirEdit->setEnabled(saveLogs);
   ui->stationIdEdit->setEnabled((ui->formatCombo->currentIndex() == 1) && saveLogs);
   ui->formatCombo->setEnabled(saveLogs);
+  ui->rotateSizeSpin->setEnabled(saveLogs);
+  ui->rotateHourlyCheck->setEnabled(saveLogs);
+  ui->compressCheck->setEnabled(saveLogs);
 }
 
 // Configuration methods
@@ -485,6 +563,14 @@ DriftTool::applyConfig()
         ui->thresholdSlider,
         setValue(m_panelConfig->lockThres * 100));
 
+  BLOCKSIG(
+        ui->trackIntervalSpin,
+        setValue(m_panelConfig->trackInterval));
+
+  BLOCKSIG(
+        ui->rotateSizeSpin,
+        setValue(m_panelConfig->logRotateSize));
+
   // Checkboxes
   BLOCKSIG(
         ui->retuneCheck,
@@ -494,6 +580,22 @@ DriftTool::applyConfig()
         ui->logFileGroup,
         setChecked(m_panelConfig->logToDir));
 
+  BLOCKSIG(
+        ui->closedLoopCheck,
+        setChecked(m_panelConfig->closedLoop));
+
+  BLOCKSIG(
+        ui->predictiveCheck,
+        setChecked(m_panelConfig->predictiveTrack));
+
+  BLOCKSIG(
+        ui->rotateHourlyCheck,
+        setChecked(m_panelConfig->logRotateHourly));
+
+  BLOCKSIG(
+        ui->compressCheck,
+        setChecked(m_panelConfig->logCompress));
+
   BLOCKSIG(
         ui->runCommandGroup,
         setChecked(m_panelConfig->runOnLock));
@@ -507,6 +609,7 @@ DriftTool::applyConfig()
 
   // Apply to objects
   m_processor->setThreshold(m_panelConfig->lockThres);
+  applyHookConfig();
 
   // Apply global properties
   m_propName->setValueSilent(QString::fromStdString(m_panelConfig->probeName));
@@ -580,18 +683,13 @@ bool
 DriftTool::openLog()
 {
   struct timeval tv;
-  struct tm parts;
-  QString file;
-  QString fullPath;
-  QString extension;
+  SegmentedLogParams params;
   QString vesselName = QString::fromStdString(m_panelConfig->probeName);
-  SUSCOUNT counter = 0;
 
   if (m_haveLog || m_analyzer == nullptr)
     return false;
 
   tv = m_analyzer->getSourceTimeStamp();
-  gmtime_r(&tv.tv_sec, &parts);
 
   if (vesselName.size() == 0) {
     vesselName = "UNKNOWN";
@@ -600,36 +698,30 @@ DriftTool::openLog()
   }
 
   if (QString::fromStdString(m_panelConfig->logFormat).toLower() == "strf") {
-    extension = "dat";
+    params.extension = "dat";
     m_loggingSTRF = true;
   } else {
-    extension = "log";
+    params.extension = "log";
     m_loggingSTRF = false;
   }
 
-  do {
-    file = vesselName + QString::asprintf(
-          "_%04d%02d%02d_%02d%02d%02d_%04ld.",
-          parts.tm_year + 1900,
-          parts.tm_mon + 1,
-          parts.tm_mday,
-          parts.tm_hour,
-          parts.tm_min,
-          parts.tm_sec,
-          ++counter) + extension;
-    fullPath = QString::fromStdString(m_panelConfig->logDirPath) + "/" + file;
-  } while (QFile::exists(fullPath));
-
-  m_logFile.setFileName(fullPath);
-  if (!m_logFile.open(QIODevice::ReadWrite | QIODevice::Text)) {
-    std::string error = m_logFile.errorString().toStdString();
-    SU_ERROR("Cannot open %s: %s\n", fullPath.toStdString().c_str(), error.c_str());
+  params.directory    = QString::fromStdString(m_panelConfig->logDirPath);
+  params.prefix       = vesselName;
+  params.maxSize      = m_panelConfig->logRotateSize > 0
+      ? SCAST(quint64, m_panelConfig->logRotateSize) << 20
+      : 0;
+  params.rotateHourly = m_panelConfig->logRotateHourly;
+  params.compress     = m_panelConfig->logCompress;
+  params.indexInterval = DRIFTTOOL_LOG_INDEX_INTERVAL;
+
+  m_log.setParams(params);
+
+  if (!m_log.open(tv.tv_sec + 1e-6 * tv.tv_usec)) {
+    std::string error = m_log.lastError().toStdString();
+    SU_ERROR("Cannot open log: %s\n", error.c_str());
     return false;
   }
 
-  m_logFileName = file;
-  m_logFilePath = fullPath;
-
   m_haveLog = true;
   return true;
 }
@@ -638,60 +730,68 @@ void
 DriftTool::closeLog()
 {
   if (m_haveLog) {
-    m_logFile.close();
+    m_log.close();
     m_haveLog = false;
   }
 }
 
-void
+bool
 DriftTool::logMeasurement(
     SUSCOUNT num,
     qreal full,
     qreal rel)
 {
   if (m_haveLog) {
-    QTextStream log(&m_logFile);
-    auto  start = m_processor->getLastLock();
-    qreal t0    = start.tv_sec + 1e-6 * start.tv_usec;
-    qreal t     = (m_processor->getSamplesPerUpdate() * num) / m_processor->getEquivFs();
-    qreal mjd   = unix2mjd(t0 + t);
-
+    FormatBuffer<160> line;
+    qreal t     = measurementTime(num);
+    qreal mjd   = unix2mjd(t);
 
     if (m_loggingSTRF) {
       // STRF
-      log
-          << QString::asprintf("%12.6lf", mjd) << "\t"
-          << QString::asprintf("%14.3lf", full) << "\t"
-          << QString::asprintf("%8.3lf", 0.) << "\t" // Placeholder until we have SNR
-          << QString::asprintf("%04d", m_panelConfig->strfStationId)
-          << "\n";
+      line
+          .fixed(mjd, 6, false, 12).put('\t')
+          .fixed(full, 3, false, 14).put('\t')
+          .fixed(0., 3, false, 8).put('\t') // Placeholder until we have SNR
+          .integer(m_panelConfig->strfStationId, 4)
+          .put('\n');
     } else {
-      QString mjdStr = QString::asprintf("%.7lf", mjd);
       // CSV
-      log
-          << QString::asprintf("%.7lf", mjd) << ","
-          << num << ","
-          << SCAST(int, m_processor->hasLock()) << ","
-          << SCAST(int, m_processor->isStable()) << ","
-          << QString::asprintf("%.12le", full) << ","
-          << QString::asprintf("%.12le", rel) << "\n";
+      line
+          .fixed(mjd, 7).put(',')
+          .integer(SCAST(int64_t, num)).put(',')
+          .integer(m_processor->hasLock()).put(',')
+          .integer(m_processor->isStable()).put(',')
+          .exponential(full, 12).put(',')
+          .exponential(rel, 12).put('\n');
+    }
+
+    if (!m_log.write(line.data(), line.size(), t)) {
+      std::string error = m_log.lastError().toStdString();
+      SU_ERROR("Cannot write to log: %s\n", error.c_str());
+      return false;
     }
   }
+
+  return true;
 }
 
 void
-DriftTool::refreshMeasurements()
+DriftTool::refreshMeasurements(SUSCOUNT count)
 {
   qreal centerFreq = SCAST(qreal, m_spectrum->getCenterFreq());
   qreal ref        = m_panelConfig->reference;
   qreal delta      = centerFreq - ref;
-  qreal relShift   = m_processor->getCurrShift();
-  qreal drift      = m_processor->getCurrDrift();
+  qreal relShift   = m_processor->getCurrShift()
+      + loopCorrection(measurementTime(count));
+  qreal drift      = m_processor->getCurrDrift() + loopDrift();
   qreal shift      = relShift + delta;
   qreal vel, accel;
 
-  ui->shiftLabel->setText(SuWidgetsHelpers::formatQuantity(shift, 4, "Hz", true));
-  ui->driftLabel->setText(SuWidgetsHelpers::formatQuantity(drift, 4, "Hz/s", true));
+  FormatBuffer<64> text;
+
+  setLabelText(ui->shiftLabel, text.quantity(shift, 4, "Hz", true));
+  text.clear();
+  setLabelText(ui->driftLabel, text.quantity(drift, 4, "Hz/s", true));
 
   m_propShift->setValue(shift);
   m_propDrift->setValue(drift);
@@ -711,11 +811,13 @@ DriftTool::refreshMeasurements()
       ui->velocityLabel->setText("N/A");
       m_propVel->setValue(0);
     } else {
-      ui->velocityLabel->setText(SuWidgetsHelpers::formatQuantity(vel, 4, "m/s", true));
+      text.clear();
+      setLabelText(ui->velocityLabel, text.quantity(vel, 4, "m/s", true));
       m_propVel->setValue(vel);
     }
 
-    ui->accelLabel->setText(SuWidgetsHelpers::formatQuantity(accel, 4, "m/s²", true));
+    text.clear();
+    setLabelText(ui->accelLabel, text.quantity(accel, 4, "m/s\xc2\xb2", true));
     m_propAccel->setValue(accel);
   }
 }
@@ -726,8 +828,10 @@ DriftTool::logCurrentShift(SUSCOUNT count)
   qreal centerFreq = SCAST(qreal, m_spectrum->getCenterFreq());
   qreal ref        = m_panelConfig->reference;
   qreal delta      = centerFreq - ref;
-  qreal relShift   = m_processor->getCurrShift();
+  qreal relShift   = m_processor->getCurrShift()
+      + loopCorrection(measurementTime(count));
   qreal shift      = relShift + delta;
+  unsigned segments;
 
   if (!m_haveLog) {
     if (!openLog()) {
@@ -736,15 +840,26 @@ DriftTool::logCurrentShift(SUSCOUNT count)
       ui->logFileGroup->setChecked(false);
     } else {
       ui->currLogFileEdit->setStyleSheet("");
-      ui->currLogFileEdit->setText(m_logFileName);
+      ui->currLogFileEdit->setText(m_log.fileName());
     }
   }
 
-  if (m_haveLog)
-    logMeasurement(
+  if (m_haveLog) {
+    segments = m_log.segmentCount();
+
+    if (!logMeasurement(
           count,
-          m_processor->getCurrShift() + centerFreq,
-          shift);
+          relShift + centerFreq,
+          shift)) {
+      closeLog();
+      ui->currLogFileEdit->setStyleSheet("font-style: italic");
+      ui->currLogFileEdit->setText("Failed to write log file");
+      ui->logFileGroup->setChecked(false);
+    } else if (segments != m_log.segmentCount()) {
+      // Rotated
+      ui->currLogFileEdit->setText(m_log.fileName());
+    }
+  }
 }
 
 void
@@ -767,6 +882,196 @@ DriftTool::doAutoTrack(qreal chanRelShift)
   }
 }
 
+//
+// Feed-forward tracking: instead of waiting for the carrier to leave the
+// dead band, move the channel every trackInterval seconds to where the
+// smoothed drift rate says the carrier will be halfway through the next
+// interval. The smoothed shift is relative to the tuner, so it is not
+// disturbed by our own retunes.
+//
+void
+DriftTool::doPredictiveTrack(SUSCOUNT count, qreal chanRelShift)
+{
+  qreal bandwidth = m_processor->getTrueBandwidth();
+  qreal interval  = m_panelConfig->trackInterval;
+  qreal t         = count * m_processor->getTrueFeedbackInterval();
+  qreal center, target, step;
+
+  // Locked to something outside the channel, do not chase it
+  if (fabs(chanRelShift) >= .5 * bandwidth)
+    return;
+
+  // Scheduled steps, unless the carrier already fell out of the dead band
+  if (m_lastTrackTime >= 0
+      && t >= m_lastTrackTime
+      && t - m_lastTrackTime < interval
+      && fabs(chanRelShift) < .5 * bandwidth * m_panelConfig->retuneTrigger)
+    return;
+
+  center = SCAST(qreal, m_spectrum->getCenterFreq());
+  target = center
+      + m_processor->getCurrShift()
+      + .5 * interval * m_processor->getCurrDrift();
+  step   = target - ui->frequencySpin->value();
+
+  m_lastTrackTime = t;
+
+  if (fabs(step) < DRIFTTOOL_MIN_TRACK_STEP * bandwidth)
+    return;
+
+  BLOCKSIG(ui->frequencySpin, setValue(target));
+  m_processor->setFrequency(ui->frequencySpin->value());
+  refreshNamedChannel();
+}
+
+
+qreal
+DriftTool::measurementTime(SUSCOUNT count) const
+{
+  auto  start = m_processor->getLastLock();
+  qreal t0    = start.tv_sec + 1e-6 * start.tv_usec;
+
+  return t0
+      + (m_processor->getSamplesPerUpdate() * count) / m_processor->getEquivFs();
+}
+
+//
+// The carrier we measure while the loop is engaged has the loop's own
+// correction removed. These add it back, so that displayed and logged
+// frequencies remain those of the actual carrier.
+//
+qreal
+DriftTool::loopCorrection(qreal t) const
+{
+  if (!m_loopEngaged)
+    return 0;
+
+  return m_loopCorr + (m_loopRate - m_loopRate0) * (t - m_loopTime);
+}
+
+qreal
+DriftTool::loopDrift() const
+{
+  if (!m_loopEngaged)
+    return 0;
+
+  return m_loopRate - m_loopRate0;
+}
+
+bool
+DriftTool::closeLoop(qreal t)
+{
+  // The Doppler tool may have been instantiated after us
+  if (m_propDopShift == nullptr
+      || m_propDopRate == nullptr
+      || m_propDopEnabled == nullptr) {
+    m_propDopShift   = GlobalProperty::lookupProperty("dopplertool:freq_shift");
+    m_propDopRate    = GlobalProperty::lookupProperty("dopplertool:freq_rate");
+    m_propDopEnabled = GlobalProperty::lookupProperty("dopplertool:enabled");
+  }
+
+  if (m_propDopShift == nullptr
+      || m_propDopRate == nullptr
+      || m_propDopEnabled == nullptr) {
+    openLoop("No Doppler tool", true);
+    return false;
+  }
+
+  // Start from whatever the Doppler tool is doing now. Changes made by
+  // hand while the loop was open are not accounted for.
+  if (m_loopEngaged) {
+    m_loopCorr = loopCorrection(t);
+  } else {
+    m_loopCorr    = 0;
+    m_loopRate0   = m_propDopRate->toDouble();
+    m_loopEngaged = true;
+  }
+
+  m_loopTime  = t;
+  m_loopShift = m_propDopShift->toDouble();
+  m_loopRate  = m_propDopRate->toDouble();
+
+  if (!m_propDopEnabled->toBool())
+    m_propDopEnabled->setValue(true);
+
+  m_loopClosed   = true;
+  m_lastLoopTime = -1;
+  ui->loopStateLabel->setText("Closed");
+
+  return true;
+}
+
+void
+DriftTool::openLoop(QString const &reason, bool disable)
+{
+  m_loopClosed   = false;
+  m_lastLoopTime = -1;
+
+  ui->loopStateLabel->setText(reason);
+
+  if (disable && m_panelConfig->closedLoop) {
+    SU_WARNING("Closed-loop Doppler correction disabled: %s\n", reason.toStdString().c_str());
+    m_panelConfig->closedLoop = false;
+    BLOCKSIG(ui->closedLoopCheck, setChecked(false));
+    refreshUi();
+  }
+}
+
+//
+// Closed-loop Doppler correction: the residual offset of the carrier with
+// respect to the channel center is fed to the corrector's reset
+// frequency, and the residual drift to its chirp rate, both through
+// first-order loop filters. Updates are spaced so that the smoothed
+// measurements reflect the previous update before the next one, and the
+// loop opens itself if the residual leaves the channel or the correction
+// exceeds the configured limits.
+//
+void
+DriftTool::doClosedLoop(SUSCOUNT count)
+{
+  qreal t         = measurementTime(count);
+  qreal bandwidth = m_processor->getTrueBandwidth();
+  qreal holdoff   = qMax(
+        SCAST(qreal, m_panelConfig->trackInterval),
+        DRIFTTOOL_LOOP_SETTLE * m_processor->getTrueStabilization());
+  qreal center    = SCAST(qreal, m_spectrum->getCenterFreq());
+  qreal error     = center + m_processor->getCurrShift() - ui->frequencySpin->value();
+  qreal drift     = m_processor->getCurrDrift();
+  qreal maxStep   = DRIFTTOOL_LOOP_MAX_STEP * bandwidth;
+  qreal step, newShift, newRate;
+
+  if (!m_loopClosed && !closeLoop(t))
+    return;
+
+  if (fabs(error) >= .5 * bandwidth) {
+    openLoop("Residual out of channel", true);
+    return;
+  }
+
+  if (m_lastLoopTime >= 0 && t >= m_lastLoopTime && t - m_lastLoopTime < holdoff)
+    return;
+
+  step     = qBound(-maxStep, m_panelConfig->loopShiftGain * error, maxStep);
+  newShift = m_loopShift + step;
+  newRate  = m_loopRate + m_panelConfig->loopRateGain * drift;
+
+  if (fabs(newShift) > m_panelConfig->loopMaxShift
+      || fabs(newRate) > m_panelConfig->loopMaxRate) {
+    openLoop("Correction limit reached", true);
+    return;
+  }
+
+  // Bring the accounting up to date before changing anything
+  m_loopCorr     = loopCorrection(t) + step;
+  m_loopTime     = t;
+  m_loopShift    = newShift;
+  m_loopRate     = newRate;
+  m_lastLoopTime = t;
+
+  m_propDopShift->setValue(m_loopShift);
+  m_propDopRate->setValue(m_loopRate);
+}
+
 
 ////////////////////////////// Slots ///////////////////////////////////////////
 void
@@ -842,7 +1147,7 @@ DriftTool::onMeasurement(quint64 count, qreal chanRelShift, qreal)
 {
   if (m_processor->hasLock()) {
     // Display everything on screen
-    refreshMeasurements();
+    refreshMeasurements(count);
 
     // Notify
     if (!m_haveFirstReading) {
@@ -857,8 +1162,14 @@ DriftTool::onMeasurement(quint64 count, qreal chanRelShift, qreal)
       logCurrentShift(count);
 
     // Do autotrack
-    if (m_panelConfig->retune && m_processor->isStable())
-      doAutoTrack(chanRelShift);
+    if (m_panelConfig->closedLoop && m_processor->isStable()) {
+      doClosedLoop(count);
+    } else if (m_panelConfig->retune && m_processor->isStable()) {
+      if (m_panelConfig->predictiveTrack)
+        doPredictiveTrack(count, chanRelShift);
+      else
+        doAutoTrack(chanRelShift);
+    }
   }
 
   if (ui->stableLed->isOn() != m_processor->isStable()) {
@@ -870,55 +1181,27 @@ DriftTool::onMeasurement(quint64 count, qreal chanRelShift, qreal)
 void
 DriftTool::notifyLock()
 {
-  QStringList programArgs, correctedList;
-
-  if (m_process != nullptr) {
-    m_process->deleteLater();
-    m_process = nullptr;
-  }
-
-  m_process = new DetachableProcess(this);
-
-  SigDiggerHelpers::tokenize(
-        QString::fromStdString(m_panelConfig->programArgs),
-        programArgs);
-
-  connect(
-        m_process,
-        SIGNAL(started()),
-        this,
-        SLOT(onProcessOpened()));
-
-  connect(
-        m_process,
-        SIGNAL(errorOccurred(QProcess::ProcessError)),
-        this,
-        SLOT(onProcessError(QProcess::ProcessError)));
-
-  connect(
-        m_process,
-        SIGNAL(finished(int,QProcess::ExitStatus)),
-        this,
-        SLOT(onProcessFinished(int,QProcess::ExitStatus)));
-
-  m_process->setProcessChannelMode(QProcess::SeparateChannels);
-  m_process->setInputChannelMode(QProcess::ManagedInputChannel);
-  m_process->setProgram(QString::fromStdString(m_panelConfig->programPath));
-
-  for (auto p : programArgs) {
-    QString arg = p;
-    arg = SigDiggerHelpers::expandGlobalProperties(arg);
-    correctedList.append(arg);
-  }
+  m_lockHook->trigger();
+}
 
-  m_process->setArguments(correctedList);
-  m_process->start();
+void
+DriftTool::applyHookConfig()
+{
+  m_lockHook->setProgram(
+        QString::fromStdString(m_panelConfig->programPath),
+        QString::fromStdString(m_panelConfig->programArgs));
+  m_lockHook->setDebounce(SCAST(unsigned, qMax(m_panelConfig->hookDebounce, 0)));
+  m_lockHook->setMinInterval(SCAST(unsigned, qMax(m_panelConfig->hookInterval, 0)));
 }
 
 void
 DriftTool::onLockStateChanged(bool)
 {
   m_haveFirstReading = false;
+  m_lastTrackTime    = -1;
+
+  if (m_loopClosed)
+    openLoop(m_processor->hasLock() ? "Open" : "Open (lock lost)");
 
   if (!m_processor->hasLock()) {
     ui->driftLabel->setText("N/A");
@@ -957,6 +1240,17 @@ DriftTool::onRetuneChanged()
   refreshUi();
 }
 
+void
+DriftTool::onToggleClosedLoop()
+{
+  onConfigChanged();
+
+  if (!m_panelConfig->closedLoop) {
+    openLoop("Open");
+    m_loopEngaged = false;
+  }
+}
+
 void
 DriftTool::onToggleLog()
 {
@@ -1042,6 +1336,7 @@ DriftTool::onConfigChanged()
   m_panelConfig->logDirPath    = ui->logDirEdit->text().toStdString();
   m_panelConfig->programPath   = ui->programPathEdit->text().toStdString();
   m_panelConfig->programArgs   = ui->programArgumentsEdit->text().toStdString();
+  applyHookConfig();
 
   int value = ui->stationIdEdit->text().toInt(&okay);
   if (okay) {
@@ -1057,11 +1352,17 @@ DriftTool::onConfigChanged()
   m_panelConfig->reference     = ui->refFreqSpin->value();
   m_panelConfig->retuneTrigger = ui->retuneTriggerSpin->value() * 1e-2;
   m_panelConfig->lockThres     = ui->thresholdSlider->value() * 1e-2;
+  m_panelConfig->logRotateSize = ui->rotateSizeSpin->value();
+  m_panelConfig->trackInterval = ui->trackIntervalSpin->value();
 
   // Checkboxes
   m_panelConfig->retune    = ui->retuneCheck->isChecked();
   m_panelConfig->logToDir  = ui->logFileGroup->isChecked();
   m_panelConfig->runOnLock = ui->runCommandGroup->isChecked();
+  m_panelConfig->predictiveTrack = ui->predictiveCheck->isChecked();
+  m_panelConfig->closedLoop      = ui->closedLoopCheck->isChecked();
+  m_panelConfig->logRotateHourly = ui->rotateHourlyCheck->isChecked();
+  m_panelConfig->logCompress     = ui->compressCheck->isChecked();
 
   // Other
   m_panelConfig->logFormat = ui->formatCombo->currentIndex() == 0
@@ -1075,56 +1376,6 @@ DriftTool::onConfigChanged()
   refreshUi();
 }
 
-void
-DriftTool::onProcessOpened()
-{
-  m_process->detach();
-}
-
-void
-DriftTool::onProcessError(QProcess::ProcessError error)
-{
-  const char *reason;
-
-  switch (error) {
-    case QProcess::ProcessError::ReadError:
-      reason = "Read error";
-      break;
-
-    case QProcess::ProcessError::FailedToStart:
-      reason = "Process failed to start";
-      break;
-
-    case QProcess::ProcessError::Crashed:
-      reason = "Process crashed";
-      break;
-
-    case QProcess::ProcessError::Timedout:
-      reason = "Process took too long to start";
-      break;
-
-    case QProcess::ProcessError::WriteError:
-      reason = "Write error";
-      break;
-
-    case QProcess::ProcessError::UnknownError:
-      reason = "Unknown reason";
-  }
-
-  SU_ERROR("Failed to launch program on lock: %s\n", reason);
-}
-
-void
-DriftTool::onProcessFinished(int code, QProcess::ExitStatus status)
-{
-  QString reason;
-
-  if (status == QProcess::CrashExit)
-    SU_ERROR("Lock notifier program crashed\n");
-  else if (code != 0)
-    SU_ERROR("Lock notifier program finished with error status %d\n", code);
-}
-
 void
 DriftTool::onPropNameChanged()
 {
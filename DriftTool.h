@@ -23,7 +23,7 @@
 #include <WFHelpers.h>
 #include <QWidget>
 #include <QFile>
-#include <QProcess>
+#include "SegmentedLog.h"
 
 namespace Ui {
   class DriftTool;
@@ -33,7 +33,7 @@ namespace SigDigger {
   class DriftProcessor;
   class MainSpectrum;
   class GlobalProperty;
-  class DetachableProcess;
+  class HookExecutor;
 
   class DriftToolConfig : public Suscan::Serializable {
   public:
@@ -44,16 +44,29 @@ namespace SigDigger {
     float       lockThres     = 0.25;
     bool        retune        = true;
     float       retuneTrigger = 0.1f;
+    bool        predictiveTrack = false;
+    float       trackInterval = 1.f;
+
+    bool        closedLoop    = false;
+    float       loopShiftGain = 0.5f;
+    float       loopRateGain  = 0.5f;
+    SUFREQ      loopMaxShift  = 200e3;  // Hz
+    SUFREQ      loopMaxRate   = 2e3;    // Hz/s
 
     bool        logToDir      = true;
     std::string logDirPath    = "";
     std::string logFormat     = "csv";
     int         strfStationId = 0;
+    int         logRotateSize = 0;     // MiB, 0 to disable
+    bool        logRotateHourly = false;
+    bool        logCompress   = false;
 
     bool        runOnLock     = true;
     std::string programPath   = "/usr/bin/notify-send";
     std::string programArgs   =
         "-e -a AmateurDSN \"%drifttool:name%\" \"Lock acquired on <b>%drifttool:name%</b> (carrier: %drifttool:freq% Hz)\"";
+    int         hookDebounce  = 500;   // ms
+    int         hookInterval  = 2000;  // ms
 
 
 
@@ -71,12 +84,10 @@ namespace SigDigger {
     DriftToolConfig   *m_panelConfig = nullptr;
     DriftProcessor    *m_processor   = nullptr;
     MainSpectrum      *m_spectrum    = nullptr;
-    DetachableProcess *m_process    = nullptr;
+    HookExecutor      *m_lockHook    = nullptr;
 
     // Log saver state
-    QFile   m_logFile;
-    QString m_logFileName;
-    QString m_logFilePath;
+    SegmentedLog m_log;
     bool    m_loggingSTRF = false;
     bool    m_haveLog = false;
 
@@ -99,19 +110,46 @@ namespace SigDigger {
     // Other UI state properties
     bool    m_haveFirstReading = false;
 
+    // Predictive tracking
+    qreal   m_lastTrackTime = -1;
+
+    // Closed-loop Doppler correction. We only account for the correction
+    // introduced by the loop itself, relative to what the Doppler tool
+    // was doing when the loop was first closed.
+    GlobalProperty *m_propDopShift   = nullptr;
+    GlobalProperty *m_propDopRate    = nullptr;
+    GlobalProperty *m_propDopEnabled = nullptr;
+    bool    m_loopClosed   = false;
+    bool    m_loopEngaged  = false;
+    qreal   m_loopShift    = 0;  // Reset frequency passed to the corrector
+    qreal   m_loopRate     = 0;  // Chirp rate passed to the corrector
+    qreal   m_loopRate0    = 0;  // Chirp rate when first engaged
+    qreal   m_loopCorr     = 0;  // Correction added by the loop at m_loopTime
+    qreal   m_loopTime     = 0;
+    qreal   m_lastLoopTime = -1;
+
     void applySpectrumState();
     void connectAll();
     void refreshUi();
     void refreshNamedChannel();
 
     bool openLog();
-    void logMeasurement(SUSCOUNT, qreal full, qreal rel);
+    bool logMeasurement(SUSCOUNT, qreal full, qreal rel);
     void closeLog();
 
-    void refreshMeasurements();
+    void refreshMeasurements(SUSCOUNT count);
     void logCurrentShift(SUSCOUNT count);
     void doAutoTrack(qreal chanRelShift);
+    void doPredictiveTrack(SUSCOUNT count, qreal chanRelShift);
+
+    qreal measurementTime(SUSCOUNT count) const;
+    qreal loopCorrection(qreal t) const;
+    qreal loopDrift() const;
+    bool  closeLoop(qreal t);
+    void  openLoop(QString const &reason, bool disable = false);
+    void  doClosedLoop(SUSCOUNT count);
     void notifyLock();
+    void applyHookConfig();
 
   public:
     explicit DriftTool(DriftToolFactory *, UIMediator *, QWidget *parent = nullptr);
@@ -137,6 +175,7 @@ namespace SigDigger {
     void onLockStateChanged(bool);
     void onAdjust();
     void onRetuneChanged();
+    void onToggleClosedLoop();
     void onToggleLog();
     void onToggleRun();
     void onNameChanged();
@@ -148,10 +187,6 @@ namespace SigDigger {
 
     void onConfigChanged();
 
-    void onProcessOpened();
-    void onProcessError(QProcess::ProcessError error);
-    void onProcessFinished(int code, QProcess::ExitStatus status);
-
     void onPropNameChanged();
     void onPropRefChanged();
 
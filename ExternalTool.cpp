@@ -119,6 +119,37 @@ ExternalTool::addForwarderWidget(ForwarderWidgetConfig const &conf)
         SLOT(onConfigChanged()));
 }
 
+// Resolves the channel each preset reads from. Chains of shared presets
+// are followed up to the one that owns the channel.
+void
+ExternalTool::refreshSources()
+{
+  QStringList titles;
+  int count = m_forwarderWidgets.count();
+
+  for (auto w : m_forwarderWidgets)
+    titles.append(QString::fromStdString(w->getConfig().title));
+
+  for (auto i = 0; i < count; ++i) {
+    int src  = m_forwarderWidgets[i]->getConfig().source;
+    int hops = 0;
+
+    while (src >= 0 && src < count && src != i && hops++ < count) {
+      int next = m_forwarderWidgets[src]->getConfig().source;
+      if (next < 0)
+        break;
+      src = next;
+    }
+
+    m_forwarderWidgets[i]->setSourceList(titles, i);
+    m_forwarderWidgets[i]->setSourceForwarder(
+          src >= 0 && src < count && src != i
+          && m_forwarderWidgets[src]->getConfig().source < 0
+          ? m_forwarderWidgets[src]->forwarder()
+          : nullptr);
+  }
+}
+
 // Configuration methods
 Suscan::Serializable *
 ExternalTool::allocConfig()
@@ -133,6 +164,8 @@ ExternalTool::applyConfig()
 
   for (unsigned int i = 0; i < m_panelConfig->toolPresets.size(); ++i)
     addForwarderWidget(m_panelConfig->toolPresets[i]);
+
+  refreshSources();
 }
 
 bool
@@ -188,4 +221,6 @@ ExternalTool::onConfigChanged()
 
   for (auto i = 0; i < m_forwarderWidgets.count(); ++i)
     m_panelConfig->toolPresets.push_back(m_forwarderWidgets[i]->getConfig());
+
+  refreshSources();
 }
@@ -51,6 +51,7 @@ namespace SigDigger {
     QVector<ForwarderWidget *> m_forwarderWidgets;
 
     void addForwarderWidget(ForwarderWidgetConfig const &);
+    void refreshSources();
 
   public:
     explicit ExternalTool(ExternalToolFactory *, UIMediator *, QWidget *parent = nullptr);
@@ -0,0 +1,233 @@
+//
+//    FileSink.cpp: Records channels straight to disk
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "FileSink.h"
+#include "FileWriter.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <cstring>
+
+#define FILE_SINK_DEFAULT_SIZE (64 << 20)
+
+using namespace SigDigger;
+
+FileSink::FileSink()
+{
+  m_writer = new FileWriter();
+}
+
+FileSink::~FileSink()
+{
+  close();
+  delete m_writer;
+}
+
+QString
+FileSink::fileName(qreal timestamp) const
+{
+  QDateTime time = QDateTime::fromMSecsSinceEpoch(
+        static_cast<qint64>(timestamp * 1e3),
+        Qt::UTC);
+
+  return m_prefix
+      + "_" + time.toString("yyyyMMdd_HHmmss")
+      + "_" + QString("%1").arg(m_segment, 4, 10, QChar('0'));
+}
+
+bool
+FileSink::open(ForwarderSinkParams const &params)
+{
+  QFileInfo info(params.address);
+  uint64_t preallocate = 0;
+
+  close();
+  ForwarderSink::open(params);
+
+  if (params.address.isEmpty()) {
+    m_lastError = "No file prefix given";
+    return false;
+  }
+
+  if (info.isDir()) {
+    m_prefix = QDir(params.address).filePath("channel");
+  } else if (info.absoluteDir().exists()) {
+    m_prefix = info.absoluteFilePath();
+  } else {
+    m_lastError = "Directory " + info.absolutePath() + " does not exist";
+    return false;
+  }
+
+  m_segment     = 0;
+  m_fileSamples = 0;
+  m_maxSamples  = 0;
+  m_inFile      = false;
+  m_paused      = false;
+
+  if (params.splitSize > 0) {
+    m_maxSamples = params.splitSize / params.sampleSize;
+    preallocate  = m_maxSamples * params.sampleSize;
+  }
+
+  if (params.splitTime > 0) {
+    uint64_t samples = static_cast<uint64_t>(params.splitTime * params.sampleRate);
+
+    if (samples == 0)
+      samples = 1;
+
+    if (m_maxSamples == 0 || samples < m_maxSamples) {
+      m_maxSamples = samples;
+      preallocate  = m_maxSamples * params.sampleSize;
+    }
+  }
+
+  if (!m_writer->startWriting(
+        params.bufferSize > 0 ? params.bufferSize : FILE_SINK_DEFAULT_SIZE,
+        params.direct,
+        preallocate)) {
+    m_lastError = "Cannot allocate recording buffers";
+    return false;
+  }
+
+  return true;
+}
+
+void
+FileSink::beginFile(ForwarderBlockInfo const &info)
+{
+  QString base = fileName(info.timestamp);
+
+  m_writer->beginFile(base + ".sigmf-data");
+
+  // The recording is still useful without its metadata
+  m_sidecar.open(
+        base + ".sigmf-meta",
+        static_cast<SampleFormat>(m_params.format),
+        m_params.sampleRate,
+        "AmateurDSN channel recording");
+
+  m_fileSamples = 0;
+  m_inFile      = true;
+  ++m_segment;
+}
+
+void
+FileSink::endFile()
+{
+  if (m_inFile) {
+    m_writer->endFile();
+    m_sidecar.close();
+    m_inFile = false;
+  }
+}
+
+void
+FileSink::close()
+{
+  endFile();
+  m_writer->stopWriting();
+}
+
+bool
+FileSink::write(const void *data, size_t size)
+{
+  const char *bytes = static_cast<const char *>(data);
+  uint64_t count = size / m_params.sampleSize;
+  uint64_t done  = 0;
+  size_t   room  = m_writer->room();
+  size_t   slack = 0;
+
+  if (m_writer->error() != 0) {
+    m_lastError = QString("Cannot write recording: ") + strerror(m_writer->error());
+    return false;
+  }
+
+  // Every split may leave a chunk partially filled
+  if (m_maxSamples > 0)
+    slack = m_writer->chunkSize()
+        * static_cast<size_t>((m_fileSamples + count) / m_maxSamples + 1);
+
+  if (m_paused && 2 * room >= m_writer->capacity())
+    m_paused = false;
+
+  if (m_paused || size + slack > room) {
+    m_paused = m_params.overflow == FORWARDER_OVERFLOW_PAUSE;
+    m_writer->discard(size);
+    if (m_inFile)
+      m_sidecar.append(m_info, count, false);
+    return false;
+  }
+
+  while (done < count) {
+    ForwarderBlockInfo part = m_info;
+    uint64_t n = count - done;
+
+    part.offset    += done;
+    part.timestamp += done / m_params.sampleRate;
+
+    if (!m_inFile)
+      beginFile(part);
+
+    if (m_maxSamples > 0 && n > m_maxSamples - m_fileSamples)
+      n = m_maxSamples - m_fileSamples;
+
+    m_writer->append(bytes, n * m_params.sampleSize);
+    m_sidecar.append(part, n, true);
+
+    m_fileSamples += n;
+    bytes         += n * m_params.sampleSize;
+    done          += n;
+
+    if (m_maxSamples > 0 && m_fileSamples >= m_maxSamples)
+      endFile();
+  }
+
+  return true;
+}
+
+QString
+FileSink::expandArgument(QString const &arg) const
+{
+  QString result = arg;
+
+  return result.replace("%PREFIX%", m_prefix);
+}
+
+size_t
+FileSink::pending() const
+{
+  return m_writer->pending();
+}
+
+uint64_t
+FileSink::written() const
+{
+  return m_writer->written();
+}
+
+uint64_t
+FileSink::dropped() const
+{
+  return m_writer->dropped();
+}
+
+bool
+FileSink::failed() const
+{
+  return m_writer->error() != 0;
+}
@@ -0,0 +1,71 @@
+//
+//    FileSink.h: Records channels straight to disk
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef FILESINK_H
+#define FILESINK_H
+
+#include "ForwarderSink.h"
+#include "SigMFSidecar.h"
+
+namespace SigDigger {
+  class FileWriter;
+
+  //
+  // Records the channel to SigMF recordings (.sigmf-data and
+  // .sigmf-meta pairs) without any consumer process. Files are named
+  // after the prefix, the UTC time of their first sample and a segment
+  // number, and are split when they reach the configured size or
+  // duration. Splits happen on exact sample boundaries.
+  //
+  // Writes go through a FileWriter thread. We never discard queued
+  // data, so FORWARDER_OVERFLOW_DROP_OLDEST behaves as DROP_NEWEST here.
+  // Once the writer fails (disk full...), the sink fails with it.
+  //
+  class FileSink : public ForwarderSink
+  {
+    FileWriter  *m_writer = nullptr;
+    SigMFSidecar m_sidecar;
+    QString      m_prefix;
+    unsigned     m_segment     = 0;
+    uint64_t     m_fileSamples = 0;
+    uint64_t     m_maxSamples  = 0; // Per file, 0: no limit
+    bool         m_inFile      = false;
+    bool         m_paused      = false;
+
+    QString fileName(qreal timestamp) const;
+    void beginFile(ForwarderBlockInfo const &);
+    void endFile();
+
+  public:
+    FileSink();
+    ~FileSink() override;
+
+    bool open(ForwarderSinkParams const &) override;
+    void close() override;
+    bool write(const void *data, size_t size) override;
+
+    QString expandArgument(QString const &) const override;
+
+    size_t   pending() const override;
+    uint64_t written() const override;
+    uint64_t dropped() const override;
+    bool     failed() const override;
+  };
+}
+
+#endif // FILESINK_H
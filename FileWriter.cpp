@@ -0,0 +1,434 @@
+//
+//    FileWriter.cpp: Writer thread for channel recordings
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "FileWriter.h"
+#include <QFile>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#define FILE_WRITER_ALIGNMENT   4096
+#define FILE_WRITER_CHUNK_SIZE  (4 << 20)
+#define FILE_WRITER_MIN_CHUNKS  4
+#define FILE_WRITER_PREALLOC    (256ull << 20)
+#define FILE_WRITER_POLL_MS     100
+
+using namespace SigDigger;
+
+FileWriter::FileWriter(QObject *parent) : QThread(parent)
+{
+}
+
+FileWriter::~FileWriter()
+{
+  stopWriting();
+}
+
+void
+FileWriter::freeChunks()
+{
+  for (auto &chunk : m_chunks)
+    free(chunk.data);
+
+  m_chunks.clear();
+}
+
+bool
+FileWriter::startWriting(size_t bufferSize, bool direct, quint64 preallocate)
+{
+  unsigned count = static_cast<unsigned>(bufferSize / FILE_WRITER_CHUNK_SIZE);
+  quint32 ringSize = 1;
+
+  stopWriting();
+
+  if (count < FILE_WRITER_MIN_CHUNKS)
+    count = FILE_WRITER_MIN_CHUNKS;
+
+  m_chunks.resize(count);
+  for (auto &chunk : m_chunks) {
+    void *data = nullptr;
+
+    if (posix_memalign(&data, FILE_WRITER_ALIGNMENT, FILE_WRITER_CHUNK_SIZE) != 0) {
+      freeChunks();
+      return false;
+    }
+
+    chunk.data = static_cast<char *>(data);
+  }
+
+  // Both rings can hold every chunk at once
+  while (ringSize < count)
+    ringSize <<= 1;
+
+  m_fullRing.resize(ringSize);
+  m_freeRing.resize(ringSize);
+  m_mask = ringSize - 1;
+
+  for (unsigned i = 0; i < count; ++i)
+    m_freeRing[i] = i;
+
+  m_chunkSize   = FILE_WRITER_CHUNK_SIZE;
+  m_direct      = direct;
+  m_preallocate = preallocate;
+  m_current     = -1;
+  m_nextPath.clear();
+
+  m_fullHead.storeRelease(0);
+  m_fullTail.storeRelease(0);
+  m_freeHead.storeRelease(count);
+  m_freeTail.storeRelease(0);
+  m_queued.storeRelease(0);
+  m_written.storeRelease(0);
+  m_dropped.storeRelease(0);
+  m_error.storeRelease(0);
+  m_stopping.storeRelease(0);
+  m_sleeping.storeRelease(0);
+
+  start();
+
+  return true;
+}
+
+// Whatever is buffered reaches the disk before this returns
+void
+FileWriter::stopWriting()
+{
+  if (isRunning()) {
+    endFile();
+
+    m_stopping.storeRelease(1);
+    wake();
+    wait();
+  }
+
+  freeChunks();
+}
+
+void
+FileWriter::wake()
+{
+  QMutexLocker locker(&m_mutex);
+  m_cond.wakeOne();
+}
+
+////////////////////////////////// Producer ///////////////////////////////////
+size_t
+FileWriter::room() const
+{
+  size_t room = (m_freeHead.loadAcquire() - m_freeTail.loadAcquire()) * m_chunkSize;
+
+  if (m_current != -1)
+    room += m_chunkSize - m_chunks[static_cast<size_t>(m_current)].size;
+
+  return room;
+}
+
+size_t
+FileWriter::capacity() const
+{
+  return m_chunks.size() * m_chunkSize;
+}
+
+size_t
+FileWriter::chunkSize() const
+{
+  return m_chunkSize;
+}
+
+bool
+FileWriter::acquire()
+{
+  quint32 tail = m_freeTail.loadAcquire();
+
+  if (m_current != -1)
+    return true;
+
+  if (tail == m_freeHead.loadAcquire())
+    return false;
+
+  m_current = static_cast<int>(m_freeRing[tail & m_mask]);
+  m_freeTail.storeRelease(tail + 1);
+
+  FileChunk &chunk = m_chunks[static_cast<size_t>(m_current)];
+  chunk.size = 0;
+  chunk.last = false;
+  chunk.path = m_nextPath;
+  m_nextPath.clear();
+
+  return true;
+}
+
+void
+FileWriter::submit()
+{
+  quint32 head = m_fullHead.loadAcquire();
+
+  m_queued.fetchAndAddOrdered(m_chunks[static_cast<size_t>(m_current)].size);
+  m_fullRing[head & m_mask] = static_cast<quint32>(m_current);
+  m_fullHead.storeRelease(head + 1);
+  m_current = -1;
+
+  if (m_sleeping.loadAcquire())
+    wake();
+}
+
+bool
+FileWriter::append(const void *data, size_t size)
+{
+  const char *bytes = static_cast<const char *>(data);
+
+  if (m_chunks.empty() || size > room()) {
+    m_dropped.fetchAndAddRelaxed(size);
+    return false;
+  }
+
+  while (size > 0) {
+    acquire();
+
+    FileChunk &chunk = m_chunks[static_cast<size_t>(m_current)];
+    size_t n = m_chunkSize - chunk.size;
+
+    if (n > size)
+      n = size;
+
+    memcpy(chunk.data + chunk.size, bytes, n);
+    chunk.size += n;
+    bytes      += n;
+    size       -= n;
+
+    if (chunk.size == m_chunkSize)
+      submit();
+  }
+
+  return true;
+}
+
+// Accounts for data the producer could not queue
+void
+FileWriter::discard(size_t size)
+{
+  m_dropped.fetchAndAddRelaxed(size);
+}
+
+void
+FileWriter::beginFile(QString const &path)
+{
+  if (m_current != -1)
+    m_chunks[static_cast<size_t>(m_current)].path = path;
+  else
+    m_nextPath = path;
+}
+
+// If no chunk is pending, the writer closes the file when the next one
+// begins (or when it stops).
+void
+FileWriter::endFile()
+{
+  if (m_current != -1 && m_chunks[static_cast<size_t>(m_current)].size > 0) {
+    m_chunks[static_cast<size_t>(m_current)].last = true;
+    submit();
+  }
+}
+
+/////////////////////////////////// Writer ////////////////////////////////////
+void
+FileWriter::openFile(QString const &path)
+{
+  QByteArray name = QFile::encodeName(path);
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+  m_fdDirect = false;
+
+#ifdef O_DIRECT
+  if (m_direct) {
+    m_fd = open(name.constData(), flags | O_DIRECT, 0644);
+    m_fdDirect = m_fd != -1;
+  }
+#endif
+
+  // Some filesystems (tmpfs) refuse O_DIRECT
+  if (m_fd == -1)
+    m_fd = open(name.constData(), flags, 0644);
+
+  if (m_fd == -1) {
+    m_error.testAndSetOrdered(0, errno);
+    return;
+  }
+
+  m_offset      = 0;
+  m_allocated   = 0;
+  m_canAllocate = true;
+
+  reserve(m_preallocate > 0 ? m_preallocate : FILE_WRITER_PREALLOC);
+}
+
+// Allocates blocks without changing the file size, so an interrupted
+// recording never ends in a run of zeroes.
+void
+FileWriter::reserve(quint64 size)
+{
+#ifdef FALLOC_FL_KEEP_SIZE
+  if (!m_canAllocate || size <= m_allocated)
+    return;
+
+  if (fallocate(
+        m_fd,
+        FALLOC_FL_KEEP_SIZE,
+        static_cast<off_t>(m_allocated),
+        static_cast<off_t>(size - m_allocated)) == 0)
+    m_allocated = size;
+  else
+    m_canAllocate = false;
+#else
+  (void) size;
+#endif
+}
+
+bool
+FileWriter::writeAll(const char *data, size_t size)
+{
+  if (m_offset + size > m_allocated)
+    reserve(m_allocated + (m_preallocate > 0 ? m_preallocate : FILE_WRITER_PREALLOC));
+
+#ifdef O_DIRECT
+  // The tail of a file is not a whole number of blocks
+  if (m_fdDirect && size % FILE_WRITER_ALIGNMENT != 0) {
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+    m_fdDirect = false;
+  }
+#endif
+
+  while (size > 0) {
+    ssize_t got = write(m_fd, data, size);
+
+    if (got < 0) {
+      if (errno == EINTR)
+        continue;
+
+      m_error.testAndSetOrdered(0, errno);
+      return false;
+    }
+
+    m_offset += static_cast<quint64>(got);
+    data     += got;
+    size     -= static_cast<size_t>(got);
+  }
+
+  return true;
+}
+
+void
+FileWriter::closeFile()
+{
+  if (m_fd != -1) {
+    // Give back what was preallocated and not used
+    if (ftruncate(m_fd, static_cast<off_t>(m_offset)) == -1)
+      m_error.testAndSetOrdered(0, errno);
+
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+void
+FileWriter::writeChunk(FileChunk &chunk)
+{
+  if (!chunk.path.isEmpty()) {
+    closeFile();
+    openFile(chunk.path);
+  }
+
+  if (m_fd != -1 && writeAll(chunk.data, chunk.size))
+    m_written.fetchAndAddRelaxed(chunk.size);
+  else
+    m_dropped.fetchAndAddRelaxed(chunk.size);
+
+  if (chunk.last)
+    closeFile();
+}
+
+void
+FileWriter::run()
+{
+  for (;;) {
+    quint32 tail = m_fullTail.loadAcquire();
+    quint32 head;
+    quint32 index;
+
+    if (tail == m_fullHead.loadAcquire()) {
+      if (m_stopping.loadAcquire())
+        break;
+
+      m_sleeping.fetchAndStoreOrdered(1);
+
+      {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_fullHead.loadAcquire() == m_fullTail.loadAcquire()
+            && !m_stopping.loadAcquire())
+          m_cond.wait(&m_mutex, FILE_WRITER_POLL_MS);
+      }
+
+      m_sleeping.storeRelease(0);
+      continue;
+    }
+
+    index = m_fullRing[tail & m_mask];
+    writeChunk(m_chunks[index]);
+
+    m_queued.fetchAndSubOrdered(m_chunks[index].size);
+    m_fullTail.storeRelease(tail + 1);
+
+    head = m_freeHead.loadAcquire();
+    m_freeRing[head & m_mask] = index;
+    m_freeHead.storeRelease(head + 1);
+  }
+
+  closeFile();
+}
+
+quint64
+FileWriter::written() const
+{
+  return m_written.loadAcquire();
+}
+
+quint64
+FileWriter::dropped() const
+{
+  return m_dropped.loadAcquire();
+}
+
+size_t
+FileWriter::pending() const
+{
+  size_t pending = static_cast<size_t>(m_queued.loadAcquire());
+
+  if (m_current != -1)
+    pending += m_chunks[static_cast<size_t>(m_current)].size;
+
+  return pending;
+}
+
+int
+FileWriter::error() const
+{
+  return m_error.loadAcquire();
+}
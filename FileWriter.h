@@ -0,0 +1,127 @@
+//
+//    FileWriter.h: Writer thread for channel recordings
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <QString>
+#include <vector>
+
+namespace SigDigger {
+  struct FileChunk {
+    char   *data = nullptr; // Page aligned
+    size_t  size = 0;
+    bool    last = false;   // Close the file after this chunk
+    QString path;           // If set, open this file before writing
+  };
+
+  //
+  // Writes recordings to disk from a thread of its own. The producer
+  // copies samples into large page-aligned chunks taken from a fixed
+  // pool, and hands full chunks to the writer through a single-producer,
+  // single-consumer ring. The writer returns them through another one.
+  // Neither side ever takes a lock, except to park the writer.
+  //
+  // Every chunk but the last of a file is full, so file offsets stay
+  // aligned and O_DIRECT can be used. Files are preallocated with
+  // fallocate() and trimmed to their real size when closed.
+  //
+  class FileWriter : public QThread
+  {
+    Q_OBJECT
+
+    std::vector<FileChunk> m_chunks;
+    std::vector<quint32>   m_fullRing;
+    std::vector<quint32>   m_freeRing;
+    quint32                m_mask = 0;
+    size_t                 m_chunkSize = 0;
+    bool                   m_direct = false;
+    quint64                m_preallocate = 0;
+
+    QAtomicInteger<quint32> m_fullHead; // Producer
+    QAtomicInteger<quint32> m_fullTail; // Writer
+    QAtomicInteger<quint32> m_freeHead; // Writer
+    QAtomicInteger<quint32> m_freeTail; // Producer
+    QAtomicInteger<quint64> m_queued;   // Bytes in full chunks
+    QAtomicInteger<quint64> m_written;
+    QAtomicInteger<quint64> m_dropped;
+    QAtomicInteger<int>     m_error;    // errno of the first failure
+    QAtomicInteger<int>     m_stopping;
+    QAtomicInteger<int>     m_sleeping;
+
+    QMutex         m_mutex;
+    QWaitCondition m_cond;
+
+    // Producer only
+    int     m_current = -1;
+    QString m_nextPath;
+
+    // Writer only
+    int     m_fd = -1;
+    bool    m_fdDirect = false;
+    quint64 m_offset = 0;
+    quint64 m_allocated = 0;
+    bool    m_canAllocate = true;
+
+    bool acquire();
+    void submit();
+    void wake();
+
+    void openFile(QString const &);
+    void reserve(quint64);
+    bool writeAll(const char *, size_t);
+    void closeFile();
+    void writeChunk(FileChunk &);
+    void freeChunks();
+
+  protected:
+    void run() override;
+
+  public:
+    FileWriter(QObject *parent = nullptr);
+    ~FileWriter() override;
+
+    // Preallocation is done in steps of this size, or of the whole file
+    // if its final size is known.
+    bool startWriting(
+        size_t bufferSize,
+        bool direct,
+        quint64 preallocate = 0);
+    void stopWriting();
+
+    // Producer side. append() takes all of the data or none of it.
+    size_t room() const;
+    size_t capacity() const;
+    size_t chunkSize() const;
+    bool   append(const void *, size_t);
+    void   discard(size_t);
+    void   beginFile(QString const &);
+    void   endFile();
+
+    quint64 written() const;
+    quint64 dropped() const;
+    size_t  pending() const;
+    int     error() const;
+  };
+}
+
+#endif // FILEWRITER_H
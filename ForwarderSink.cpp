@@ -0,0 +1,191 @@
+//
+//    ForwarderSink.cpp: Sample sinks for the process forwarder
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ForwarderSink.h"
+#include "PipeSink.h"
+#include "ShmRingSink.h"
+#include "SocketSink.h"
+#include "FileSink.h"
+#include "AmateurDSNFrame.h"
+#include <cstring>
+
+using namespace SigDigger;
+
+/////////////////////////////// ForwarderSink //////////////////////////////////
+ForwarderSink::~ForwarderSink()
+{
+}
+
+bool
+ForwarderSink::open(ForwarderSinkParams const &params)
+{
+  m_params      = params;
+  m_info        = ForwarderBlockInfo();
+  m_sequence    = 0;
+  m_lastDropped = 0;
+
+  return true;
+}
+
+void
+ForwarderSink::setBlockInfo(ForwarderBlockInfo const &info)
+{
+  bool retune = m_info.retune;
+
+  m_info = info;
+
+  // A retune not yet reported in a header stays pending
+  m_info.retune = info.retune || retune;
+}
+
+size_t
+ForwarderSink::makeHeader(void *buf, size_t payload, uint64_t skip)
+{
+  adsn_frame_header hdr;
+  adsn_frame_metadata meta;
+  uint64_t lost = this->lost();
+  size_t size = sizeof(adsn_frame_header);
+
+  if (!m_params.framed)
+    return 0;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic        = ADSN_FRAME_MAGIC;
+  hdr.version      = ADSN_FRAME_VERSION;
+  hdr.sequence     = m_sequence++;
+  hdr.payload_size = static_cast<uint32_t>(payload);
+
+  if (m_params.metadata) {
+    memset(&meta, 0, sizeof(meta));
+    meta.timestamp     = m_info.timestamp + skip / m_params.sampleRate;
+    meta.frequency     = m_info.frequency;
+    meta.sample_rate   = m_params.sampleRate;
+    meta.sample_offset = m_info.offset + skip;
+    meta.dropped       = lost / m_params.sampleSize;
+    meta.sample_size   = m_params.sampleSize;
+    meta.format        = static_cast<uint32_t>(m_params.format);
+
+    hdr.flags |= ADSN_FRAME_FLAG_METADATA;
+    if (m_info.retune)
+      hdr.flags |= ADSN_FRAME_FLAG_RETUNE;
+    if (lost != m_lastDropped)
+      hdr.flags |= ADSN_FRAME_FLAG_DISCONTINUITY;
+
+    memcpy(static_cast<uint8_t *>(buf) + size, &meta, sizeof(meta));
+    size += sizeof(meta);
+  }
+
+  hdr.header_size = static_cast<uint16_t>(size);
+  memcpy(buf, &hdr, sizeof(hdr));
+
+  m_info.retune = false;
+  m_lastDropped = lost;
+
+  return size;
+}
+
+QString
+ForwarderSink::expandArgument(QString const &arg) const
+{
+  return arg;
+}
+
+void
+ForwarderSink::aboutToLaunch(DetachableProcess &)
+{
+}
+
+void
+ForwarderSink::launched(DetachableProcess &)
+{
+}
+
+bool
+ForwarderSink::restart()
+{
+  return true;
+}
+
+size_t
+ForwarderSink::pending() const
+{
+  return 0;
+}
+
+QString
+ForwarderSink::lastError() const
+{
+  return m_lastError;
+}
+
+uint64_t
+ForwarderSink::written() const
+{
+  return m_written;
+}
+
+uint64_t
+ForwarderSink::dropped() const
+{
+  return m_dropped;
+}
+
+uint64_t
+ForwarderSink::lost() const
+{
+  return dropped();
+}
+
+uint64_t
+ForwarderSink::discarded() const
+{
+  return 0;
+}
+
+uint64_t
+ForwarderSink::discardedAt() const
+{
+  return 0;
+}
+
+bool
+ForwarderSink::failed() const
+{
+  return false;
+}
+
+int64_t
+ForwarderSink::latency()
+{
+  return -1;
+}
+
+ForwarderSink *
+ForwarderSink::make(QString const &type)
+{
+  if (type == "shm")
+    return new ShmRingSink();
+
+  if (type == "socket")
+    return new SocketSink();
+
+  if (type == "file")
+    return new FileSink();
+
+  return new PipeSink();
+}
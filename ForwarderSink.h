@@ -0,0 +1,127 @@
+//
+//    ForwarderSink.h: Sample sinks for the process forwarder
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef FORWARDERSINK_H
+#define FORWARDERSINK_H
+
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+
+namespace SigDigger {
+  class DetachableProcess;
+
+  // What to do with a block that does not fit in the sink buffer
+  enum ForwarderOverflowPolicy {
+    FORWARDER_OVERFLOW_DROP_OLDEST, // Make room by discarding queued blocks
+    FORWARDER_OVERFLOW_DROP_NEWEST, // Discard the incoming block
+    FORWARDER_OVERFLOW_PAUSE,       // Stop forwarding until half drained
+  };
+
+  struct ForwarderSinkParams {
+    qreal    sampleRate = 0;
+    unsigned sampleSize = 8;   // Bytes per sample
+    size_t   bufferSize = 0;   // Bytes, 0: sink default
+    ForwarderOverflowPolicy overflow = FORWARDER_OVERFLOW_DROP_OLDEST;
+    QString  address;          // Socket sinks: unix:PATH, tcp:HOST:PORT...
+                               // File sinks: path prefix or directory
+    bool     framed = false;   // Prefix packets with an adsn_frame_header
+    bool     metadata = false; // ...followed by an adsn_frame_metadata
+    int      format = 0;       // SampleFormat of the payload
+    bool     supervised = false; // Keep buffering while the consumer restarts
+    uint64_t splitSize = 0;    // File sinks: bytes per file, 0: no limit
+    qreal    splitTime = 0;    // File sinks: seconds per file, 0: no limit
+    bool     direct = false;   // File sinks: bypass the page cache
+  };
+
+  // Where the next block comes from. Set before every write().
+  struct ForwarderBlockInfo {
+    qreal    timestamp = 0; // Source time of the first sample (Unix)
+    qreal    frequency = 0; // Channel center frequency
+    uint64_t offset    = 0; // Stream index of the first sample
+    bool     retune    = false;
+  };
+
+#define FORWARDER_SINK_MAX_HEADER 128
+
+  //
+  // A sink is where the forwarder puts the channel samples. It is opened
+  // before the consumer is launched, may add its own placeholders to the
+  // program arguments and gets a chance to prepare the child process.
+  //
+  class ForwarderSink
+  {
+  protected:
+    QString  m_lastError;
+    uint64_t m_written = 0; // Bytes handed to the consumer
+    uint64_t m_dropped = 0; // Bytes discarded on overflow
+
+    ForwarderSinkParams m_params;
+    ForwarderBlockInfo  m_info;
+    uint32_t m_sequence    = 0;
+    uint64_t m_lastDropped = 0;
+
+    // Fills the frame header of a packet starting skip samples into the
+    // current block. Returns its size, 0 if framing is disabled.
+    size_t makeHeader(void *buf, size_t payload, uint64_t skip);
+
+  public:
+    virtual ~ForwarderSink();
+
+    // Implementations must call this one first
+    virtual bool open(ForwarderSinkParams const &);
+    virtual void close() = 0;
+    virtual bool write(const void *data, size_t size) = 0;
+
+    virtual QString expandArgument(QString const &) const;
+    virtual void aboutToLaunch(DetachableProcess &);
+    virtual void launched(DetachableProcess &);
+
+    // Prepares for a new instance of the consumer. Blocks queued while
+    // there was none are kept for it.
+    virtual bool restart();
+
+    virtual size_t   pending() const;
+    virtual uint64_t written() const;
+    virtual uint64_t dropped() const;
+
+    // Sample bytes lost, frame headers excluded
+    virtual uint64_t lost() const;
+
+    // Sample bytes discarded after write() had accepted them, and where
+    // the last run of them began, in bytes accepted so far. Only sinks
+    // that trim their queue ever discard.
+    virtual uint64_t discarded() const;
+    virtual uint64_t discardedAt() const;
+
+    // True once the sink can no longer deliver anything. lastError()
+    // tells why.
+    virtual bool     failed() const;
+
+    // Longest a block waited to be written since the last call, in
+    // nanoseconds. -1 if the sink does not keep track.
+    virtual int64_t  latency();
+
+    QString lastError() const;
+    void setBlockInfo(ForwarderBlockInfo const &);
+
+    static ForwarderSink *make(QString const &type);
+  };
+}
+
+#endif // FORWARDERSINK_H
@@ -22,16 +22,26 @@
 #include <QFileDialog>
 #include <QMouseEvent>
 #include <QInputDialog>
+#include <QTimer>
 #include <UIMediator.h>
 #include <MainSpectrum.h>
 #include <SigDiggerHelpers.h>
+#include <GlobalProperty.h>
 
 using namespace SigDigger;
 
+#define FORWARDER_WIDGET_STATS_MS 1000
+
 #define STRINGFY(x) #x
 #define STORE(field) obj.set(STRINGFY(field), this->field)
 #define LOAD(field) this->field = conf.get(STRINGFY(field), this->field)
 
+// In the same order as the entries of sinkCombo
+static const char *g_sinkTypes[] = {"pipe", "shm", "socket", "file"};
+
+// In the same order as the entries of overflowCombo
+static const char *g_overflowPolicies[] = {"drop-oldest", "drop-newest", "pause"};
+
 
 //////////////////////////// Widget config /////////////////////////////////////
 void
@@ -40,6 +50,24 @@ ForwarderWidgetConfig::deserialize(Suscan::Object const &conf)
   LOAD(programPath);
   LOAD(arguments);
   LOAD(title);
+  LOAD(sink);
+  LOAD(bufferSize);
+  LOAD(overflow);
+  LOAD(format);
+  LOAD(scale);
+  LOAD(dither);
+  LOAD(source);
+  LOAD(address);
+  LOAD(framed);
+  LOAD(metadata);
+  LOAD(sigmfPath);
+  LOAD(outputRate);
+  LOAD(supervise);
+  LOAD(splitSize);
+  LOAD(splitTime);
+  LOAD(direct);
+  LOAD(returnFormat);
+  LOAD(returnProperty);
 }
 
 Suscan::Object &&
@@ -52,6 +80,24 @@ ForwarderWidgetConfig::serialize()
   STORE(programPath);
   STORE(arguments);
   STORE(title);
+  STORE(sink);
+  STORE(bufferSize);
+  STORE(overflow);
+  STORE(format);
+  STORE(scale);
+  STORE(dither);
+  STORE(source);
+  STORE(address);
+  STORE(framed);
+  STORE(metadata);
+  STORE(sigmfPath);
+  STORE(outputRate);
+  STORE(supervise);
+  STORE(splitSize);
+  STORE(splitTime);
+  STORE(direct);
+  STORE(returnFormat);
+  STORE(returnProperty);
 
   return persist(obj);
 }
@@ -67,6 +113,9 @@ ForwarderWidget::ForwarderWidget(UIMediator *mediator, QWidget *parent) :
   m_forwarder = new ProcessForwarder(mediator, this);
   m_mediator  = mediator;
 
+  m_statsTimer = new QTimer(this);
+  m_statsTimer->setInterval(FORWARDER_WIDGET_STATS_MS);
+
   connectAll();
   refreshUi();
 }
@@ -80,14 +129,50 @@ void
 ForwarderWidget::refreshUi()
 {
   bool haveAnalyzer = m_analyzer != nullptr;
+  bool ownChannel   = !m_forwarder->isFollower();
 
   ui->openButton->setEnabled(haveAnalyzer && m_forwarder->state() == PROCESS_FORWARDER_IDLE);
   ui->browseButton->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
   ui->detachButton->setEnabled(haveAnalyzer && m_forwarder->state() == PROCESS_FORWARDER_RUNNING);
   ui->terminateButton->setEnabled(haveAnalyzer && m_forwarder->state() != PROCESS_FORWARDER_IDLE);
 
-  ui->bandwidthSpin->setEnabled(haveAnalyzer && m_forwarder->state() == PROCESS_FORWARDER_RUNNING);
-  ui->frequencySpin->setEnabled(haveAnalyzer && m_forwarder->state() == PROCESS_FORWARDER_RUNNING);
+  ui->bandwidthSpin->setEnabled(ownChannel && haveAnalyzer && m_forwarder->state() == PROCESS_FORWARDER_RUNNING);
+  ui->frequencySpin->setEnabled(ownChannel && haveAnalyzer && m_forwarder->state() == PROCESS_FORWARDER_RUNNING);
+  ui->sourceCombo->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->addressEdit->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && (sinkType() == "socket" || sinkType() == "file"));
+  ui->framedCheck->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && (sinkType() == "pipe" || sinkType() == "socket"));
+  ui->metadataCheck->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && (sinkType() == "pipe" || sinkType() == "socket")
+        && ui->framedCheck->isChecked());
+  ui->splitSizeSpin->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && sinkType() == "file");
+  ui->splitTimeSpin->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && sinkType() == "file");
+  ui->directCheck->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && sinkType() == "file");
+  ui->sigmfEdit->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->sinkCombo->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->bufferSizeSpin->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->overflowCombo->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->formatCombo->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->scaleSpin->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->outputRateSpin->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->superviseCheck->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->returnCombo->setEnabled(m_forwarder->state() == PROCESS_FORWARDER_IDLE);
+  ui->returnPropertyEdit->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && ui->returnCombo->currentIndex() > RETURN_FORMAT_NONE);
+  ui->ditherCheck->setEnabled(
+        m_forwarder->state() == PROCESS_FORWARDER_IDLE
+        && ui->formatCombo->currentIndex() >= SAMPLE_FORMAT_CS16);
 }
 
 void
@@ -99,6 +184,18 @@ ForwarderWidget::connectAll()
         this,
         SLOT(onForwarderStateChanged(int,QString)));
 
+  connect(
+        m_forwarder,
+        SIGNAL(returnReading(qreal,qreal,quint64)),
+        this,
+        SLOT(onReturnReading(qreal,qreal,quint64)));
+
+  connect(
+        m_statsTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onStatsTimeout()));
+
   connect(
         ui->openButton,
         SIGNAL(clicked(bool)),
@@ -146,13 +243,123 @@ ForwarderWidget::connectAll()
         SIGNAL(textEdited(QString)),
         this,
         SLOT(onConfigChanged()));
+
+  connect(
+        ui->sinkCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->bufferSizeSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->overflowCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->formatCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->scaleSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->ditherCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->sourceCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->addressEdit,
+        SIGNAL(textEdited(QString)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->framedCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->outputRateSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->splitSizeSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->splitTimeSpin,
+        SIGNAL(valueChanged(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->directCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->superviseCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->metadataCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->sigmfEdit,
+        SIGNAL(textEdited(QString)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->returnCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->returnPropertyEdit,
+        SIGNAL(textEdited(QString)),
+        this,
+        SLOT(onConfigChanged()));
 }
 
 void
 ForwarderWidget::refreshNamedChannel()
 {
+  // Followers are drawn by the preset that owns the channel
   bool shouldHaveNamChan =
          m_analyzer != nullptr
+      && !m_forwarder->isFollower()
       && m_forwarder->state() >= PROCESS_FORWARDER_OPENING;
 
   // Check whether we should have a named channel here.
@@ -222,6 +429,128 @@ ForwarderWidget::applySpectrumState()
   }
 }
 
+// Preset titles are free text, property names are not
+QString
+ForwarderWidget::propertyPrefix() const
+{
+  QString title = ui->groupBox->title().toLower();
+
+  for (auto &c : title)
+    if (!c.isLetterOrNumber())
+      c = '_';
+
+  return "externaltool:" + title;
+}
+
+QString
+ForwarderWidget::returnPropertyName() const
+{
+  QString name = ui->returnPropertyEdit->text().trimmed();
+
+  if (!name.isEmpty())
+    return name;
+
+  return propertyPrefix();
+}
+
+void
+ForwarderWidget::bindReturnProperty()
+{
+  QString name = returnPropertyName();
+
+  m_propReturn = GlobalProperty::lookupProperty(name);
+
+  if (m_propReturn == nullptr)
+    m_propReturn = GlobalProperty::registerProperty(
+          name,
+          "External tool: output of " + ui->groupBox->title(),
+          0.);
+}
+
+void
+ForwarderWidget::bindStatsProperties()
+{
+  QString prefix = propertyPrefix();
+  QString title  = ui->groupBox->title();
+
+  auto bind = [prefix, title] (QString const &name, QString const &desc) {
+    GlobalProperty *prop = GlobalProperty::lookupProperty(prefix + name);
+
+    if (prop == nullptr)
+      prop = GlobalProperty::registerProperty(
+            prefix + name,
+            "External tool: " + desc + " of " + title,
+            0.);
+
+    return prop;
+  };
+
+  m_propRateIn   = bind(":samples_in", "channel samples taken [sps]");
+  m_propRateOut  = bind(":bytes_out", "bytes written [B/s]");
+  m_propPending  = bind(":pending", "bytes waiting for the program [B]");
+  m_propDropped  = bind(":dropped", "bytes dropped [B]");
+  m_propRestarts = bind(":restarts", "program restarts");
+  m_propLatency  = bind(":latency", "worst write-to-drain latency [s]");
+}
+
+// Counters are cumulative and live in the forwarder. Rates come from
+// their difference between two refreshes.
+void
+ForwarderWidget::refreshStats()
+{
+  qreal dt          = m_statsTime.restart() * 1e-3;
+  quint64 in        = m_forwarder->samplesIn();
+  quint64 out       = m_forwarder->bytesWritten();
+  qreal pending     = SCAST(qreal, m_forwarder->bytesPending());
+  qreal dropped     = SCAST(qreal, m_forwarder->bytesDropped());
+  unsigned restarts = m_forwarder->restartCount();
+  int64_t drain     = m_forwarder->drainLatency();
+  qreal rateIn      = 0;
+  qreal rateOut     = 0;
+  qreal latency;
+  QString latencyText;
+
+  // The sink was reopened
+  if (in < m_lastSamplesIn)
+    m_lastSamplesIn = 0;
+  if (out < m_lastWritten)
+    m_lastWritten = 0;
+
+  if (dt > 0) {
+    rateIn  = SCAST(qreal, in - m_lastSamplesIn) / dt;
+    rateOut = SCAST(qreal, out - m_lastWritten) / dt;
+  }
+
+  m_lastSamplesIn = in;
+  m_lastWritten   = out;
+
+  // Sinks that do not time their blocks: time to drain what is pending
+  if (drain >= 0) {
+    latency     = SCAST(qreal, drain) * 1e-9;
+    latencyText = SuWidgetsHelpers::formatQuantity(latency, 3, "s");
+  } else {
+    latency     = rateOut > 0 ? pending / rateOut : 0;
+    latencyText = "~" + SuWidgetsHelpers::formatQuantity(latency, 3, "s");
+  }
+
+  ui->statsLabel->setText(
+        "In: " + SuWidgetsHelpers::formatQuantity(rateIn, 3, "sps")
+        + ", out: " + SuWidgetsHelpers::formatQuantity(rateOut, 3, "B/s")
+        + ", latency: " + latencyText
+        + "\nPending: " + SuWidgetsHelpers::formatQuantity(pending, 3, "B")
+        + ", dropped: " + SuWidgetsHelpers::formatQuantity(dropped, 3, "B")
+        + ", restarts: " + QString::number(restarts));
+
+  if (m_propRateIn != nullptr) {
+    m_propRateIn->setValue(rateIn);
+    m_propRateOut->setValue(rateOut);
+    m_propPending->setValue(pending);
+    m_propDropped->setValue(dropped);
+    m_propRestarts->setValue(SCAST(qreal, restarts));
+    m_propLatency->setValue(latency);
+  }
+}
+
 void
 ForwarderWidget::setState(int, Suscan::Analyzer *analyzer)
 {
@@ -284,6 +613,67 @@ ForwarderWidget::setName(QString const &name)
   refreshNamedChannel();
 }
 
+void
+ForwarderWidget::setSinkType(QString const &type)
+{
+  int index = 0;
+
+  for (unsigned i = 0; i < sizeof(g_sinkTypes) / sizeof(g_sinkTypes[0]); ++i)
+    if (type == g_sinkTypes[i])
+      index = SCAST(int, i);
+
+  BLOCKSIG(ui->sinkCombo, setCurrentIndex(index));
+}
+
+void
+ForwarderWidget::setOverflowPolicy(QString const &policy)
+{
+  int index = 0;
+
+  for (unsigned i = 0; i < sizeof(g_overflowPolicies) / sizeof(g_overflowPolicies[0]); ++i)
+    if (policy == g_overflowPolicies[i])
+      index = SCAST(int, i);
+
+  BLOCKSIG(ui->overflowCombo, setCurrentIndex(index));
+}
+
+void
+ForwarderWidget::setSourceList(QStringList const &titles, int self)
+{
+  int index = 0;
+
+  ui->sourceCombo->blockSignals(true);
+  ui->sourceCombo->clear();
+  ui->sourceCombo->addItem("Own channel", QVariant(-1));
+
+  for (int i = 0; i < titles.size(); ++i) {
+    if (i == self)
+      continue;
+
+    ui->sourceCombo->addItem("Shared with " + titles[i], QVariant(i));
+
+    if (i == m_config.source)
+      index = ui->sourceCombo->count() - 1;
+  }
+
+  ui->sourceCombo->setCurrentIndex(index);
+  ui->sourceCombo->blockSignals(false);
+}
+
+void
+ForwarderWidget::setSourceForwarder(ProcessForwarder *source)
+{
+  m_forwarder->setSource(source);
+  refreshNamedChannel();
+  refreshUi();
+}
+
+ProcessForwarder *
+ForwarderWidget::forwarder() const
+{
+  return m_forwarder;
+}
+
 QString
 ForwarderWidget::programPath() const
 {
@@ -296,6 +686,28 @@ ForwarderWidget::arguments() const
   return ui->argumentEdit->text();
 }
 
+QString
+ForwarderWidget::sinkType() const
+{
+  int index = ui->sinkCombo->currentIndex();
+
+  if (index < 0)
+    index = 0;
+
+  return g_sinkTypes[index];
+}
+
+QString
+ForwarderWidget::overflowPolicy() const
+{
+  int index = ui->overflowCombo->currentIndex();
+
+  if (index < 0)
+    index = 0;
+
+  return g_overflowPolicies[index];
+}
+
 void
 ForwarderWidget::mouseDoubleClickEvent(QMouseEvent *ev)
 {
@@ -318,11 +730,43 @@ ForwarderWidget::mouseDoubleClickEvent(QMouseEvent *ev)
 void
 ForwarderWidget::setConfig(ForwarderWidgetConfig const &config)
 {
+  SampleFormat format;
+  ReturnFormat returnFormat;
+
   m_config = config;
 
   setName(QString::fromStdString(m_config.title));
   setProgramPath(QString::fromStdString(m_config.programPath));
   setArguments(QString::fromStdString(m_config.arguments));
+  setSinkType(QString::fromStdString(m_config.sink));
+  setOverflowPolicy(QString::fromStdString(m_config.overflow));
+  BLOCKSIG(ui->bufferSizeSpin, setValue(m_config.bufferSize));
+  BLOCKSIG(ui->scaleSpin, setValue(SCAST(qreal, m_config.scale)));
+  BLOCKSIG(ui->outputRateSpin, setValue(m_config.outputRate));
+  BLOCKSIG(ui->superviseCheck, setChecked(m_config.supervise));
+  BLOCKSIG(ui->splitSizeSpin, setValue(m_config.splitSize));
+  BLOCKSIG(ui->splitTimeSpin, setValue(m_config.splitTime));
+  BLOCKSIG(ui->directCheck, setChecked(m_config.direct));
+  BLOCKSIG(ui->ditherCheck, setChecked(m_config.dither));
+  BLOCKSIG(ui->addressEdit, setText(QString::fromStdString(m_config.address)));
+  BLOCKSIG(ui->framedCheck, setChecked(m_config.framed));
+  BLOCKSIG(ui->metadataCheck, setChecked(m_config.metadata));
+  BLOCKSIG(ui->sigmfEdit, setText(QString::fromStdString(m_config.sigmfPath)));
+  BLOCKSIG(
+        ui->returnPropertyEdit,
+        setText(QString::fromStdString(m_config.returnProperty)));
+
+  if (ReturnReader::parseFormat(
+        QString::fromStdString(m_config.returnFormat),
+        returnFormat))
+    BLOCKSIG(ui->returnCombo, setCurrentIndex(returnFormat));
+
+  if (SampleConverter::parseFormat(
+        QString::fromStdString(m_config.format),
+        format))
+    BLOCKSIG(ui->formatCombo, setCurrentIndex(format));
+
+  refreshUi();
 }
 
 ForwarderWidgetConfig const &
@@ -336,6 +780,7 @@ void
 ForwarderWidget::onOpen()
 {
   QStringList argList;
+  ForwarderSinkParams sinkParams;
   auto bandwidth  = m_spectrum->getBandwidth();
   auto loFreq     = m_spectrum->getLoFreq();
   auto centerFreq = m_spectrum->getCenterFreq();
@@ -352,6 +797,37 @@ ForwarderWidget::onOpen()
   ui->bandwidthSpin->blockSignals(bwBlocked);
   ui->frequencySpin->blockSignals(fcBlocked);
 
+  sinkParams.bufferSize = SCAST(size_t, m_config.bufferSize) << 20;
+  sinkParams.overflow   = SCAST(
+        ForwarderOverflowPolicy,
+        qMax(ui->overflowCombo->currentIndex(), 0));
+  sinkParams.address    = ui->addressEdit->text();
+  sinkParams.framed     = ui->framedCheck->isChecked();
+  sinkParams.metadata   = sinkParams.framed && ui->metadataCheck->isChecked();
+  sinkParams.splitSize  = SCAST(uint64_t, ui->splitSizeSpin->value()) << 20;
+  sinkParams.splitTime  = ui->splitTimeSpin->value();
+  sinkParams.direct     = ui->directCheck->isChecked();
+  m_forwarder->setSink(sinkType(), sinkParams);
+  m_forwarder->setSidecarPath(ui->sigmfEdit->text());
+  m_forwarder->setOutputFormat(
+        SCAST(SampleFormat, qMax(ui->formatCombo->currentIndex(), 0)),
+        SCAST(float, ui->scaleSpin->value()),
+        ui->ditherCheck->isChecked());
+  m_forwarder->setOutputRate(ui->outputRateSpin->value());
+  m_forwarder->setSupervised(ui->superviseCheck->isChecked());
+  m_forwarder->setReturnFormat(
+        SCAST(ReturnFormat, qMax(ui->returnCombo->currentIndex(), 0)));
+
+  bindStatsProperties();
+
+  if (ui->returnCombo->currentIndex() > RETURN_FORMAT_NONE) {
+    bindReturnProperty();
+    ui->returnLabel->setText("Waiting for " + returnPropertyName());
+  } else {
+    m_propReturn = nullptr;
+    ui->returnLabel->setText("Not read");
+  }
+
   if (!m_forwarder->run(
         programPath(),
         argList,
@@ -360,7 +836,9 @@ ForwarderWidget::onOpen()
     QMessageBox::warning(
           this,
           "Command failed",
-          "Cannot open a channel in the current state");
+          m_forwarder->isFollower()
+          ? "The preset that owns this channel must be opened first"
+          : "Cannot open a channel in the current state");
   }
 }
 
@@ -407,13 +885,45 @@ ForwarderWidget::onForwarderStateChanged(int state, QString const &desc)
     ui->bandwidthSpin->setMaximum(m_forwarder->getMaxBandwidth());
     ui->bandwidthSpin->setValue(m_forwarder->getTrueBandwidth());
     ui->bandwidthSpin->blockSignals(block);
+
+    BLOCKSIG(ui->frequencySpin, setValue(m_forwarder->getFrequency()));
   }
 
   ui->stateLabel->setText(desc);
+
+  if (state == PROCESS_FORWARDER_IDLE) {
+    // Leave the last figures on display
+    m_statsTimer->stop();
+  } else if (!m_statsTimer->isActive()) {
+    m_lastSamplesIn = 0;
+    m_lastWritten   = 0;
+    m_statsTime.start();
+    m_statsTimer->start();
+  }
+
   refreshNamedChannel();
   refreshUi();
 }
 
+void
+ForwarderWidget::onReturnReading(qreal mean, qreal, quint64 count)
+{
+  if (m_propReturn != nullptr)
+    m_propReturn->setValue(mean);
+
+  ui->returnLabel->setText(
+        QString::number(mean, 'g', 6)
+        + " (mean of "
+        + QString::number(count)
+        + (count == 1 ? " value)" : " values)"));
+}
+
+void
+ForwarderWidget::onStatsTimeout()
+{
+  refreshStats();
+}
+
 void
 ForwarderWidget::onBrowse()
 {
@@ -432,6 +942,30 @@ ForwarderWidget::onConfigChanged()
 {
   m_config.programPath = ui->programPathEdit->text().toStdString();
   m_config.arguments   = ui->argumentEdit->text().toStdString();
+  m_config.sink        = sinkType().toStdString();
+  m_config.bufferSize  = ui->bufferSizeSpin->value();
+  m_config.overflow    = overflowPolicy().toStdString();
+  m_config.format      = SampleConverter::formatName(
+        SCAST(SampleFormat, qMax(ui->formatCombo->currentIndex(), 0))).toStdString();
+  m_config.scale       = SCAST(float, ui->scaleSpin->value());
+  m_config.dither      = ui->ditherCheck->isChecked();
+  m_config.outputRate  = ui->outputRateSpin->value();
+  m_config.supervise   = ui->superviseCheck->isChecked();
+  m_config.splitSize   = ui->splitSizeSpin->value();
+  m_config.splitTime   = ui->splitTimeSpin->value();
+  m_config.direct      = ui->directCheck->isChecked();
+  m_config.address     = ui->addressEdit->text().toStdString();
+  m_config.framed      = ui->framedCheck->isChecked();
+  m_config.metadata    = ui->metadataCheck->isChecked();
+  m_config.sigmfPath   = ui->sigmfEdit->text().toStdString();
+  m_config.returnFormat = ReturnReader::formatName(
+        SCAST(ReturnFormat, qMax(ui->returnCombo->currentIndex(), 0))).toStdString();
+  m_config.returnProperty = ui->returnPropertyEdit->text().toStdString();
+  m_config.source      = ui->sourceCombo->currentIndex() > 0
+      ? ui->sourceCombo->currentData().toInt()
+      : -1;
+
+  refreshUi();
 
   emit configChanged();
 }
@@ -20,6 +20,8 @@
 #define FORWARDERWIDGET_H
 
 #include <QWidget>
+#include <QStringList>
+#include <QElapsedTimer>
 #include <Suscan/Library.h>
 #include <Suscan/Analyzer.h>
 
@@ -27,16 +29,37 @@ namespace Ui {
   class ForwarderWidget;
 }
 
+class QTimer;
+
 namespace SigDigger {
   class MainSpectrum;
   class UIMediator;
   class ProcessForwarder;
+  class GlobalProperty;
 
   class ForwarderWidgetConfig : public Suscan::Serializable {
   public:
     std::string title;
     std::string programPath;
     std::string arguments;
+    std::string sink = "pipe";  // pipe, shm, socket, file
+    int         bufferSize = 16; // MiB
+    std::string overflow = "drop-oldest"; // drop-oldest, drop-newest, pause
+    std::string format = "cf32"; // cf32, cf64, cs16, cs8
+    float       scale  = 1;
+    bool        dither = false;
+    int         source = -1; // Preset whose channel we share, -1: own channel
+    std::string address = "tcp:127.0.0.1:5555"; // Socket sink
+    bool        framed = false;
+    bool        metadata = false; // In-band, in the frame headers
+    std::string sigmfPath = "";   // Sidecar, empty: none
+    SUFREQ      outputRate = 0;   // sps, 0: channel rate
+    bool        supervise = false;
+    int         splitSize = 0;    // MiB, 0: never (file sink)
+    int         splitTime = 0;    // Seconds, 0: never (file sink)
+    bool        direct = false;   // O_DIRECT (file sink)
+    std::string returnFormat = "none"; // none, text, f32, f64, cf32
+    std::string returnProperty = "";   // Empty: derived from the title
 
     // Overriden methods
     void deserialize(Suscan::Object const &conf) override;
@@ -57,10 +80,30 @@ namespace SigDigger {
 
     ForwarderWidgetConfig m_config;
 
+    // Where the output of the program is published
+    GlobalProperty   *m_propReturn = nullptr;
+
+    // Throughput counters, sampled at a low rate
+    QTimer           *m_statsTimer    = nullptr;
+    QElapsedTimer     m_statsTime;
+    quint64           m_lastSamplesIn = 0;
+    quint64           m_lastWritten   = 0;
+    GlobalProperty   *m_propRateIn    = nullptr;
+    GlobalProperty   *m_propRateOut   = nullptr;
+    GlobalProperty   *m_propPending   = nullptr;
+    GlobalProperty   *m_propDropped   = nullptr;
+    GlobalProperty   *m_propRestarts  = nullptr;
+    GlobalProperty   *m_propLatency   = nullptr;
+
     void refreshUi();
     void connectAll();
     void refreshNamedChannel();
     void applySpectrumState();
+    QString propertyPrefix() const;
+    QString returnPropertyName() const;
+    void bindReturnProperty();
+    void bindStatsProperties();
+    void refreshStats();
 
   public:
     explicit ForwarderWidget(UIMediator *, QWidget *parent = nullptr);
@@ -69,6 +112,11 @@ namespace SigDigger {
     void setState(int, Suscan::Analyzer *);
     void setProgramPath(QString const &);
     void setArguments(QString const &);
+    void setSinkType(QString const &);
+    void setOverflowPolicy(QString const &);
+    void setSourceList(QStringList const &titles, int self);
+    void setSourceForwarder(ProcessForwarder *);
+    ProcessForwarder *forwarder() const;
     void setFrequency(qreal);
     void setBandwidth(qreal);
 
@@ -76,6 +124,8 @@ namespace SigDigger {
     void mouseDoubleClickEvent(QMouseEvent *) override;
     QString programPath() const;
     QString arguments() const;
+    QString sinkType() const;
+    QString overflowPolicy() const;
 
     void setConfig(ForwarderWidgetConfig const &);
     ForwarderWidgetConfig const &getConfig() const;
@@ -94,6 +144,8 @@ namespace SigDigger {
     void onAdjustFrequency();
 
     void onForwarderStateChanged(int, QString const &);
+    void onReturnReading(qreal, qreal, quint64);
+    void onStatsTimeout();
     void onConfigChanged();
 
   private:
@@ -0,0 +1,193 @@
+//
+//    HookExecutor.cpp: Rate-limited event hooks run off the GUI thread
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "HookExecutor.h"
+#include <SigDiggerHelpers.h>
+#include <QProcess>
+#include <sigutils/log.h>
+#include <sigutils/types.h>
+
+using namespace SigDigger;
+
+HookExecutor::HookExecutor(QObject *parent) : QThread(parent)
+{
+  m_clock.start();
+}
+
+HookExecutor::~HookExecutor()
+{
+  stop();
+}
+
+void
+HookExecutor::setProgram(QString const &path, QString const &argTemplate)
+{
+  QStringList args;
+
+  SigDiggerHelpers::tokenize(argTemplate, args);
+
+  QMutexLocker locker(&m_mutex);
+  m_program     = path;
+  m_argTemplate = args;
+}
+
+void
+HookExecutor::setCallback(HookCallback const &callback)
+{
+  QMutexLocker locker(&m_mutex);
+  m_callback = callback;
+}
+
+void
+HookExecutor::setDebounce(unsigned ms)
+{
+  QMutexLocker locker(&m_mutex);
+  m_debounce = ms;
+}
+
+void
+HookExecutor::setMinInterval(unsigned ms)
+{
+  QMutexLocker locker(&m_mutex);
+  m_minInterval = ms;
+}
+
+void
+HookExecutor::setMaxQueue(int max)
+{
+  QMutexLocker locker(&m_mutex);
+  m_maxQueue = max < 1 ? 1 : max;
+}
+
+quint64
+HookExecutor::droppedCount()
+{
+  QMutexLocker locker(&m_mutex);
+  return m_dropped;
+}
+
+void
+HookExecutor::trigger()
+{
+  HookJob job;
+  QStringList argTemplate;
+
+  {
+    QMutexLocker locker(&m_mutex);
+    argTemplate = m_argTemplate;
+  }
+
+  // Global properties belong to the GUI, expand them here
+  for (auto const &arg : argTemplate) {
+    if (arg.contains('%'))
+      job.args.append(SigDiggerHelpers::expandGlobalProperties(arg));
+    else
+      job.args.append(arg);
+  }
+
+  QMutexLocker locker(&m_mutex);
+  qint64 now = m_clock.elapsed();
+
+  job.due = now + m_debounce;
+
+  if (!m_queue.isEmpty() && now < m_queue.last().due) {
+    // Still bouncing, merge with the pending one. It keeps its due time,
+    // or an event that keeps flapping would never run.
+    m_queue.last().args = job.args;
+  } else if (m_queue.size() >= m_maxQueue) {
+    if (m_dropped++ == 0)
+      SU_WARNING("Hook queue is full, dropping events\n");
+    return;
+  } else {
+    m_queue.enqueue(job);
+  }
+
+  if (!isRunning() && !m_stopping)
+    start();
+
+  m_cond.wakeOne();
+}
+
+void
+HookExecutor::stop()
+{
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+    m_queue.clear();
+    m_cond.wakeOne();
+  }
+
+  wait();
+
+  QMutexLocker locker(&m_mutex);
+  m_stopping = false;
+}
+
+void
+HookExecutor::execute(
+    HookJob const &job,
+    HookCallback const &callback,
+    QString const &program)
+{
+  if (callback)
+    callback(job.args);
+
+  if (!program.isEmpty() && !QProcess::startDetached(program, job.args)) {
+    std::string path = program.toStdString();
+    SU_ERROR("Failed to run hook program %s\n", path.c_str());
+  }
+}
+
+void
+HookExecutor::run()
+{
+  QMutexLocker locker(&m_mutex);
+
+  while (!m_stopping) {
+    HookJob job;
+    HookCallback callback;
+    QString program;
+    qint64 now, due;
+
+    if (m_queue.isEmpty()) {
+      m_cond.wait(&m_mutex);
+      continue;
+    }
+
+    now = m_clock.elapsed();
+    due = m_queue.head().due;
+
+    if (m_lastRun >= 0 && due < m_lastRun + m_minInterval)
+      due = m_lastRun + m_minInterval;
+
+    if (now < due) {
+      m_cond.wait(&m_mutex, SCAST(unsigned long, due - now));
+      continue;
+    }
+
+    job       = m_queue.dequeue();
+    callback  = m_callback;
+    program   = m_program;
+    m_lastRun = now;
+
+    locker.unlock();
+    execute(job, callback, program);
+    locker.relock();
+  }
+}
@@ -0,0 +1,93 @@
+//
+//    HookExecutor.h: Rate-limited event hooks run off the GUI thread
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef HOOKEXECUTOR_H
+#define HOOKEXECUTOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QQueue>
+#include <functional>
+
+namespace SigDigger {
+  typedef std::function<void (QStringList const &)> HookCallback;
+
+  struct HookJob {
+    QStringList args;
+    qint64      due = 0; // ms, executor clock
+  };
+
+  //
+  // Runs a hook (an external program, an in-process callback, or both)
+  // when an event is triggered. The argument template is tokenized once,
+  // and global properties are expanded at trigger time, in the caller's
+  // thread. Everything else happens in a long-lived worker thread:
+  //
+  //  - Triggers arriving within the debounce window of a pending one are
+  //    merged into it, keeping the most recent arguments. It still runs
+  //    when it was due.
+  //  - Consecutive runs are at least minInterval apart.
+  //  - At most maxQueue jobs wait to run; newer triggers are dropped.
+  //
+  // Programs are started detached, so there is nothing to reap.
+  //
+  class HookExecutor : public QThread
+  {
+    Q_OBJECT
+
+    QString      m_program;
+    QStringList  m_argTemplate;
+    HookCallback m_callback;
+
+    QMutex         m_mutex;
+    QWaitCondition m_cond;
+    QQueue<HookJob> m_queue;
+    QElapsedTimer  m_clock;
+    qint64         m_lastRun  = -1;
+    bool           m_stopping = false;
+
+    unsigned m_debounce    = 500;  // ms
+    unsigned m_minInterval = 2000; // ms
+    int      m_maxQueue    = 4;
+    quint64  m_dropped     = 0;
+
+    void execute(HookJob const &, HookCallback const &, QString const &);
+
+  protected:
+    void run() override;
+
+  public:
+    HookExecutor(QObject *parent = nullptr);
+    ~HookExecutor() override;
+
+    void setProgram(QString const &path, QString const &argTemplate);
+    void setCallback(HookCallback const &);
+    void setDebounce(unsigned ms);
+    void setMinInterval(unsigned ms);
+    void setMaxQueue(int);
+
+    quint64 droppedCount();
+    void trigger();
+    void stop();
+  };
+}
+
+#endif // HOOKEXECUTOR_H
@@ -0,0 +1,228 @@
+//
+//    NoiseWindowLocator.cpp: Find quiet spots in the spectrum
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "NoiseWindowLocator.h"
+#include <SuWidgetsHelpers.h>
+#include <cmath>
+
+// Do not trust the average until we have seen this many frames
+#define NOISE_LOCATOR_MIN_FRAMES 4
+
+using namespace SigDigger;
+
+NoiseWindowLocator::NoiseWindowLocator(QObject *parent) : QObject(parent)
+{
+}
+
+void
+NoiseWindowLocator::setAnalyzer(Suscan::Analyzer *analyzer)
+{
+  if (m_analyzer != nullptr)
+    disconnect(m_analyzer, nullptr, this, nullptr);
+
+  m_analyzer = analyzer;
+  reset();
+
+  if (m_analyzer != nullptr)
+    connect(
+          m_analyzer,
+          SIGNAL(psd_message(const Suscan::PSDMessage &)),
+          this,
+          SLOT(onPSDMessage(const Suscan::PSDMessage &)));
+}
+
+void
+NoiseWindowLocator::setAveraging(qreal alpha)
+{
+  m_alpha = alpha;
+}
+
+void
+NoiseWindowLocator::setSearch(qreal center, qreal exclusion, qreal span)
+{
+  m_center    = center;
+  m_exclusion = exclusion;
+  m_span      = span;
+}
+
+void
+NoiseWindowLocator::setSpreadWeight(qreal weight)
+{
+  m_spreadWeight = weight;
+}
+
+void
+NoiseWindowLocator::reset()
+{
+  m_psd.clear();
+  m_frames = 0;
+}
+
+bool
+NoiseWindowLocator::haveSpectrum() const
+{
+  return m_frames >= NOISE_LOCATOR_MIN_FRAMES;
+}
+
+qreal
+NoiseWindowLocator::binWidth() const
+{
+  return m_psdRate / m_psd.size();
+}
+
+// PSD bins are assumed to be in display order, from -fs/2 to +fs/2
+qreal
+NoiseWindowLocator::binFrequency(qreal bin) const
+{
+  return m_psdFrequency - .5 * m_psdRate + bin * binWidth();
+}
+
+void
+NoiseWindowLocator::buildPrefixSums()
+{
+  int size = m_psd.size();
+  qreal sum = 0, sumSq = 0;
+
+  m_sum.resize(size + 1);
+  m_sumSq.resize(size + 1);
+
+  m_sum[0] = m_sumSq[0] = 0;
+
+  for (int i = 0; i < size; ++i) {
+    qreal db = SCAST(qreal, SU_POWER_DB_RAW(SU_ASFLOAT(m_psd[i] + 1e-30)));
+    sum   += db;
+    sumSq += db * db;
+
+    m_sum[i + 1]   = sum;
+    m_sumSq[i + 1] = sumSq;
+  }
+}
+
+bool
+NoiseWindowLocator::windowAt(int first, int count, NoiseWindow &window) const
+{
+  qreal mean, var;
+
+  if (count < 1 || first < 0 || first + count > m_psd.size())
+    return false;
+
+  mean = (m_sum[first + count] - m_sum[first]) / count;
+  var  = (m_sumSq[first + count] - m_sumSq[first]) / count - mean * mean;
+
+  window.frequency = binFrequency(first + .5 * count);
+  window.bandwidth = count * binWidth();
+  window.level     = mean;
+  window.spread    = var > 0 ? sqrt(var) : 0;
+  window.score     = mean + m_spreadWeight * window.spread;
+
+  return true;
+}
+
+bool
+NoiseWindowLocator::locate(qreal bandwidth, NoiseWindow &best)
+{
+  int count, first, last;
+  int exclFirst, exclLast;
+  bool found = false;
+  NoiseWindow current;
+
+  if (!haveSpectrum() || bandwidth <= 0)
+    return false;
+
+  count = SCAST(int, ceil(bandwidth / binWidth()));
+  if (count < 1)
+    count = 1;
+
+  // Search range and excluded range, in bins
+  first = SCAST(int, floor((m_center - m_psdFrequency - .5 * m_span) / binWidth()))
+      + m_psd.size() / 2;
+  last  = SCAST(int, ceil((m_center - m_psdFrequency + .5 * m_span) / binWidth()))
+      + m_psd.size() / 2;
+
+  exclFirst = SCAST(int, floor((m_center - m_psdFrequency - m_exclusion) / binWidth()))
+      + m_psd.size() / 2;
+  exclLast  = SCAST(int, ceil((m_center - m_psdFrequency + m_exclusion) / binWidth()))
+      + m_psd.size() / 2;
+
+  first = qBound(0, first, m_psd.size());
+  last  = qBound(0, last, m_psd.size());
+
+  buildPrefixSums();
+
+  for (int i = first; i + count <= last; ++i) {
+    // Windows overlapping the excluded range are skipped altogether
+    if (m_exclusion > 0 && i < exclLast && i + count > exclFirst) {
+      i = exclLast - 1;
+      continue;
+    }
+
+    if (windowAt(i, count, current) && (!found || current.score < best.score)) {
+      best  = current;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+bool
+NoiseWindowLocator::evaluate(qreal frequency, qreal bandwidth, NoiseWindow &window)
+{
+  int count, first;
+
+  if (!haveSpectrum() || bandwidth <= 0)
+    return false;
+
+  count = SCAST(int, ceil(bandwidth / binWidth()));
+  if (count < 1)
+    count = 1;
+
+  first = SCAST(int, round((frequency - m_psdFrequency) / binWidth() - .5 * count))
+      + m_psd.size() / 2;
+
+  buildPrefixSums();
+
+  return windowAt(first, count, window);
+}
+
+void
+NoiseWindowLocator::onPSDMessage(Suscan::PSDMessage const &msg)
+{
+  const SUFLOAT *data = msg.get();
+  int size = SCAST(int, msg.size());
+  qreal freq = SCAST(qreal, msg.getFrequency());
+  qreal rate = SCAST(qreal, msg.getSampleRate());
+
+  // Start over if the tuner or the FFT have changed
+  if (size != m_psd.size() || freq != m_psdFrequency || rate != m_psdRate) {
+    m_psd.resize(size);
+    m_psdFrequency = freq;
+    m_psdRate      = rate;
+    m_frames       = 0;
+  }
+
+  if (m_frames == 0) {
+    for (int i = 0; i < size; ++i)
+      m_psd[i] = SCAST(qreal, data[i]);
+  } else {
+    for (int i = 0; i < size; ++i)
+      SU_SPLPF_FEED(m_psd[i], SCAST(qreal, data[i]), m_alpha);
+  }
+
+  ++m_frames;
+}
@@ -0,0 +1,94 @@
+//
+//    NoiseWindowLocator.h: Find quiet spots in the spectrum
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef NOISEWINDOWLOCATOR_H
+#define NOISEWINDOWLOCATOR_H
+
+#include <QObject>
+#include <QVector>
+#include <Suscan/Library.h>
+#include <Suscan/Analyzer.h>
+
+namespace Suscan {
+  class Analyzer;
+};
+
+namespace SigDigger {
+  struct NoiseWindow {
+    qreal frequency = 0; // Absolute
+    qreal bandwidth = 0;
+    qreal level     = 0; // Mean PSD level inside the window (dB)
+    qreal spread    = 0; // Standard deviation of the PSD level (dB)
+    qreal score     = 0; // Lower is better
+  };
+
+  //
+  // Keeps a running average of the PSD frames delivered by the analyzer
+  // and, on request, slides a window of the desired bandwidth over it
+  // looking for the spot with the lowest level and the lowest ripple
+  // (i.e. away from spurs and carriers). Averaging is O(N) per frame and
+  // every search is O(N) thanks to prefix sums, so this can be queried
+  // every few seconds without noticeable cost.
+  //
+  class NoiseWindowLocator : public QObject
+  {
+    Q_OBJECT
+
+    Suscan::Analyzer *m_analyzer = nullptr;
+
+    // Averaged PSD (linear units)
+    QVector<qreal> m_psd;
+    qreal    m_psdFrequency = 0;
+    qreal    m_psdRate      = 0;
+    unsigned m_frames       = 0;
+    qreal    m_alpha        = .1;
+
+    // Search parameters
+    qreal    m_center       = 0;
+    qreal    m_exclusion    = 0;
+    qreal    m_span         = 50e3;
+    qreal    m_spreadWeight = 2;
+
+    // Prefix sums of the PSD (dB) and its square
+    QVector<qreal> m_sum;
+    QVector<qreal> m_sumSq;
+
+    void  buildPrefixSums();
+    qreal binWidth() const;
+    qreal binFrequency(qreal) const;
+    bool  windowAt(int first, int count, NoiseWindow &) const;
+
+  public:
+    explicit NoiseWindowLocator(QObject *parent = nullptr);
+
+    void setAnalyzer(Suscan::Analyzer *);
+    void setAveraging(qreal alpha);
+    void setSearch(qreal center, qreal exclusion, qreal span);
+    void setSpreadWeight(qreal);
+    void reset();
+
+    bool haveSpectrum() const;
+    bool locate(qreal bandwidth, NoiseWindow &);
+    bool evaluate(qreal frequency, qreal bandwidth, NoiseWindow &);
+
+  public slots:
+    void onPSDMessage(Suscan::PSDMessage const &);
+  };
+}
+
+#endif // NOISEWINDOWLOCATOR_H
@@ -0,0 +1,592 @@
+//
+//    PSDProcessor.cpp: Synchronous S+N and N power from a single PSD
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "PSDProcessor.h"
+#include <UIMediator.h>
+#include <SuWidgetsHelpers.h>
+#include <Suscan/AnalyzerRequestTracker.h>
+#include <cmath>
+
+// Extra room around both windows, so that the channel filter does not
+// eat the edges
+#define PSD_PROCESSOR_CHANNEL_MARGIN 1.2
+
+// Equivalent noise bandwidth of the Hann window, in bins
+#define PSD_PROCESSOR_HANN_ENBW      1.5
+
+// Bins per window (at least) and PSD size limits
+#define PSD_PROCESSOR_MIN_BINS       16
+#define PSD_PROCESSOR_MIN_SIZE       256
+#define PSD_PROCESSOR_MAX_SIZE       65536
+
+using namespace SigDigger;
+
+PSDProcessor::PSDProcessor(UIMediator *mediator, QObject *parent)
+  : QObject{parent}
+{
+  m_mediator = mediator;
+  m_tracker = new Suscan::AnalyzerRequestTracker(this);
+
+  for (int i = 0; i < PSD_PROCESSOR_WINDOW_COUNT; ++i) {
+    m_firstBin[i] = 0;
+    m_binCount[i] = 0;
+    m_accum[i]    = 0;
+    m_reading[i]  = 0;
+  }
+
+  this->connectAll();
+
+  this->setState(PSD_PROCESSOR_IDLE, "Idle");
+}
+
+PSDProcessor::~PSDProcessor()
+{
+  releasePSD();
+}
+
+void
+PSDProcessor::connectAll()
+{
+  connect(
+        this->m_tracker,
+        SIGNAL(opened(Suscan::AnalyzerRequest const &)),
+        this,
+        SLOT(onOpened(Suscan::AnalyzerRequest const &)));
+
+  connect(
+        this->m_tracker,
+        SIGNAL(cancelled(Suscan::AnalyzerRequest const &)),
+        this,
+        SLOT(onCancelled(Suscan::AnalyzerRequest const &)));
+
+  connect(
+        this->m_tracker,
+        SIGNAL(error(Suscan::AnalyzerRequest const &, const std::string &)),
+        this,
+        SLOT(onError(Suscan::AnalyzerRequest const &, const std::string &)));
+}
+
+void
+PSDProcessor::disconnectAnalyzer()
+{
+  disconnect(m_analyzer, nullptr, this, nullptr);
+
+  this->setState(PSD_PROCESSOR_IDLE, "Analyzer closed");
+}
+
+void
+PSDProcessor::connectAnalyzer()
+{
+  connect(
+        m_analyzer,
+        SIGNAL(inspector_message(const Suscan::InspectorMessage &)),
+        this,
+        SLOT(onInspectorMessage(const Suscan::InspectorMessage &)));
+
+  connect(
+        m_analyzer,
+        SIGNAL(samples_message(const Suscan::SamplesMessage &)),
+        this,
+        SLOT(onInspectorSamples(const Suscan::SamplesMessage &)));
+}
+
+void
+PSDProcessor::closeChannel()
+{
+  if (m_analyzer != nullptr && m_inspHandle != -1)
+    m_analyzer->closeInspector(m_inspHandle);
+
+  m_inspHandle = -1;
+}
+
+void
+PSDProcessor::setState(PSDProcessorState state, QString const &msg)
+{
+  if (m_state != state) {
+    m_state = state;
+
+    switch (state) {
+      case PSD_PROCESSOR_IDLE:
+        if (m_inspHandle != -1)
+          this->closeChannel();
+
+        m_inspId          = 0xffffffff;
+        m_equivSampleRate = 0;
+        m_fullSampleRate  = 0;
+        m_chanRBW         = 0;
+        m_haveReading     = false;
+        releasePSD();
+        break;
+
+      default:
+        break;
+    }
+
+    emit stateChanged(state, msg);
+  }
+}
+
+//
+// The channel is centered between both windows, and covers them entirely
+//
+bool
+PSDProcessor::computeChannel()
+{
+  qreal lo = +INFINITY;
+  qreal hi = -INFINITY;
+
+  for (auto &w : m_windows) {
+    if (w.bandwidth <= 0)
+      return false;
+
+    lo = fmin(lo, w.frequency - .5 * w.bandwidth);
+    hi = fmax(hi, w.frequency + .5 * w.bandwidth);
+  }
+
+  m_channelFrequency = .5 * (lo + hi);
+  m_channelBandwidth = PSD_PROCESSOR_CHANNEL_MARGIN * (hi - lo);
+
+  return true;
+}
+
+bool
+PSDProcessor::allocatePSD()
+{
+  qreal narrowest = fmin(
+        m_windows[PSD_PROCESSOR_SIGNAL_NOISE].bandwidth,
+        m_windows[PSD_PROCESSOR_NOISE].bandwidth);
+  qreal wanted = m_equivSampleRate / (narrowest / PSD_PROCESSOR_MIN_BINS);
+  unsigned size = PSD_PROCESSOR_MIN_SIZE;
+  qreal sumSq = 0;
+
+  while (size < wanted && size < PSD_PROCESSOR_MAX_SIZE)
+    size <<= 1;
+
+  if (size == m_size && m_plan != nullptr)
+    return true;
+
+  releasePSD();
+
+  m_buffer = SCAST(
+        SU_FFTW(_complex) *,
+        SU_FFTW(_malloc)(size * sizeof(SU_FFTW(_complex))));
+  if (m_buffer == nullptr)
+    return false;
+
+  m_plan = SU_FFTW(_plan_dft_1d)(
+        SCAST(int, size),
+        m_buffer,
+        m_buffer,
+        FFTW_FORWARD,
+        FFTW_ESTIMATE);
+  if (m_plan == nullptr) {
+    releasePSD();
+    return false;
+  }
+
+  // Hann window. With this scaling, the sum of all bins is the mean power
+  // of the frame, and partial sums are the power in each window.
+  m_window.resize(SCAST(int, size));
+  for (unsigned i = 0; i < size; ++i) {
+    m_window[SCAST(int, i)] = SU_ASFLOAT(.5 - .5 * cos(2 * M_PI * i / size));
+    sumSq += SCAST(qreal, m_window[SCAST(int, i)] * m_window[SCAST(int, i)]);
+  }
+
+  m_size     = size;
+  m_psdScale = 1. / (size * sumSq);
+  m_filled   = 0;
+
+  return true;
+}
+
+void
+PSDProcessor::releasePSD()
+{
+  if (m_plan != nullptr) {
+    SU_FFTW(_destroy_plan)(m_plan);
+    m_plan = nullptr;
+  }
+
+  if (m_buffer != nullptr) {
+    SU_FFTW(_free)(m_buffer);
+    m_buffer = nullptr;
+  }
+
+  m_size = 0;
+}
+
+void
+PSDProcessor::configureWindows()
+{
+  qreal binWidth = m_equivSampleRate / m_size;
+  int   half     = SCAST(int, m_size / 2);
+
+  for (int i = 0; i < PSD_PROCESSOR_WINDOW_COUNT; ++i) {
+    qreal delta = m_windows[i].frequency - m_channelFrequency;
+    qreal halfBw = .5 * m_windows[i].bandwidth;
+    int first = SCAST(int, ceil((delta - halfBw) / binWidth));
+    int last  = SCAST(int, floor((delta + halfBw) / binWidth));
+
+    if (last < first)
+      first = last = SCAST(int, round(delta / binWidth));
+
+    first = qBound(-half, first, half - 1);
+    last  = qBound(-half, last,  half - 1);
+
+    m_firstBin[i] = first;
+    m_binCount[i] = last - first + 1;
+    m_accum[i]    = 0;
+  }
+
+  m_frames = 0;
+}
+
+void
+PSDProcessor::configureIntegration()
+{
+  m_framesPerUpdate = SCAST(
+        unsigned,
+        round(m_desiredFeedback * m_equivSampleRate / m_size));
+
+  if (m_framesPerUpdate < 1)
+    m_framesPerUpdate = 1;
+
+  m_trueFeedback = m_framesPerUpdate * m_size / m_equivSampleRate;
+  m_alpha        = SCAST(qreal, SU_SPLPF_ALPHA(SU_ASFLOAT(m_desiredTau / m_trueFeedback)));
+  m_haveReading  = false;
+  m_frames       = 0;
+
+  for (auto &acc : m_accum)
+    acc = 0;
+}
+
+void
+PSDProcessor::processFrame()
+{
+  SU_FFTW(_execute)(m_plan);
+
+  for (int i = 0; i < PSD_PROCESSOR_WINDOW_COUNT; ++i) {
+    qreal sum = 0;
+
+    for (int k = m_firstBin[i]; k < m_firstBin[i] + m_binCount[i]; ++k) {
+      unsigned bin = SCAST(unsigned, k < 0 ? k + SCAST(int, m_size) : k);
+      qreal re = SCAST(qreal, m_buffer[bin][0]);
+      qreal im = SCAST(qreal, m_buffer[bin][1]);
+      sum += re * re + im * im;
+    }
+
+    m_accum[i] += sum;
+  }
+
+  if (++m_frames >= m_framesPerUpdate)
+    flushReadings();
+}
+
+void
+PSDProcessor::flushReadings()
+{
+  if (m_haveReading)
+    m_weightSq = (1 - m_alpha) * (1 - m_alpha) * m_weightSq + m_alpha * m_alpha;
+  else
+    m_weightSq = 1;
+
+  for (int i = 0; i < PSD_PROCESSOR_WINDOW_COUNT; ++i) {
+    qreal power = m_accum[i] * m_psdScale / m_frames;
+
+    if (m_haveReading)
+      SU_SPLPF_FEED(m_reading[i], power, m_alpha);
+    else
+      m_reading[i] = power;
+
+    m_accum[i] = 0;
+  }
+
+  m_frames      = 0;
+  m_haveReading = true;
+
+  emit measurement(
+        m_reading[PSD_PROCESSOR_SIGNAL_NOISE],
+        m_reading[PSD_PROCESSOR_NOISE]);
+}
+
+bool
+PSDProcessor::openChannel()
+{
+  Suscan::Channel ch;
+
+  if (!computeChannel())
+    return false;
+
+  ch.bw    = m_channelBandwidth;
+  ch.fc    = m_channelFrequency - m_analyzer->getFrequency();
+  ch.fLow  = -.5 * m_channelBandwidth;
+  ch.fHigh = +.5 * m_channelBandwidth;
+
+  if (!m_tracker->requestOpen("raw", ch))
+    return false;
+
+  this->setState(PSD_PROCESSOR_OPENING, "Opening inspector...");
+
+  return true;
+}
+
+///////////////////////////////// Public API //////////////////////////////////
+PSDProcessorState
+PSDProcessor::state() const
+{
+  return m_state;
+}
+
+void
+PSDProcessor::setFFTSizeHint(unsigned int fftSize)
+{
+  m_fftSizeHint = fftSize;
+}
+
+void
+PSDProcessor::setAnalyzer(Suscan::Analyzer *analyzer)
+{
+  if (m_analyzer != nullptr)
+    this->disconnectAnalyzer();
+
+  m_analyzer = nullptr;
+  if (analyzer == nullptr)
+    this->setState(PSD_PROCESSOR_IDLE, "Capture stopped");
+  else
+    this->setState(PSD_PROCESSOR_IDLE, "Analyzer changed");
+
+  m_analyzer = analyzer;
+
+  if (m_analyzer != nullptr)
+    connectAnalyzer();
+
+  m_tracker->setAnalyzer(analyzer);
+}
+
+bool
+PSDProcessor::isRunning() const
+{
+  return m_state != PSD_PROCESSOR_IDLE;
+}
+
+bool
+PSDProcessor::cancel()
+{
+  if (isRunning()) {
+    if (m_state == PSD_PROCESSOR_OPENING)
+      m_tracker->cancelAll();
+    this->setState(PSD_PROCESSOR_IDLE, "Cancelled by user");
+
+    return true;
+  }
+
+  return false;
+}
+
+void
+PSDProcessor::setTau(qreal desiredTau)
+{
+  m_desiredTau = desiredTau;
+
+  if (m_state == PSD_PROCESSOR_STREAMING)
+    configureIntegration();
+}
+
+bool
+PSDProcessor::setWindows(PSDWindow const &signalNoise, PSDWindow const &noise)
+{
+  m_windows[PSD_PROCESSOR_SIGNAL_NOISE] = signalNoise;
+  m_windows[PSD_PROCESSOR_NOISE]        = noise;
+
+  if (m_state != PSD_PROCESSOR_STREAMING)
+    return true;
+
+  if (!computeChannel())
+    return false;
+
+  // Still fits in the current channel rate: just move it around
+  if (m_channelBandwidth <= m_equivSampleRate) {
+    m_analyzer->setInspectorFreq(
+          m_inspHandle,
+          m_channelFrequency - m_analyzer->getFrequency());
+    m_analyzer->setInspectorBandwidth(
+          m_inspHandle,
+          m_chanRBW * ceil(m_channelBandwidth / m_chanRBW));
+
+    if (!allocatePSD()) {
+      this->setState(PSD_PROCESSOR_IDLE, "Cannot allocate PSD");
+      return false;
+    }
+
+    // Nothing measured at the old position may leak into the new one:
+    // start over with an empty frame, accumulator and average.
+    configureWindows();
+    configureIntegration();
+    m_filled = 0;
+
+    return true;
+  }
+
+  // Otherwise, we need a different decimation
+  this->setState(PSD_PROCESSOR_IDLE, "Reopening channel");
+  return openChannel();
+}
+
+qreal
+PSDProcessor::getTrueWidth(PSDProcessorWindow window) const
+{
+  if (m_state == PSD_PROCESSOR_STREAMING && m_size > 0)
+    return m_binCount[window] * m_equivSampleRate / m_size;
+
+  return m_windows[window].bandwidth;
+}
+
+qreal
+PSDProcessor::getTrueFeedbackInterval() const
+{
+  return m_trueFeedback;
+}
+
+unsigned
+PSDProcessor::getPSDSize() const
+{
+  return m_size;
+}
+
+//
+// Adjacent bins of a Hann-windowed PSD are correlated, so a window of n
+// bins holds about n / ENBW independent ones per frame.
+//
+qreal
+PSDProcessor::getDegreesOfFreedom(PSDProcessorWindow window) const
+{
+  qreal indep;
+
+  if (!m_haveReading)
+    return 0;
+
+  indep = fmax(1., m_binCount[window] / PSD_PROCESSOR_HANN_ENBW);
+
+  return 2 * indep * m_framesPerUpdate / m_weightSq;
+}
+
+bool
+PSDProcessor::startStreaming(PSDWindow const &signalNoise, PSDWindow const &noise)
+{
+  if (this->isRunning())
+    return false;
+
+  if (m_analyzer == nullptr)
+    return false;
+
+  m_windows[PSD_PROCESSOR_SIGNAL_NOISE] = signalNoise;
+  m_windows[PSD_PROCESSOR_NOISE]        = noise;
+
+  return openChannel();
+}
+
+///////////////////////////// Analyzer slots //////////////////////////////////
+void
+PSDProcessor::onInspectorMessage(Suscan::InspectorMessage const &msg)
+{
+  if (msg.getInspectorId() == m_inspId) {
+    switch (msg.getKind()) {
+      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_CLOSE:
+        m_inspHandle = -1;
+        this->setState(PSD_PROCESSOR_IDLE, "Inspector closed");
+        break;
+
+      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND:
+      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_OBJECT:
+      case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE:
+        this->setState(PSD_PROCESSOR_IDLE, "Error during channel opening");
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+void
+PSDProcessor::onInspectorSamples(Suscan::SamplesMessage const &msg)
+{
+  if (msg.getInspectorId() == m_inspId && m_state == PSD_PROCESSOR_STREAMING) {
+    const SUCOMPLEX *samples = msg.getSamples();
+    unsigned int count = msg.getCount();
+    unsigned int i;
+    SUCOMPLEX x;
+
+    for (i = 0; i < count; ++i) {
+      x = samples[i] * m_window[SCAST(int, m_filled)];
+      m_buffer[m_filled][0] = SU_C_REAL(x);
+      m_buffer[m_filled][1] = SU_C_IMAG(x);
+
+      if (++m_filled == m_size) {
+        processFrame();
+        m_filled = 0;
+      }
+    }
+  }
+}
+
+////////////////////////////// Processor slots ////////////////////////////////
+void
+PSDProcessor::onOpened(Suscan::AnalyzerRequest const &req)
+{
+  if (m_analyzer != nullptr) {
+    m_inspHandle      = req.handle;
+    m_inspId          = req.inspectorId;
+    m_fullSampleRate  = SCAST(qreal, req.basebandRate);
+    m_equivSampleRate = SCAST(qreal, req.equivRate);
+    m_chanRBW         = m_fullSampleRate / m_fftSizeHint;
+
+    m_analyzer->setInspectorBandwidth(
+          m_inspHandle,
+          m_chanRBW * ceil(m_channelBandwidth / m_chanRBW));
+
+    if (m_channelBandwidth > m_equivSampleRate) {
+      this->setState(PSD_PROCESSOR_IDLE, "Windows are too far apart");
+      return;
+    }
+
+    if (!allocatePSD()) {
+      this->setState(PSD_PROCESSOR_IDLE, "Cannot allocate PSD");
+      return;
+    }
+
+    configureWindows();
+    configureIntegration();
+
+    this->setState(PSD_PROCESSOR_STREAMING, "Channel opened");
+  }
+}
+
+void
+PSDProcessor::onCancelled(Suscan::AnalyzerRequest const &)
+{
+  this->setState(PSD_PROCESSOR_IDLE, "Cancelled");
+}
+
+void
+PSDProcessor::onError(Suscan::AnalyzerRequest const &, std::string const &err)
+{
+  this->setState(
+        PSD_PROCESSOR_IDLE,
+        "Failed to open inspector: " + QString::fromStdString(err));
+}
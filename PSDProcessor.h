@@ -0,0 +1,152 @@
+//
+//    PSDProcessor.h: Synchronous S+N and N power from a single PSD
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef PSDPROCESSOR_H
+#define PSDPROCESSOR_H
+
+#include <QObject>
+#include <QVector>
+#include <Suscan/Library.h>
+#include <Suscan/Analyzer.h>
+#include <fftw3.h>
+
+namespace Suscan {
+  class Analyzer;
+  class AnalyzerRequestTracker;
+  struct AnalyzerRequest;
+};
+
+namespace SigDigger {
+  class UIMediator;
+
+  enum PSDProcessorState {
+    PSD_PROCESSOR_IDLE,       // Channel closed
+    PSD_PROCESSOR_OPENING,    // Have request Id, open() sent
+    PSD_PROCESSOR_STREAMING,  // Inspector opened, computing PSDs
+  };
+
+  enum PSDProcessorWindow {
+    PSD_PROCESSOR_SIGNAL_NOISE,
+    PSD_PROCESSOR_NOISE,
+    PSD_PROCESSOR_WINDOW_COUNT
+  };
+
+  struct PSDWindow {
+    qreal frequency = 0; // Absolute
+    qreal bandwidth = 0;
+  };
+
+  //
+  // Opens a single raw inspector wide enough to cover both the signal and
+  // the noise windows, computes its PSD and integrates the bins of each
+  // window from the very same frames. Readings are smoothed with the same
+  // single-pole filter PowerProcessor uses, and always come in pairs.
+  //
+  class PSDProcessor : public QObject
+  {
+    Q_OBJECT
+
+    Suscan::Analyzer   *m_analyzer = nullptr;
+    Suscan::AnalyzerRequestTracker *m_tracker = nullptr;
+
+    Suscan::Handle      m_inspHandle  = -1;
+    uint32_t            m_inspId      = 0xffffffff;
+    UIMediator         *m_mediator    = nullptr;
+    PSDProcessorState   m_state       = PSD_PROCESSOR_IDLE;
+    qreal               m_desiredTau  = 1;   // Seconds
+    qreal               m_desiredFeedback = 0.1; // Seconds
+    unsigned int        m_fftSizeHint = 8192;
+
+    PSDWindow           m_windows[PSD_PROCESSOR_WINDOW_COUNT];
+    qreal               m_channelFrequency = 0;
+    qreal               m_channelBandwidth = 0;
+
+    // These are only set if state > OPENING
+    qreal               m_fullSampleRate  = 0;
+    qreal               m_equivSampleRate = 0;
+    qreal               m_chanRBW = 0;
+
+    // PSD state
+    unsigned            m_size = 0;
+    SU_FFTW(_complex)  *m_buffer = nullptr;
+    SU_FFTW(_plan)      m_plan = nullptr;
+    QVector<SUFLOAT>    m_window;
+    qreal               m_psdScale = 1;
+    qreal               m_accum[PSD_PROCESSOR_WINDOW_COUNT];
+    unsigned            m_filled   = 0;
+    unsigned            m_frames   = 0;
+    unsigned            m_framesPerUpdate = 1;
+    int                 m_firstBin[PSD_PROCESSOR_WINDOW_COUNT];
+    int                 m_binCount[PSD_PROCESSOR_WINDOW_COUNT];
+
+    qreal               m_trueFeedback = 0;
+    qreal               m_alpha = 1;
+    bool                m_haveReading = false;
+    qreal               m_weightSq = 1;
+    qreal               m_reading[PSD_PROCESSOR_WINDOW_COUNT];
+
+    void disconnectAnalyzer();
+    void connectAnalyzer();
+    void closeChannel();
+    bool openChannel();
+    void setState(PSDProcessorState, QString const &);
+    void connectAll();
+
+    bool computeChannel();
+    bool allocatePSD();
+    void releasePSD();
+    void configureWindows();
+    void configureIntegration();
+    void processFrame();
+    void flushReadings();
+
+  public:
+    explicit PSDProcessor(UIMediator *, QObject *parent = nullptr);
+    virtual ~PSDProcessor() override;
+
+    PSDProcessorState state() const;
+    void  setFFTSizeHint(unsigned int);
+    void  setAnalyzer(Suscan::Analyzer *);
+
+    bool  isRunning() const;
+    bool  cancel();
+
+    void  setTau(qreal);
+    bool  setWindows(PSDWindow const &signalNoise, PSDWindow const &noise);
+
+    qreal getTrueWidth(PSDProcessorWindow) const;
+    qreal getTrueFeedbackInterval() const;
+    unsigned getPSDSize() const;
+    qreal getDegreesOfFreedom(PSDProcessorWindow) const;
+
+    bool  startStreaming(PSDWindow const &signalNoise, PSDWindow const &noise);
+
+  public slots:
+    void onInspectorMessage(Suscan::InspectorMessage const &);
+    void onInspectorSamples(Suscan::SamplesMessage const &);
+    void onOpened(Suscan::AnalyzerRequest const &);
+    void onCancelled(Suscan::AnalyzerRequest const &);
+    void onError(Suscan::AnalyzerRequest const &, std::string const &);
+
+  signals:
+    void stateChanged(int, QString const &);
+    void measurement(qreal signalNoise, qreal noise);
+  };
+}
+
+#endif // PSDPROCESSOR_H
@@ -0,0 +1,206 @@
+//
+//    PipeSink.cpp: Bounded pipe sink
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "PipeSink.h"
+#include "SampleWriter.h"
+#include "DetachableProcess.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define PIPE_SINK_DEFAULT_SIZE (16 << 20)
+#define PIPE_SINK_KERNEL_SIZE  (1 << 20)
+
+using namespace SigDigger;
+
+PipeSink::PipeSink()
+{
+  m_writer = new SampleWriter();
+}
+
+PipeSink::~PipeSink()
+{
+  close();
+  delete m_writer;
+}
+
+bool
+PipeSink::makePipe(int fds[2])
+{
+  if (pipe(fds) == -1) {
+    m_lastError = QString("Cannot create pipe: ") + strerror(errno);
+    return false;
+  }
+
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+#ifdef F_SETPIPE_SZ
+  // The default 64 KiB pipe holds a few milliseconds at channel rates.
+  // Unprivileged users are capped by fs.pipe-max-size, so back off.
+  for (int size = PIPE_SINK_KERNEL_SIZE; size > (64 << 10); size >>= 1)
+    if (fcntl(fds[1], F_SETPIPE_SZ, size) != -1)
+      break;
+#endif
+
+  return true;
+}
+
+bool
+PipeSink::open(ForwarderSinkParams const &params)
+{
+  int fds[2];
+
+  close();
+  ForwarderSink::open(params);
+
+  if (!makePipe(fds))
+    return false;
+
+  m_readFd  = fds[0];
+  m_writeFd = fds[1];
+
+  m_writer->setRetain(params.supervised);
+  m_writer->startWriting(
+        m_writeFd,
+        params.bufferSize > 0 ? params.bufferSize : PIPE_SINK_DEFAULT_SIZE,
+        params.overflow,
+        SAMPLE_WRITER_PIPE);
+
+  return true;
+}
+
+void
+PipeSink::close()
+{
+  m_writer->stopWriting();
+
+  if (m_readFd != -1) {
+    ::close(m_readFd);
+    m_readFd = -1;
+  }
+
+  if (m_writeFd != -1) {
+    ::close(m_writeFd);
+    m_writeFd = -1;
+  }
+}
+
+bool
+PipeSink::write(const void *data, size_t size)
+{
+  uint8_t hdr[FORWARDER_SINK_MAX_HEADER];
+  size_t hdrSize;
+
+  if (m_writeFd == -1)
+    return false;
+
+  hdrSize = makeHeader(hdr, size, 0);
+  if (hdrSize == 0)
+    return m_writer->push(data, size);
+
+  return m_writer->push(hdr, hdrSize, data, size);
+}
+
+void
+PipeSink::aboutToLaunch(DetachableProcess &process)
+{
+  process.setStandardInputFile(QProcess::nullDevice());
+  process.setStandardInputFd(m_readFd);
+}
+
+void
+PipeSink::launched(DetachableProcess &process)
+{
+  process.setStandardInputFd(-1);
+
+  // The child has its own copy now
+  if (m_readFd != -1) {
+    ::close(m_readFd);
+    m_readFd = -1;
+  }
+}
+
+bool
+PipeSink::restart()
+{
+  int fds[2];
+
+  if (m_writeFd == -1) {
+    m_lastError = "Pipe is closed";
+    return false;
+  }
+
+  if (!makePipe(fds))
+    return false;
+
+  if (m_readFd != -1)
+    ::close(m_readFd);
+
+  // The writer lets go of the old pipe before we close it
+  m_writer->switchTo(fds[1]);
+  ::close(m_writeFd);
+
+  m_readFd  = fds[0];
+  m_writeFd = fds[1];
+
+  return true;
+}
+
+size_t
+PipeSink::pending() const
+{
+  return m_writer->pending();
+}
+
+uint64_t
+PipeSink::written() const
+{
+  return m_writer->written();
+}
+
+uint64_t
+PipeSink::dropped() const
+{
+  return m_writer->dropped();
+}
+
+uint64_t
+PipeSink::lost() const
+{
+  return m_writer->lost();
+}
+
+uint64_t
+PipeSink::discarded() const
+{
+  return m_writer->discarded();
+}
+
+uint64_t
+PipeSink::discardedAt() const
+{
+  return m_writer->discardedAt();
+}
+
+int64_t
+PipeSink::latency()
+{
+  return m_writer->latency();
+}
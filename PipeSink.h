@@ -0,0 +1,65 @@
+//
+//    PipeSink.h: Bounded pipe sink
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef PIPESINK_H
+#define PIPESINK_H
+
+#include "ForwarderSink.h"
+
+namespace SigDigger {
+  class SampleWriter;
+
+  //
+  // Writes samples to the standard input of the process through a pipe
+  // of our own. Works with any consumer. The pipe is fed by a writer
+  // thread (see SampleWriter), so the GUI thread only queues blocks.
+  // On Linux, large blocks reach the pipe without another copy.
+  // With framing, every block is preceded by an adsn_frame_header.
+  // A restarted consumer gets a new pipe and whatever was queued.
+  //
+  class PipeSink : public ForwarderSink
+  {
+    SampleWriter *m_writer  = nullptr;
+    int           m_readFd  = -1;
+    int           m_writeFd = -1;
+
+    bool makePipe(int fds[2]);
+
+  public:
+    PipeSink();
+    ~PipeSink() override;
+
+    bool open(ForwarderSinkParams const &) override;
+    void close() override;
+    bool write(const void *data, size_t size) override;
+
+    void aboutToLaunch(DetachableProcess &) override;
+    void launched(DetachableProcess &) override;
+    bool restart() override;
+
+    size_t   pending() const override;
+    uint64_t written() const override;
+    uint64_t dropped() const override;
+    uint64_t lost() const override;
+    uint64_t discarded() const override;
+    uint64_t discardedAt() const override;
+    int64_t  latency() override;
+  };
+}
+
+#endif // PIPESINK_H
@@ -329,6 +329,18 @@ PowerProcessor::getIntSamples() const
   return m_inspIntSamples;
 }
 
+//
+// Each power sample averages getIntSamples() complex samples, of which
+// only a fraction B / fs are independent. The smoothing filter then
+// averages 1 / sum(w^2) power samples worth of them. Every independent
+// complex sample of Gaussian noise contributes 2 degrees of freedom.
+//
+qreal
+PowerProcessor::getDegreesOfFreedom() const
+{
+  return m_lastDof;
+}
+
 qreal
 PowerProcessor::getTrueTau() const
 {
@@ -488,22 +500,34 @@ PowerProcessor::onInspectorSamples(Suscan::SamplesMessage const &msg)
     unsigned int count = msg.getCount();
     unsigned int i;
 
+    qreal dofScale =
+        2 * SCAST(qreal, m_inspIntSamples)
+        * fmin(1., m_trueBandwidth / m_equivSampleRate);
+
     if (m_state == POWER_PROCESSOR_MEASURING) {
       m_lastMeasurement = SCAST(qreal, SU_C_REAL(samples[count - 1]));
+      m_lastDof         = dofScale;
       emit measurement(m_lastMeasurement);
       this->setState(POWER_PROCESSOR_IDLE, "Done");
     } else if (m_state == POWER_PROCESSOR_STREAMING) {
       SUSCOUNT sampCount = m_rawSampleCount;
       qreal    power, lastMeasurement;
+      qreal    beta = (1 - m_alpha) * (1 - m_alpha);
+      qreal    alphaSq = m_alpha * m_alpha;
       lastMeasurement = m_lastMeasurement;
 
       for (i = 0; i < count; ++i) {
         power =  SCAST(qreal, SU_C_REAL(samples[i]));
 
-        if (sampCount == 0)
+        if (sampCount == 0) {
           lastMeasurement = power;
-        else
+          m_weightSq      = 1;
+        } else {
           SU_SPLPF_FEED(lastMeasurement, power, m_alpha);
+          m_weightSq = beta * m_weightSq + alphaSq;
+        }
+
+        m_lastDof = dofScale / m_weightSq;
 
         if (m_haveBpe && m_haveScaling && sampCount > 0)
           suscan_bpe_feed(&m_bpe, power, m_bpeScaling);
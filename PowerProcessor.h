@@ -86,6 +86,8 @@ namespace SigDigger {
     qreal               m_trueBandwidth;
     SUSCOUNT            m_rawSampleCount = 0;
     qreal               m_lastMeasurement = 0;
+    qreal               m_weightSq = 1;  // Sum of squared smoothing weights
+    qreal               m_lastDof  = 0;  // Degrees of freedom of the last one
 
     void configureInspector();
     qreal adjustBandwidth(qreal desired) const;
@@ -126,6 +128,7 @@ namespace SigDigger {
     qreal getEquivFs() const;
     unsigned getDecimation() const;
     unsigned getIntSamples() const;
+    qreal getDegreesOfFreedom() const;
 
     bool  oneShot(SUFREQ, SUFLOAT);
     bool  startStreaming(SUFREQ, SUFLOAT);
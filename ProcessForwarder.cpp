@@ -21,6 +21,15 @@
 #include <SuWidgetsHelpers.h>
 #include <Suscan/AnalyzerRequestTracker.h>
 #include <SigDiggerHelpers.h>
+#include <QTimer>
+#include <sigutils/log.h>
+#include <sigutils/types.h>
+
+// Restart delays double from the first to the last. A consumer that ran
+// for a while before dying starts over from the first one.
+#define PROCESS_FORWARDER_BACKOFF_MIN_MS 250
+#define PROCESS_FORWARDER_BACKOFF_MAX_MS 30000
+#define PROCESS_FORWARDER_STABLE_MS      30000
 
 using namespace SigDigger;
 
@@ -31,6 +40,11 @@ ProcessForwarder::ProcessForwarder(UIMediator *mediator, QObject *parent)
   m_mediator = mediator;
   m_tracker = new Suscan::AnalyzerRequestTracker(this);
 
+  m_restartTimer = new QTimer(this);
+  m_restartTimer->setSingleShot(true);
+
+  m_return = new ReturnReader(this);
+
   this->connectAll();
 
   this->setState(PROCESS_FORWARDER_IDLE, "Idle");
@@ -38,6 +52,19 @@ ProcessForwarder::ProcessForwarder(UIMediator *mediator, QObject *parent)
 
 ProcessForwarder::~ProcessForwarder()
 {
+  this->releaseFollowers("Source channel closed");
+
+  // Nobody may keep a pointer to us
+  for (auto f : m_sharers)
+    f->m_source = nullptr;
+
+  if (m_source != nullptr) {
+    m_source->detachFollower(this);
+    m_source->m_sharers.removeAll(this);
+  }
+
+  this->closeSink();
+  m_return->stop();
 }
 
 void
@@ -78,6 +105,18 @@ ProcessForwarder::connectAll()
         SIGNAL(finished(int,QProcess::ExitStatus)),
         this,
         SLOT(onProcessFinished(int,QProcess::ExitStatus)));
+
+  connect(
+        m_restartTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onRestartTimeout()));
+
+  connect(
+        m_return,
+        SIGNAL(reading(qreal,qreal,quint64)),
+        this,
+        SIGNAL(returnReading(qreal,qreal,quint64)));
 }
 
 qreal
@@ -128,6 +167,182 @@ ProcessForwarder::setFFTSizeHint(unsigned int fftSize)
   m_fftSize = fftSize;
 }
 
+bool
+ProcessForwarder::openSink()
+{
+  ForwarderSinkParams params = m_sinkParams;
+
+  this->closeSink();
+
+  m_warning.clear();
+
+  m_resampler.configure(m_equivSampleRate, m_outputRate);
+
+  params.sampleRate = m_resampler.outputRate();
+  params.sampleSize = m_converter.sampleSize();
+  params.format     = m_converter.format();
+  params.supervised = m_supervise;
+
+  m_sampleOffset = 0;
+  m_discarded    = 0;
+  m_retuned      = false;
+  m_samplesIn.storeRelease(0);
+
+  m_sink = ForwarderSink::make(m_sinkType);
+
+  if (!m_sink->open(params))
+    return false;
+
+  // A sidecar that cannot be written is not worth losing the stream
+  if (!m_sidecarPath.isEmpty()
+      && !m_sidecar.open(
+        m_sidecarPath,
+        m_converter.format(),
+        m_resampler.outputRate(),
+        m_programPath))
+    this->warn("No sidecar: " + m_sidecar.lastError());
+
+  return true;
+}
+
+void
+ProcessForwarder::closeSink()
+{
+  if (m_sink != nullptr) {
+    m_sink->close();
+    delete m_sink;
+    m_sink = nullptr;
+  }
+
+  m_sidecar.close();
+}
+
+
+void
+ProcessForwarder::forward(
+    const SUCOMPLEX *samples,
+    unsigned int count,
+    ForwarderBlockInfo const &source)
+{
+  // While the consumer is (re)starting, the sink buffers for it
+  if (m_state >= PROCESS_FORWARDER_LAUNCHING && m_sink != nullptr) {
+    ForwarderBlockInfo info = source;
+    const SUCOMPLEX *output;
+    const void *data;
+    size_t outCount;
+    size_t bytes;
+    bool ok;
+
+    m_samplesIn.fetchAndAddRelaxed(count);
+
+    info.timestamp += m_resampler.nextOutputTime() / m_equivSampleRate;
+    output = m_resampler.process(samples, count, outCount);
+    if (outCount == 0)
+      return;
+
+    data = m_converter.convert(output, outCount, bytes);
+
+    info.offset     = m_sampleOffset;
+    m_sampleOffset += outCount;
+
+    m_sink->setBlockInfo(info);
+    ok = m_sink->write(data, bytes);
+
+    if (!ok && m_sink->failed()) {
+      this->setState(PROCESS_FORWARDER_IDLE, m_sink->lastError());
+      return;
+    }
+
+    // Blocks trimmed by the sink after it took them never arrived
+    if (m_sidecar.isOpen() && m_sink->discarded() != m_discarded) {
+      uint64_t discarded = m_sink->discarded();
+      uint64_t size      = m_converter.sampleSize();
+
+      m_sidecar.discard(
+            m_sink->discardedAt() / size,
+            (discarded - m_discarded) / size);
+      m_discarded = discarded;
+    }
+
+    m_sidecar.append(info, outCount, ok);
+  }
+}
+
+// The follower borrows our channel parameters and goes straight to
+// launching its own process.
+bool
+ProcessForwarder::attachFollower(ProcessForwarder *follower)
+{
+  if (m_state < PROCESS_FORWARDER_LAUNCHING || m_following)
+    return false;
+
+  follower->m_fullSampleRate   = m_fullSampleRate;
+  follower->m_equivSampleRate  = m_equivSampleRate;
+  follower->m_decimation       = m_decimation;
+  follower->m_maxBandwidth     = m_maxBandwidth;
+  follower->m_chanRBW          = m_chanRBW;
+  follower->m_trueBandwidth    = m_trueBandwidth;
+  follower->m_desiredBandwidth = m_desiredBandwidth;
+  follower->m_desiredFrequency = m_desiredFrequency;
+  follower->m_fftSize          = m_fftSize;
+  follower->m_following        = true;
+
+  m_followers.append(follower);
+
+  return true;
+}
+
+void
+ProcessForwarder::detachFollower(ProcessForwarder *follower)
+{
+  m_followers.removeAll(follower);
+}
+
+// Called when the consumer is gone. Returns true if it will be launched
+// again, in which case the channel stays open.
+bool
+ProcessForwarder::scheduleRestart(QString const &reason)
+{
+  int delay;
+
+  if (m_state == PROCESS_FORWARDER_RESTARTING)
+    return true;
+
+  // A program that never started is most likely misconfigured
+  if (!m_supervise
+      || (m_state != PROCESS_FORWARDER_RUNNING
+          && !(m_state == PROCESS_FORWARDER_LAUNCHING && m_restarts > 0)))
+    return false;
+
+  if (m_uptime.isValid() && m_uptime.elapsed() >= PROCESS_FORWARDER_STABLE_MS)
+    m_backoff = PROCESS_FORWARDER_BACKOFF_MIN_MS;
+
+  delay     = m_backoff;
+  m_backoff = qMin(2 * m_backoff, PROCESS_FORWARDER_BACKOFF_MAX_MS);
+  m_uptime.invalidate();
+
+  m_restartTimer->start(delay);
+
+  this->setState(
+        PROCESS_FORWARDER_RESTARTING,
+        reason + ", restarting in "
+        + SuWidgetsHelpers::formatQuantity(delay * 1e-3, 2, "s"));
+
+  return true;
+}
+
+void
+ProcessForwarder::releaseFollowers(QString const &reason)
+{
+  auto followers = m_followers;
+
+  m_followers.clear();
+
+  for (auto f : followers) {
+    f->m_following = false;
+    f->setState(PROCESS_FORWARDER_IDLE, reason);
+  }
+}
 
 // Depending on the state, a few things must be initialized
 void
@@ -140,9 +355,18 @@ ProcessForwarder::setState(ProcessForwarderState state, QString const &msg)
 
     switch (state) {
       case PROCESS_FORWARDER_IDLE:
+        m_restartTimer->stop();
+
         if (m_inspHandle != -1)
           this->closeChannel();
 
+        if (m_following) {
+          m_source->detachFollower(this);
+          m_following = false;
+        }
+
+        this->releaseFollowers("Source channel closed");
+
         m_inspId = 0xffffffff;
         m_equivSampleRate = 0;
         m_fullSampleRate = 0;
@@ -154,9 +378,14 @@ ProcessForwarder::setState(ProcessForwarderState state, QString const &msg)
           m_process.terminate();
         }
 
+        this->closeSink();
+        m_return->stop();
         break;
 
       case PROCESS_FORWARDER_LAUNCHING:
+        if (m_programPath.isEmpty())
+          break;
+
         m_process.setProcessChannelMode(QProcess::SeparateChannels);
         m_process.setInputChannelMode(QProcess::ManagedInputChannel);
         m_process.setProgram(m_programPath);
@@ -165,16 +394,28 @@ ProcessForwarder::setState(ProcessForwarderState state, QString const &msg)
           QString arg = p;
           arg = arg.replace(
             "%SAMPLERATE%",
-            QString::number(SCAST(int, m_equivSampleRate)));
+            QString::number(SCAST(int, m_resampler.outputRate())));
           arg = arg.replace(
             "%FFTSIZE%",
             QString::number(SCAST(int, m_fftSize)));
+          arg = arg.replace(
+            "%FORMAT%",
+            SampleConverter::formatName(m_converter.format()));
+          arg = m_sink->expandArgument(arg);
           arg = SigDiggerHelpers::expandGlobalProperties(arg);
           correctedList.append(arg);
         }
 
         m_process.setArguments(correctedList);
+        m_sink->aboutToLaunch(m_process);
+
+        // Like the sidecar, a lost return path is not worth the stream
+        if (!m_return->aboutToLaunch(m_process))
+          this->warn("No return path: " + m_return->lastError());
+
         m_process.start();
+        m_sink->launched(m_process);
+        m_return->launched(m_process);
 
         break;
 
@@ -185,10 +426,39 @@ ProcessForwarder::setState(ProcessForwarderState state, QString const &msg)
         break;
     }
 
-    emit stateChanged(state, msg);
+    if (m_warning.isEmpty() || state == PROCESS_FORWARDER_IDLE)
+      emit stateChanged(state, msg);
+    else
+      emit stateChanged(state, msg + " (" + m_warning + ")");
   }
 }
 
+// Problems that do not stop the stream
+void
+ProcessForwarder::warn(QString const &problem)
+{
+  SU_WARNING("%s\n", problem.toStdString().c_str());
+
+  // Restarts may run into the same problem again
+  if (m_warning.contains(problem))
+    return;
+
+  if (m_warning.isEmpty())
+    m_warning = problem;
+  else
+    m_warning += "; " + problem;
+}
+
+void
+ProcessForwarder::launch()
+{
+  this->setState(PROCESS_FORWARDER_LAUNCHING, "Launching program...");
+
+  // Sinks that talk to an already running consumer need no program
+  if (m_state == PROCESS_FORWARDER_LAUNCHING && m_programPath.isEmpty())
+    this->onProcessStarted();
+}
+
 bool
 ProcessForwarder::openChannel()
 {
@@ -234,6 +504,67 @@ ProcessForwarder::setAnalyzer(Suscan::Analyzer *analyzer)
   m_tracker->setAnalyzer(analyzer);
 }
 
+void
+ProcessForwarder::setSink(QString const &type, ForwarderSinkParams const &params)
+{
+  m_sinkType   = type;
+  m_sinkParams = params;
+}
+
+void
+ProcessForwarder::setOutputFormat(SampleFormat format, float scale, bool dither)
+{
+  m_converter.setFormat(format, scale, dither);
+}
+
+void
+ProcessForwarder::setSidecarPath(QString const &path)
+{
+  m_sidecarPath = path;
+}
+
+void
+ProcessForwarder::setOutputRate(qreal rate)
+{
+  m_outputRate = rate;
+}
+
+void
+ProcessForwarder::setSupervised(bool supervise)
+{
+  m_supervise = supervise;
+}
+
+void
+ProcessForwarder::setReturnFormat(ReturnFormat format)
+{
+  m_return->setFormat(format);
+}
+
+void
+ProcessForwarder::setSource(ProcessForwarder *source)
+{
+  if (source == this)
+    source = nullptr;
+
+  if (source != m_source && m_following)
+    this->setState(PROCESS_FORWARDER_IDLE, "Channel source changed");
+
+  if (m_source != nullptr)
+    m_source->m_sharers.removeAll(this);
+
+  m_source = source;
+
+  if (m_source != nullptr)
+    m_source->m_sharers.append(this);
+}
+
+bool
+ProcessForwarder::isFollower() const
+{
+  return m_source != nullptr;
+}
+
 bool
 ProcessForwarder::isRunning() const
 {
@@ -285,12 +616,21 @@ ProcessForwarder::getTrueBandwidth() const
   return m_trueBandwidth;
 }
 
+qreal
+ProcessForwarder::getFrequency() const
+{
+  return m_desiredFrequency;
+}
+
 qreal
 ProcessForwarder::setBandwidth(qreal desired)
 {
   qreal ret;
   m_desiredBandwidth = desired;
 
+  if (m_following)
+    return m_trueBandwidth;
+
   if (m_state > PROCESS_FORWARDER_OPENING) {
     m_trueBandwidth = adjustBandwidth(m_desiredBandwidth);
     m_analyzer->setInspectorBandwidth(m_inspHandle, m_trueBandwidth);
@@ -305,6 +645,12 @@ ProcessForwarder::setBandwidth(qreal desired)
 void
 ProcessForwarder::setFrequency(qreal fc)
 {
+  if (m_following)
+    return;
+
+  if (fc != m_desiredFrequency)
+    m_retuned = true;
+
   m_desiredFrequency = fc;
   if (m_state > PROCESS_FORWARDER_OPENING) {
     m_analyzer->setInspectorFreq(m_inspHandle, m_desiredFrequency - m_analyzer->getFrequency());
@@ -326,6 +672,57 @@ ProcessForwarder::getEquivFs() const
     return 0;
 }
 
+qreal
+ProcessForwarder::getOutputRate() const
+{
+  if (m_state > PROCESS_FORWARDER_OPENING)
+    return m_resampler.outputRate();
+  else
+    return 0;
+}
+
+uint64_t
+ProcessForwarder::bytesWritten() const
+{
+  return m_sink != nullptr ? m_sink->written() : 0;
+}
+
+uint64_t
+ProcessForwarder::bytesDropped() const
+{
+  return m_sink != nullptr ? m_sink->dropped() : 0;
+}
+
+unsigned
+ProcessForwarder::restartCount() const
+{
+  return m_restarts;
+}
+
+quint64
+ProcessForwarder::returnValues() const
+{
+  return m_return->values();
+}
+
+size_t
+ProcessForwarder::bytesPending() const
+{
+  return m_sink != nullptr ? m_sink->pending() : 0;
+}
+
+quint64
+ProcessForwarder::samplesIn() const
+{
+  return m_samplesIn.loadAcquire();
+}
+
+int64_t
+ProcessForwarder::drainLatency()
+{
+  return m_sink != nullptr ? m_sink->latency() : -1;
+}
+
 bool
 ProcessForwarder::run(
     QString const &prog,
@@ -338,6 +735,28 @@ ProcessForwarder::run(
 
   m_programPath = prog;
   m_programArgs = args;
+  m_restarts    = 0;
+  m_backoff     = PROCESS_FORWARDER_BACKOFF_MIN_MS;
+
+  if (m_source != nullptr) {
+    if (!m_source->attachFollower(this))
+      return false;
+
+    if (!this->openSink()) {
+      QString error = m_sink->lastError();
+
+      // Still IDLE, so undo the attachment by hand
+      m_source->detachFollower(this);
+      m_following = false;
+      this->closeSink();
+
+      emit stateChanged(m_state, "Cannot open output: " + error);
+      return true;
+    }
+
+    this->launch();
+    return true;
+  }
 
   this->setFrequency(fc);
   this->setBandwidth(SCAST(qreal, bw));
@@ -383,12 +802,26 @@ ProcessForwarder::onInspectorSamples(Suscan::SamplesMessage const &msg)
   if (msg.getInspectorId() == m_inspId) {
     const SUCOMPLEX *samples = msg.getSamples();
     unsigned int count = msg.getCount();
-
-    if (m_state == PROCESS_FORWARDER_RUNNING
-        && m_process.state() == QProcess::Running)
-      m_process.write(
-            reinterpret_cast<const char *>(samples),
-            count * sizeof(SUCOMPLEX));
+    ForwarderBlockInfo info;
+    struct timeval tv = m_analyzer->getSourceTimeStamp();
+
+    // The source timestamp is that of the most recent samples, so this
+    // block started count samples earlier.
+    info.timestamp = tv.tv_sec + 1e-6 * tv.tv_usec - count / m_equivSampleRate;
+    info.frequency = m_desiredFrequency;
+    info.retune    = m_retuned;
+    m_retuned      = false;
+
+    // A sink that fails takes its forwarder (and our followers) to IDLE
+    // from here, so iterate over a copy
+    auto followers = m_followers;
+
+    this->forward(samples, count, info);
+
+    // Every follower has its own bounded sink, a stalled one does not
+    // hold back the others.
+    for (auto f : followers)
+      f->forward(samples, count, info);
   }
 }
 
@@ -414,8 +847,16 @@ ProcessForwarder::onOpened(Suscan::AnalyzerRequest const &req)
     m_analyzer->setInspectorBandwidth(m_inspHandle, m_trueBandwidth);
 
 
+    // The sink must exist before the arguments are expanded
+    if (!this->openSink()) {
+      this->setState(
+            PROCESS_FORWARDER_IDLE,
+            "Cannot open output: " + m_sink->lastError());
+      return;
+    }
+
     // We now transition to LAUNCHING and wait for the process initialization
-    this->setState(PROCESS_FORWARDER_LAUNCHING, "Launching program...");
+    this->launch();
   }
 }
 
@@ -463,6 +904,12 @@ ProcessForwarder::onProcessError(QProcess::ProcessError error)
       reason = "Unknown reason";
   }
 
+  // finished() follows a crash, but the channel must survive until then
+  if (error == QProcess::ProcessError::Crashed
+      || error == QProcess::ProcessError::FailedToStart)
+    if (this->scheduleRestart(reason))
+      return;
+
   this->setState(PROCESS_FORWARDER_IDLE, reason);
 }
 
@@ -478,14 +925,42 @@ ProcessForwarder::onProcessFinished(int code, QProcess::ExitStatus status)
   else
     reason = "Process finished normally";
 
+  // A consumer that exits cleanly is done
+  if (status == QProcess::CrashExit || code != 0)
+    if (this->scheduleRestart(reason))
+      return;
+
   this->setState(PROCESS_FORWARDER_IDLE, reason);
 }
 
 void
 ProcessForwarder::onProcessStarted()
 {
-  this->setState(
-        PROCESS_FORWARDER_RUNNING,
-        "Running at "
-        + SuWidgetsHelpers::formatQuantity(m_equivSampleRate, 3, "sps"));
+  QString desc = "Running at "
+      + SuWidgetsHelpers::formatQuantity(m_resampler.outputRate(), 3, "sps");
+
+  if (m_restarts > 0)
+    desc += " (restarted " + QString::number(m_restarts) + " times)";
+
+  m_uptime.start();
+
+  this->setState(PROCESS_FORWARDER_RUNNING, desc);
+}
+
+void
+ProcessForwarder::onRestartTimeout()
+{
+  if (m_state != PROCESS_FORWARDER_RESTARTING)
+    return;
+
+  ++m_restarts;
+
+  if (!m_sink->restart()) {
+    this->setState(
+          PROCESS_FORWARDER_IDLE,
+          "Cannot restart output: " + m_sink->lastError());
+    return;
+  }
+
+  this->launch();
 }
@@ -20,10 +20,18 @@
 #define PROCESSFORWARDER_H
 
 #include <QObject>
+#include <QList>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
 #include <Suscan/Library.h>
 #include <Suscan/Analyzer.h>
 #include <AudioFileSaver.h>
 #include "DetachableProcess.h"
+#include "ForwarderSink.h"
+#include "SampleConverter.h"
+#include "SigMFSidecar.h"
+#include "Resampler.h"
+#include "ReturnReader.h"
 
 namespace Suscan {
   class Analyzer;
@@ -31,6 +39,8 @@ namespace Suscan {
   struct AnalyzerRequest;
 };
 
+class QTimer;
+
 namespace SigDigger {
   class UIMediator;
   class AudioPlayback;
@@ -40,6 +50,7 @@ namespace SigDigger {
     PROCESS_FORWARDER_OPENING,      // Have request Id, open() sent
     PROCESS_FORWARDER_LAUNCHING,     // Have inspector Id, set_params() sent
     PROCESS_FORWARDER_RUNNING,      // set_params ack, starting sample delivery (hold)
+    PROCESS_FORWARDER_RESTARTING,   // Consumer died, channel kept, relaunch pending
   };
 
   class ProcessForwarder : public QObject
@@ -59,6 +70,40 @@ namespace SigDigger {
     qreal               m_desiredBandwidth = 0;
     qreal               m_desiredFrequency = 0;
     DetachableProcess   m_process;
+    ForwarderSink      *m_sink        = nullptr;
+    QString             m_sinkType    = "pipe";
+    ForwarderSinkParams m_sinkParams;
+    SampleConverter     m_converter;
+    Resampler           m_resampler;
+    qreal               m_outputRate  = 0; // 0: channel rate
+    SigMFSidecar        m_sidecar;
+    QString             m_sidecarPath;
+    QString             m_warning; // Told along with the state until idle
+    ReturnReader       *m_return      = nullptr;
+
+    // Supervision: a consumer that dies is launched again after a
+    // growing delay, while the channel keeps filling the sink buffer.
+    bool                m_supervise    = false;
+    unsigned            m_restarts     = 0;
+    int                 m_backoff      = 0; // ms
+    QTimer             *m_restartTimer = nullptr;
+    QElapsedTimer       m_uptime;
+
+    // Stream position, for the frame metadata and the sidecar
+    uint64_t            m_sampleOffset = 0;
+    uint64_t            m_discarded    = 0; // Seen by the sidecar
+    bool                m_retuned      = false;
+
+    // Channel samples taken since the sink was opened
+    QAtomicInteger<quint64> m_samplesIn;
+
+    // Tee mode: followers get the samples of our channel, each one into
+    // its own process and sink. m_followers are the ones running now,
+    // m_sharers all of those whose source we are.
+    ProcessForwarder   *m_source      = nullptr;
+    bool                m_following   = false;
+    QList<ProcessForwarder *> m_followers;
+    QList<ProcessForwarder *> m_sharers;
 
     // These are only set if state > OPENING
     qreal               m_fullSampleRate;
@@ -76,7 +121,16 @@ namespace SigDigger {
     void connectAnalyzer();
     void closeChannel();
     bool openChannel();
+    bool openSink();
+    void closeSink();
     void setState(ProcessForwarderState, QString const &);
+    void warn(QString const &);
+    void launch();
+    void forward(const SUCOMPLEX *, unsigned int, ForwarderBlockInfo const &);
+    bool attachFollower(ProcessForwarder *);
+    void detachFollower(ProcessForwarder *);
+    void releaseFollowers(QString const &);
+    bool scheduleRestart(QString const &);
 
     void connectAll();
 
@@ -88,6 +142,14 @@ namespace SigDigger {
     ProcessForwarderState state() const;
     void  setAnalyzer(Suscan::Analyzer *);
     void  setFFTSizeHint(unsigned int);
+    void  setSink(QString const &type, ForwarderSinkParams const &);
+    void  setOutputFormat(SampleFormat, float scale, bool dither);
+    void  setSidecarPath(QString const &);
+    void  setOutputRate(qreal);
+    void  setSupervised(bool);
+    void  setReturnFormat(ReturnFormat);
+    void  setSource(ProcessForwarder *);
+    bool  isFollower() const;
 
     bool  run(QString const &, QStringList const &, SUFREQ, SUFLOAT);
     bool  isRunning() const;
@@ -100,9 +162,19 @@ namespace SigDigger {
     qreal getMinBandwidth() const;
     qreal getMaxBandwidth() const;
     qreal getTrueBandwidth() const;
+    qreal getFrequency() const;
     qreal getEquivFs() const;
+    qreal getOutputRate() const;
     unsigned getDecimation() const;
 
+    uint64_t bytesWritten() const;
+    uint64_t bytesDropped() const;
+    size_t   bytesPending() const;
+    unsigned restartCount() const;
+    quint64  samplesIn() const;
+    int64_t  drainLatency();
+    quint64  returnValues() const;
+
   public slots:
     void onInspectorMessage(Suscan::InspectorMessage const &);
     void onInspectorSamples(Suscan::SamplesMessage const &);
@@ -113,9 +185,11 @@ namespace SigDigger {
     void onProcessError(QProcess::ProcessError);
     void onProcessFinished(int, QProcess::ExitStatus);
     void onProcessStarted();
+    void onRestartTimeout();
 
   signals:
     void stateChanged(int, QString const &);
+    void returnReading(qreal mean, qreal last, quint64 count);
   };
 }
 
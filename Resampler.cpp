@@ -0,0 +1,341 @@
+//
+//    Resampler.cpp: Polyphase resampler for forwarded channels
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "Resampler.h"
+#include <volk/volk.h>
+#include <QMutex>
+#include <QMutexLocker>
+#include <sigutils/log.h>
+#include <map>
+#include <tuple>
+#include <cmath>
+
+// Rational ratios up to this many phases are run exactly
+#define RESAMPLER_MAX_RATIONAL_PHASES 256
+
+// Phases of the bank used for arbitrary ratios
+#define RESAMPLER_ARBITRARY_PHASES    128
+
+// Taps per phase for a transition band 10% of the output rate wide and
+// ~80 dB of stopband attenuation (Kaiser, beta 8), scaled by the
+// decimation ratio
+#define RESAMPLER_BASE_TAPS           52
+#define RESAMPLER_MAX_TAPS            2048
+#define RESAMPLER_KAISER_BETA         8.
+
+// The cutoff sits half a transition band below the output Nyquist
+// frequency, so the stopband starts right at it and nothing above it
+// aliases back with less than the full attenuation. The passband ends
+// at 80% of the output Nyquist frequency (0.4 times the output rate).
+#define RESAMPLER_CUTOFF              .9
+
+// When RESAMPLER_MAX_TAPS is not enough, the transition band is widened
+// downwards, but the cutoff is never moved below this fraction of the
+// output Nyquist frequency.
+#define RESAMPLER_MIN_CUTOFF          .5
+
+using namespace SigDigger;
+
+typedef std::tuple<unsigned, unsigned, float> ResamplerBankKey;
+
+static QMutex g_bankMutex;
+static std::map<ResamplerBankKey, std::weak_ptr<const ResamplerBank>> g_banks;
+
+static double
+besselI0(double x)
+{
+  double sum  = 1;
+  double term = 1;
+
+  for (int k = 1; k < 50; ++k) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum  += term;
+    if (term < 1e-12 * sum)
+      break;
+  }
+
+  return sum;
+}
+
+// Kaiser-windowed sinc sampled at phases times the input rate. Cutoff is
+// in cycles per input sample.
+static std::shared_ptr<const ResamplerBank>
+designBank(unsigned phases, unsigned taps, float cutoff)
+{
+  ResamplerBankKey key(phases, taps, cutoff);
+  std::shared_ptr<ResamplerBank> bank;
+  std::vector<double> proto;
+  unsigned length = phases * taps + 1;
+  double   center = .5 * phases * taps;
+  double   norm   = besselI0(RESAMPLER_KAISER_BETA);
+  double   sum    = 0;
+  QMutexLocker locker(&g_bankMutex);
+
+  auto it = g_banks.find(key);
+  if (it != g_banks.end()) {
+    auto cached = it->second.lock();
+    if (cached)
+      return cached;
+  }
+
+  proto.resize(length);
+  for (unsigned n = 0; n < length; ++n) {
+    double t = (n - center) / phases; // In input samples
+    double r = (n - center) / center;
+    double x = 2 * cutoff * t;
+    double sinc = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+    double w = besselI0(RESAMPLER_KAISER_BETA * sqrt(fmax(0, 1 - r * r))) / norm;
+
+    proto[n] = 2 * cutoff * sinc * w;
+    if (n < length - 1)
+      sum += proto[n];
+  }
+
+  // Unit DC gain on average across phases
+  sum /= phases;
+
+  bank = std::make_shared<ResamplerBank>();
+  bank->phases = phases;
+  bank->taps   = taps;
+  bank->coefs.resize((phases + 1) * taps);
+
+  for (unsigned p = 0; p <= phases; ++p)
+    for (unsigned k = 0; k < taps; ++k)
+      bank->coefs[p * taps + k] =
+          static_cast<float>(proto[p + phases * (taps - 1 - k)] / sum);
+
+  g_banks[key] = bank;
+
+  return bank;
+}
+
+// Finds L / M == ratio with L <= maxL by continued fractions
+static bool
+findRational(double ratio, unsigned maxL, unsigned &L, unsigned &M)
+{
+  double x = ratio;
+  uint64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+
+  for (int i = 0; i < 32; ++i) {
+    double a = floor(x);
+    uint64_t p2 = static_cast<uint64_t>(a) * p1 + p0;
+    uint64_t q2 = static_cast<uint64_t>(a) * q1 + q0;
+
+    if (p2 > maxL || q2 > (1u << 24))
+      return false;
+
+    if (q2 > 0 && fabs(static_cast<double>(p2) / q2 - ratio) < 1e-12 * ratio) {
+      if (p2 == 0)
+        return false;
+      L = static_cast<unsigned>(p2);
+      M = static_cast<unsigned>(q2);
+      return true;
+    }
+
+    if (x - a < 1e-15)
+      return false;
+
+    x  = 1 / (x - a);
+    p0 = p1;
+    q0 = q1;
+    p1 = p2;
+    q1 = q2;
+  }
+
+  return false;
+}
+
+void
+Resampler::configure(qreal inputRate, qreal outputRate)
+{
+  double ratio;
+  double bandwidth;
+  double cutoff;
+  double transition;
+  bool aliased;
+  unsigned taps;
+
+  m_inputRate  = inputRate;
+  m_outputRate = outputRate;
+  m_bypass     = outputRate <= 0
+      || inputRate <= 0
+      || fabs(outputRate - inputRate) < 1e-9 * inputRate;
+
+  reset();
+
+  if (m_bypass) {
+    m_outputRate = inputRate;
+    m_bank.reset();
+    return;
+  }
+
+  ratio     = outputRate / inputRate;
+  bandwidth = fmin(1., ratio);
+
+  taps   = static_cast<unsigned>(ceil(RESAMPLER_BASE_TAPS / bandwidth));
+  taps   = (taps + 3) & ~3u;
+  cutoff = .5 * bandwidth * RESAMPLER_CUTOFF;
+
+  // Fewer taps mean a proportionally wider transition band. We keep its
+  // upper edge at the output Nyquist frequency and give up passband.
+  if (taps > RESAMPLER_MAX_TAPS) {
+    transition = (1 - RESAMPLER_CUTOFF)
+        * RESAMPLER_BASE_TAPS / RESAMPLER_MAX_TAPS;
+    cutoff = .5 * (bandwidth - transition);
+    aliased = cutoff < .5 * bandwidth * RESAMPLER_MIN_CUTOFF;
+    if (aliased)
+      cutoff = .5 * bandwidth * RESAMPLER_MIN_CUTOFF;
+
+    SU_WARNING(
+          "Resampling ratio %g needs %u taps per phase, limited to %d. "
+          "Passband reduced to %.0f%% of the output Nyquist frequency%s\n",
+          ratio,
+          taps,
+          RESAMPLER_MAX_TAPS,
+          100 * fmax(0, 2 * cutoff - transition) / bandwidth,
+          aliased ? ", with less stopband attenuation near it" : "");
+
+    taps = RESAMPLER_MAX_TAPS;
+  }
+
+  m_rational = findRational(
+        ratio,
+        RESAMPLER_MAX_RATIONAL_PHASES,
+        m_interp,
+        m_decim);
+
+  if (!m_rational) {
+    m_interp = RESAMPLER_ARBITRARY_PHASES;
+    m_decim  = 1;
+  }
+
+  m_step = 1 / ratio;
+  m_bank = designBank(
+        m_interp,
+        taps,
+        static_cast<float>(cutoff));
+}
+
+void
+Resampler::reset()
+{
+  m_phase = 0;
+  m_frac  = 0;
+  m_index = 0;
+  m_history.clear();
+}
+
+bool
+Resampler::bypassed() const
+{
+  return m_bypass;
+}
+
+qreal
+Resampler::outputRate() const
+{
+  return m_outputRate;
+}
+
+qreal
+Resampler::nextOutputTime() const
+{
+  double frac;
+
+  if (m_bypass)
+    return 0;
+
+  frac = m_rational ? static_cast<double>(m_phase) / m_interp : m_frac;
+
+  // Outputs are delayed by half the filter
+  return m_index + frac + .5 * m_bank->taps - 1
+      - static_cast<double>(m_history.size());
+}
+
+std::complex<float>
+Resampler::dot(const std::complex<float> *x, unsigned phase) const
+{
+  lv_32fc_t result;
+
+  volk_32fc_32f_dot_prod_32fc(
+        &result,
+        x,
+        m_bank->coefs.data() + phase * m_bank->taps,
+        m_bank->taps);
+
+  return result;
+}
+
+const SUCOMPLEX *
+Resampler::process(const SUCOMPLEX *samples, size_t count, size_t &outCount)
+{
+  const std::complex<float> *x;
+  size_t avail;
+  size_t consumed;
+  unsigned taps;
+
+  if (m_bypass) {
+    outCount = count;
+    return samples;
+  }
+
+  taps = m_bank->taps;
+
+  // sigutils may be built with double precision
+  m_history.reserve(m_history.size() + count);
+  for (size_t i = 0; i < count; ++i)
+    m_history.push_back(std::complex<float>(samples[i]));
+
+  x     = m_history.data();
+  avail = m_history.size();
+  m_output.clear();
+
+  if (m_rational) {
+    while (m_index + taps <= avail) {
+      m_output.push_back(dot(x + m_index, m_phase));
+
+      m_phase += m_decim;
+      m_index += m_phase / m_interp;
+      m_phase %= m_interp;
+    }
+  } else {
+    while (m_index + taps <= avail) {
+      double pos  = m_frac * m_interp;
+      unsigned p  = static_cast<unsigned>(pos);
+      float mu    = static_cast<float>(pos - p);
+      std::complex<float> y0 = dot(x + m_index, p);
+      std::complex<float> y1 = dot(x + m_index, p + 1);
+      double advance;
+
+      m_output.push_back(y0 + mu * (y1 - y0));
+
+      m_frac  += m_step;
+      advance  = floor(m_frac);
+      m_frac  -= advance;
+      m_index += static_cast<size_t>(advance);
+    }
+  }
+
+  consumed = m_index < avail ? m_index : avail;
+  m_history.erase(m_history.begin(), m_history.begin() + consumed);
+  m_index -= consumed;
+
+  outCount = m_output.size();
+
+  return m_output.data();
+}
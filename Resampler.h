@@ -0,0 +1,81 @@
+//
+//    Resampler.h: Polyphase resampler for forwarded channels
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <sigutils/types.h>
+#include <QtGlobal>
+#include <complex>
+#include <memory>
+#include <vector>
+
+namespace SigDigger {
+  // Phases of the filter, stored tap-reversed so that every output is a
+  // plain dot product against the input history.
+  struct ResamplerBank {
+    unsigned phases = 0;
+    unsigned taps   = 0;
+    std::vector<float> coefs; // (phases + 1) rows of taps
+  };
+
+  //
+  // Converts the channel to an exact output rate. Ratios with a small
+  // numerator (48 kHz from 250 ksps is 24/125) run an exact rational
+  // polyphase filter. Anything else uses a fixed bank of phases and
+  // interpolates linearly between the two nearest ones.
+  //
+  // Filter banks are designed once per configuration and shared by every
+  // resampler that needs them.
+  //
+  class Resampler
+  {
+    qreal    m_inputRate  = 0;
+    qreal    m_outputRate = 0;
+    bool     m_bypass     = true;
+
+    bool     m_rational   = false;
+    unsigned m_interp     = 1;  // Rational: L
+    unsigned m_decim      = 1;  // Rational: M
+    unsigned m_phase      = 0;  // Rational: phase of the next output
+    double   m_step       = 1;  // Arbitrary: input samples per output
+    double   m_frac       = 0;  // Arbitrary: fractional position
+    size_t   m_index      = 0;  // History index of the next output
+
+    std::shared_ptr<const ResamplerBank> m_bank;
+    std::vector<std::complex<float>>     m_history;
+    std::vector<SUCOMPLEX>               m_output;
+
+    std::complex<float> dot(const std::complex<float> *, unsigned phase) const;
+
+  public:
+    void configure(qreal inputRate, qreal outputRate);
+    void reset();
+
+    bool  bypassed() const;
+    qreal outputRate() const;
+
+    // Input time of the next output, in input samples relative to the
+    // first sample of the next block (usually negative)
+    qreal nextOutputTime() const;
+
+    const SUCOMPLEX *process(const SUCOMPLEX *, size_t count, size_t &outCount);
+  };
+}
+
+#endif // RESAMPLER_H
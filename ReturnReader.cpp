@@ -0,0 +1,326 @@
+//
+//    ReturnReader.cpp: Reads back what the external program writes
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ReturnReader.h"
+#include "DetachableProcess.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define RETURN_READER_BUFFER_SIZE (64 << 10)
+#define RETURN_READER_POLL_MS     100
+#define RETURN_READER_REPORT_MS   250
+
+using namespace SigDigger;
+
+// In the same order as ReturnFormat
+static const char *g_returnFormatNames[] = {"none", "text", "f32", "f64", "cf32"};
+
+ReturnReader::ReturnReader(QObject *parent) : QThread(parent)
+{
+}
+
+ReturnReader::~ReturnReader()
+{
+  stop();
+}
+
+QString
+ReturnReader::formatName(ReturnFormat format)
+{
+  return g_returnFormatNames[format];
+}
+
+bool
+ReturnReader::parseFormat(QString const &name, ReturnFormat &format)
+{
+  for (unsigned i = 0; i < sizeof(g_returnFormatNames) / sizeof(g_returnFormatNames[0]); ++i) {
+    if (name == g_returnFormatNames[i]) {
+      format = static_cast<ReturnFormat>(i);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void
+ReturnReader::setFormat(ReturnFormat format)
+{
+  m_format = format;
+}
+
+ReturnFormat
+ReturnReader::format() const
+{
+  return m_format;
+}
+
+void
+ReturnReader::closeAll()
+{
+  if (m_fd != -1) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+
+  if (m_childFd != -1) {
+    ::close(m_childFd);
+    m_childFd = -1;
+  }
+}
+
+bool
+ReturnReader::aboutToLaunch(DetachableProcess &process)
+{
+  int fds[2];
+
+  stop();
+
+  if (m_format == RETURN_FORMAT_NONE)
+    return true;
+
+  if (pipe(fds) == -1) {
+    m_lastError = QString("Cannot create pipe: ") + strerror(errno);
+    return false;
+  }
+
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+  m_fd      = fds[0];
+  m_childFd = fds[1];
+
+  // Keep QProcess from reading it too
+  process.setStandardOutputFile(QProcess::nullDevice());
+  process.setStandardOutputFd(m_childFd);
+
+  return true;
+}
+
+void
+ReturnReader::launched(DetachableProcess &process)
+{
+  if (m_childFd == -1)
+    return;
+
+  process.setStandardOutputFd(-1);
+  process.setStandardOutputFile(QString());
+
+  // Only the child may keep it open, or we would never see EOF
+  ::close(m_childFd);
+  m_childFd = -1;
+
+  m_values.storeRelease(0);
+  m_stopping.storeRelease(0);
+
+  start();
+}
+
+void
+ReturnReader::stop()
+{
+  if (isRunning()) {
+    m_stopping.storeRelease(1);
+    wait();
+  }
+
+  closeAll();
+}
+
+void
+ReturnReader::push(qreal value)
+{
+  m_sum  += value;
+  m_last  = value;
+  ++m_count;
+}
+
+void
+ReturnReader::report()
+{
+  if (m_count == 0)
+    return;
+
+  m_values.fetchAndAddRelaxed(m_count);
+
+  emit reading(m_sum / static_cast<qreal>(m_count), m_last, m_count);
+
+  m_sum   = 0;
+  m_count = 0;
+}
+
+// Takes the first field of every complete line. Lines are terminated
+// in place, and numbers are parsed in the C locale whatever the locale
+// of the GUI is.
+size_t
+ReturnReader::parseText(char *data, size_t size)
+{
+  char *p   = data;
+  char *end = data + size;
+  char *nl;
+
+  while ((nl = static_cast<char *>(memchr(p, '\n', static_cast<size_t>(end - p)))) != nullptr) {
+    char *field;
+    bool ok;
+    qreal value;
+
+    while (p < nl && (*p == ' ' || *p == '\t'))
+      ++p;
+
+    field = p;
+
+    while (p < nl && *p != ' ' && *p != '\t' && *p != ',' && *p != ';' && *p != '\r')
+      ++p;
+
+    if (p > field) {
+      value = QByteArray::fromRawData(field, static_cast<int>(p - field)).toDouble(&ok);
+      if (ok)
+        push(value);
+    }
+
+    p = nl + 1;
+  }
+
+  return static_cast<size_t>(p - data);
+}
+
+// Returns the number of bytes consumed. Whatever is left is the
+// beginning of the next value.
+size_t
+ReturnReader::parse(char *data, size_t size)
+{
+  size_t i = 0;
+
+  switch (m_format) {
+    case RETURN_FORMAT_TEXT:
+      return parseText(data, size);
+
+    case RETURN_FORMAT_F32:
+      for (; i + sizeof(float) <= size; i += sizeof(float)) {
+        float value;
+        memcpy(&value, data + i, sizeof(float));
+        push(static_cast<qreal>(value));
+      }
+      break;
+
+    case RETURN_FORMAT_F64:
+      for (; i + sizeof(double) <= size; i += sizeof(double)) {
+        double value;
+        memcpy(&value, data + i, sizeof(double));
+        push(value);
+      }
+      break;
+
+    case RETURN_FORMAT_CF32:
+      for (; i + 2 * sizeof(float) <= size; i += 2 * sizeof(float)) {
+        float iq[2];
+        memcpy(iq, data + i, sizeof(iq));
+        push(static_cast<qreal>(iq[0] * iq[0] + iq[1] * iq[1]));
+      }
+      break;
+
+    default:
+      i = size;
+  }
+
+  return i;
+}
+
+void
+ReturnReader::run()
+{
+  struct pollfd pfd;
+  QElapsedTimer timer;
+
+  pfd.fd     = m_fd;
+  pfd.events = POLLIN;
+
+  m_buffer.resize(RETURN_READER_BUFFER_SIZE);
+  m_fill  = 0;
+  m_sum   = 0;
+  m_count = 0;
+
+  timer.start();
+
+  while (!m_stopping.loadAcquire()) {
+    ssize_t got;
+    size_t used;
+    int ret = poll(&pfd, 1, RETURN_READER_POLL_MS);
+
+    if (ret == 0) {
+      // The program went quiet, do not sit on what it said
+      report();
+      timer.restart();
+      continue;
+    }
+
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    got = read(m_fd, m_buffer.data() + m_fill, m_buffer.size() - m_fill);
+
+    if (got < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      break;
+    }
+
+    // EOF: the program is gone
+    if (got == 0)
+      break;
+
+    m_fill += static_cast<size_t>(got);
+    used    = parse(m_buffer.data(), m_fill);
+
+    if (used > 0 && used < m_fill)
+      memmove(m_buffer.data(), m_buffer.data() + used, m_fill - used);
+
+    m_fill -= used;
+
+    // A line that does not fit is not a value
+    if (m_fill == m_buffer.size())
+      m_fill = 0;
+
+    if (timer.elapsed() >= RETURN_READER_REPORT_MS) {
+      report();
+      timer.restart();
+    }
+  }
+
+  report();
+}
+
+quint64
+ReturnReader::values() const
+{
+  return m_values.loadAcquire();
+}
+
+QString
+ReturnReader::lastError() const
+{
+  return m_lastError;
+}
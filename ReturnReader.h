@@ -0,0 +1,97 @@
+//
+//    ReturnReader.h: Reads back what the external program writes
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef RETURNREADER_H
+#define RETURNREADER_H
+
+#include <QThread>
+#include <QString>
+#include <QAtomicInteger>
+#include <vector>
+
+namespace SigDigger {
+  class DetachableProcess;
+
+  enum ReturnFormat {
+    RETURN_FORMAT_NONE, // Standard output is left alone
+    RETURN_FORMAT_TEXT, // One value per line, other lines are ignored
+    RETURN_FORMAT_F32,  // Native float
+    RETURN_FORMAT_F64,  // Native double
+    RETURN_FORMAT_CF32, // Native complex float, read as power
+  };
+
+  //
+  // Turns the standard output of the program into a stream of values.
+  // The program writes to a pipe of ours, which a thread of its own
+  // reads and parses in place. Values are averaged and reported through
+  // reading() at most every few hundred milliseconds, so a program
+  // writing at sample rate does not flood the GUI thread.
+  //
+  // Like the sinks, it is told before and after the program is started.
+  //
+  class ReturnReader : public QThread
+  {
+    Q_OBJECT
+
+    ReturnFormat m_format  = RETURN_FORMAT_NONE;
+    int          m_fd      = -1; // Read end
+    int          m_childFd = -1; // Write end, the standard output of the child
+    QString      m_lastError;
+
+    QAtomicInteger<int>     m_stopping;
+    QAtomicInteger<quint64> m_values;
+
+    // Reader only
+    std::vector<char> m_buffer;
+    size_t  m_fill  = 0;
+    qreal   m_sum   = 0;
+    qreal   m_last  = 0;
+    quint64 m_count = 0;
+
+    void   closeAll();
+    void   push(qreal);
+    size_t parse(char *, size_t);
+    size_t parseText(char *, size_t);
+    void   report();
+
+  protected:
+    void run() override;
+
+  public:
+    ReturnReader(QObject *parent = nullptr);
+    ~ReturnReader() override;
+
+    static QString formatName(ReturnFormat);
+    static bool    parseFormat(QString const &, ReturnFormat &);
+
+    void setFormat(ReturnFormat);
+    ReturnFormat format() const;
+
+    bool aboutToLaunch(DetachableProcess &);
+    void launched(DetachableProcess &);
+    void stop();
+
+    quint64 values() const;
+    QString lastError() const;
+
+  signals:
+    void reading(qreal mean, qreal last, quint64 count);
+  };
+}
+
+#endif // RETURNREADER_H
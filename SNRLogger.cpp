@@ -0,0 +1,271 @@
+//
+//    SNRLogger.cpp: Background SNR time-series writer
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SNRLogger.h"
+#include "AmateurDSNHelpers.h"
+#include <sigutils/log.h>
+#include <sigutils/types.h>
+#include <cmath>
+
+// Wake the writer when this many records are pending...
+#define SNRLOGGER_BATCH_SIZE   256
+
+// ...or after this many milliseconds, whatever happens first
+#define SNRLOGGER_FLUSH_MS     1000
+
+using namespace SigDigger;
+
+SNRLogger::SNRLogger(QObject *parent) : QThread(parent)
+{
+}
+
+SNRLogger::~SNRLogger()
+{
+  stopLogging();
+}
+
+bool
+SNRLogger::startLogging(SNRLoggerParams const &params)
+{
+  if (isRunning())
+    return false;
+
+  m_params = params;
+
+  // push() never takes more than maxPending records, so this is all the
+  // queue will ever need
+  m_pending.reserve(m_params.maxPending);
+
+  m_written  = 0;
+  m_dropped  = 0;
+  m_failed   = 0;
+  m_stopping = false;
+  m_endPass  = false;
+
+  setFileName(QString());
+
+  start();
+
+  return true;
+}
+
+void
+SNRLogger::stopLogging()
+{
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+    m_cond.wakeOne();
+  }
+
+  wait();
+
+  QMutexLocker locker(&m_mutex);
+  m_stopping = false;
+}
+
+void
+SNRLogger::push(SNRRecord const &record)
+{
+  QMutexLocker locker(&m_mutex);
+
+  if (m_failed || m_pending.size() >= m_params.maxPending) {
+    ++m_dropped;
+    return;
+  }
+
+  m_pending.push_back(record);
+
+  if (m_pending.size() == SNRLOGGER_BATCH_SIZE)
+    m_cond.wakeOne();
+}
+
+void
+SNRLogger::endPass()
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_endPass = true;
+  m_cond.wakeOne();
+}
+
+quint64
+SNRLogger::written() const
+{
+  return m_written;
+}
+
+quint64
+SNRLogger::dropped() const
+{
+  return m_dropped;
+}
+
+bool
+SNRLogger::failed() const
+{
+  return m_failed != 0;
+}
+
+QString
+SNRLogger::fileName()
+{
+  QMutexLocker locker(&m_mutex);
+
+  return m_fileName;
+}
+
+QString
+SNRLogger::lastError()
+{
+  QMutexLocker locker(&m_mutex);
+
+  return m_lastError;
+}
+
+void
+SNRLogger::setFileName(QString const &name)
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_fileName = name;
+}
+
+void
+SNRLogger::fail(QString const &error)
+{
+  std::string errStr = error.toStdString();
+
+  SU_ERROR("SNR log: %s\n", errStr.c_str());
+
+  QMutexLocker locker(&m_mutex);
+  m_lastError = error;
+  m_failed    = 1;
+}
+
+static inline void
+putValue(FormatBuffer<320> &line, double value)
+{
+  line.put(',');
+
+  if (std::isfinite(value))
+    line.exponential(value, 9);
+}
+
+bool
+SNRLogger::writeRecord(SNRRecord const &rec)
+{
+  unsigned segments = m_log.segmentCount();
+
+  // First record of a pass
+  if (!m_log.isOpen()) {
+    SegmentedLogParams params;
+
+    params.directory = m_params.directory;
+    params.prefix    = m_params.prefix;
+    params.extension = m_params.format == SNR_LOG_FORMAT_BINARY ? "bin" : "csv";
+    params.binary    = m_params.format == SNR_LOG_FORMAT_BINARY;
+
+    if (!params.binary)
+      params.header =
+          "# mjd,sn,n,sn_width,n_width,snr,esnr,"
+          "sn_bpe_mode,sn_bpe_delta,n_bpe_mode,n_bpe_delta\n";
+
+    m_log.setParams(params);
+
+    if (!m_log.open(rec.time)) {
+      fail(m_log.lastError());
+      return false;
+    }
+
+    setFileName(m_log.fileName());
+  }
+
+  if (m_params.format == SNR_LOG_FORMAT_BINARY) {
+    if (!m_log.write(
+          reinterpret_cast<const char *>(&rec),
+          sizeof(SNRRecord),
+          rec.time)) {
+      fail(m_log.lastError());
+      return false;
+    }
+  } else {
+    FormatBuffer<320> line;
+
+    line.fixed(unix2mjd(rec.time), 8);
+    putValue(line, rec.signalNoise);
+    putValue(line, rec.noise);
+    putValue(line, rec.signalNoiseWidth);
+    putValue(line, rec.noiseWidth);
+    putValue(line, rec.snr);
+    putValue(line, rec.esnr);
+    putValue(line, rec.snBpeMode);
+    putValue(line, rec.snBpeDelta);
+    putValue(line, rec.nBpeMode);
+    putValue(line, rec.nBpeDelta);
+    line.put('\n');
+
+    if (!m_log.write(line.data(), line.size(), rec.time)) {
+      fail(m_log.lastError());
+      return false;
+    }
+  }
+
+  if (segments != m_log.segmentCount())
+    setFileName(m_log.fileName());
+
+  ++m_written;
+
+  return true;
+}
+
+void
+SNRLogger::run()
+{
+  std::vector<SNRRecord> batch;
+  bool stopping = false;
+  bool endPass;
+
+  batch.reserve(m_params.maxPending);
+
+  while (!stopping) {
+    {
+      QMutexLocker locker(&m_mutex);
+
+      if (!m_stopping && !m_endPass && m_pending.size() < SNRLOGGER_BATCH_SIZE)
+        m_cond.wait(&m_mutex, SNRLOGGER_FLUSH_MS);
+
+      // Both buffers keep their capacity, so this never allocates
+      batch.swap(m_pending);
+      endPass   = m_endPass;
+      stopping  = m_stopping;
+      m_endPass = false;
+    }
+
+    for (auto &rec : batch)
+      if (m_failed || !writeRecord(rec))
+        break;
+
+    batch.clear();
+
+    if (endPass || stopping)
+      m_log.close();
+    else
+      m_log.flush();
+  }
+}
@@ -0,0 +1,117 @@
+//
+//    SNRLogger.h: Background SNR time-series writer
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SNRLOGGER_H
+#define SNRLOGGER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <vector>
+#include "SegmentedLog.h"
+
+namespace SigDigger {
+  //
+  // One line of the log. Binary logs are plain sequences of these, as
+  // native-endian doubles (88 bytes per record). Unavailable values are
+  // stored as NaN.
+  //
+  struct SNRRecord {
+    double time;             // Source time stamp (Unix time)
+    double signalNoise;      // S+N power
+    double noise;            // N power
+    double signalNoiseWidth; // Hz
+    double noiseWidth;       // Hz
+    double snr;              // From densities (linear)
+    double esnr;             // SNR in the reference bandwidth (linear)
+    double snBpeMode;        // Bayesian estimation of S+N (mode, dispersion)
+    double snBpeDelta;
+    double nBpeMode;         // Bayesian estimation of N (mode, dispersion)
+    double nBpeDelta;
+  };
+
+  enum SNRLogFormat {
+    SNR_LOG_FORMAT_CSV,
+    SNR_LOG_FORMAT_BINARY
+  };
+
+  struct SNRLoggerParams {
+    QString      directory;
+    QString      prefix     = "SNR";
+    SNRLogFormat format     = SNR_LOG_FORMAT_CSV;
+    size_t       maxPending = 65536; // Records waiting to be written
+  };
+
+  //
+  // Records are pushed from any thread into a pending buffer and handed
+  // over in batches to a writer thread, which formats them and writes
+  // them through a SegmentedLog. Producers never wait for the disk: if
+  // the writer falls behind, new records are dropped and counted.
+  //
+  // Every pass (see endPass()) goes to its own segment, named after the
+  // time of its first record. Nothing is reported back per record; the
+  // GUI polls the counters and the current file name when it sees fit.
+  //
+  class SNRLogger : public QThread
+  {
+    Q_OBJECT
+
+    SNRLoggerParams m_params;
+
+    QMutex                 m_mutex;
+    QWaitCondition         m_cond;
+    std::vector<SNRRecord> m_pending;
+    bool                   m_stopping = false;
+    bool                   m_endPass  = false;
+    QString                m_fileName;
+    QString                m_lastError;
+
+    QAtomicInteger<quint64> m_written;
+    QAtomicInteger<quint64> m_dropped;
+    QAtomicInteger<int>     m_failed;
+
+    // Writer thread only
+    SegmentedLog           m_log;
+
+    bool writeRecord(SNRRecord const &);
+    void setFileName(QString const &);
+    void fail(QString const &);
+
+  protected:
+    void run() override;
+
+  public:
+    SNRLogger(QObject *parent = nullptr);
+    ~SNRLogger() override;
+
+    bool startLogging(SNRLoggerParams const &);
+    void stopLogging();
+
+    void push(SNRRecord const &);
+    void endPass();
+
+    quint64 written() const;
+    quint64 dropped() const;
+    bool    failed() const;
+    QString fileName();
+    QString lastError();
+  };
+}
+
+#endif // SNRLOGGER_H
@@ -22,8 +22,16 @@
 #include <UIMediator.h>
 #include <MainSpectrum.h>
 #include <PowerProcessor.h>
+#include "PSDProcessor.h"
+#include "NoiseWindowLocator.h"
+#include "SNRLogger.h"
+#include "AmateurDSNHelpers.h"
 #include <QClipboard>
+#include <QTimer>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QTableWidget>
+#include <cmath>
 #include <Suscan/AnalyzerRequestTracker.h>
 
 using namespace SigDigger;
@@ -41,6 +49,19 @@ SNRToolConfig::deserialize(Suscan::Object const &conf)
   LOAD(tau);
   LOAD(refbw);
   LOAD(bpe);
+  LOAD(refreshRate);
+  LOAD(synchronous);
+  LOAD(autoNoise);
+  LOAD(noiseSearchSpan);
+  LOAD(noiseRelocate);
+  LOAD(noiseHysteresis);
+  LOAD(confidence);
+  LOAD(autoFreeze);
+  LOAD(freezeInterval);
+  LOAD(logToDir);
+  LOAD(logDirPath);
+  LOAD(logFormat);
+  LOAD(logInterval);
 }
 
 Suscan::Object &&
@@ -55,6 +76,19 @@ SNRToolConfig::serialize()
   STORE(tau);
   STORE(refbw);
   STORE(bpe);
+  STORE(refreshRate);
+  STORE(synchronous);
+  STORE(autoNoise);
+  STORE(noiseSearchSpan);
+  STORE(noiseRelocate);
+  STORE(noiseHysteresis);
+  STORE(confidence);
+  STORE(autoFreeze);
+  STORE(freezeInterval);
+  STORE(logToDir);
+  STORE(logDirPath);
+  STORE(logFormat);
+  STORE(logInterval);
 
   return persist(obj);
 }
@@ -73,7 +107,12 @@ SNRTool::SNRTool(
 
   m_signalNoiseProcessor = new PowerProcessor(mediator, this);
   m_noiseProcessor       = new PowerProcessor(mediator, this);
+  m_syncProcessor        = new PSDProcessor(mediator, this);
   m_spectrum             = mediator->getMainSpectrum();
+  m_refreshTimer         = new QTimer(this);
+  m_noiseLocator         = new NoiseWindowLocator(this);
+  m_relocateTimer        = new QTimer(this);
+  m_logger               = new SNRLogger(this);
 
   setProperty("collapsed", m_panelConfig->collapsed);
 
@@ -90,6 +129,7 @@ SNRTool::SNRTool(
 
 SNRTool::~SNRTool()
 {
+  stopLogger();
   delete ui;
 }
 
@@ -120,6 +160,18 @@ SNRTool::connectAll()
         this,
         SLOT(onNoiseStateChanged(int,QString)));
 
+  connect(
+        this->m_syncProcessor,
+        SIGNAL(measurement(qreal, qreal)),
+        this,
+        SLOT(onSyncMeasurement(qreal, qreal)));
+
+  connect(
+        this->m_syncProcessor,
+        SIGNAL(stateChanged(int,QString)),
+        this,
+        SLOT(onSyncStateChanged(int,QString)));
+
   connect(
         this->ui->tauSpinBox,
         SIGNAL(changed(qreal,qreal)),
@@ -222,6 +274,66 @@ SNRTool::connectAll()
         this,
         SLOT(onConfigChanged()));
 
+  connect(
+        ui->syncCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onToggleSynchronous()));
+
+  connect(
+        ui->autoFreezeCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->freezeIntervalSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onConfigChanged()));
+
+  connect(
+        ui->logGroup,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onToggleLog()));
+
+  connect(
+        ui->logDirEdit,
+        SIGNAL(textEdited(QString)),
+        this,
+        SLOT(onLogConfigChanged()));
+
+  connect(
+        ui->logFormatCombo,
+        SIGNAL(activated(int)),
+        this,
+        SLOT(onLogConfigChanged()));
+
+  connect(
+        ui->logIntervalSpin,
+        SIGNAL(valueChanged(double)),
+        this,
+        SLOT(onLogConfigChanged()));
+
+  connect(
+        ui->logDirBrowseButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onBrowseLogDirectory()));
+
+  connect(
+        ui->autoNoiseCheck,
+        SIGNAL(toggled(bool)),
+        this,
+        SLOT(onToggleAutoNoise()));
+
+  connect(
+        m_relocateTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onRelocateTimeout()));
+
   connect(
         ui->resetBPEButton,
         SIGNAL(clicked(bool)),
@@ -233,16 +345,45 @@ SNRTool::connectAll()
         SIGNAL(clicked(bool)),
         this,
         SLOT(onCopyAll()));
+
+  connect(
+        ui->addTargetButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onAddTarget()));
+
+  connect(
+        ui->removeTargetButton,
+        SIGNAL(clicked(bool)),
+        this,
+        SLOT(onRemoveTarget()));
+
+  connect(
+        m_refreshTimer,
+        SIGNAL(timeout()),
+        this,
+        SLOT(onRefreshTimeout()));
 }
 
 void
 SNRTool::refreshUi()
 {
+  bool sync      = isSynchronous();
   bool snRunning = m_signalNoiseProcessor->isRunning();
   bool nRunning  = m_noiseProcessor->isRunning();
   bool canRun    = m_analyzer != nullptr;
   bool canAdjustSignalNoise = m_signalNoiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING;
   bool canAdjustNoise = m_noiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING;
+  bool bpe       = m_panelConfig->bpe && !sync;
+
+  // Both probes live and die together in synchronous mode. The noise
+  // buttons only pick the noise window.
+  if (sync) {
+    snRunning = m_syncProcessor->isRunning();
+    nRunning  = false;
+    canAdjustSignalNoise = canAdjustNoise =
+        m_syncProcessor->state() == PSD_PROCESSOR_STREAMING;
+  }
 
   ui->snFrequencySpin->setEnabled(canAdjustSignalNoise);
   ui->snBandwidthSpin->setEnabled(canAdjustSignalNoise);
@@ -253,22 +394,26 @@ SNRTool::refreshUi()
   ui->resetAllButton->setEnabled(snRunning || nRunning);
 
   ui->snContButton->setEnabled(!snRunning && canRun);
-  ui->snSingleButton->setEnabled(!snRunning && canRun);
+  ui->snSingleButton->setEnabled(!snRunning && canRun && !sync);
   ui->snResetButton->setEnabled(snRunning);
 
   ui->nContButton->setEnabled(!nRunning && canRun);
-  ui->nSingleButton->setEnabled(!nRunning && canRun);
-  ui->nResetButton->setEnabled(nRunning);
+  ui->nSingleButton->setEnabled(!nRunning && canRun && !sync);
+  ui->nResetButton->setEnabled(nRunning || (sync && snRunning));
 
-  ui->sigmaNoiseLabel->setVisible(m_panelConfig->bpe);
-  ui->sigmaNoiseModeLabel->setVisible(m_panelConfig->bpe);
-  ui->sigmaNoiseModeDbLabel->setVisible(m_panelConfig->bpe);
+  ui->sigmaNoiseLabel->setVisible(bpe);
+  ui->sigmaNoiseModeLabel->setVisible(bpe);
+  ui->sigmaNoiseModeDbLabel->setVisible(bpe);
 
-  ui->sigmaSignalNoiseLabel->setVisible(m_panelConfig->bpe);
-  ui->sigmaSignalNoiseModeLabel->setVisible(m_panelConfig->bpe);
-  ui->sigmaSignalNoiseModeDbLabel->setVisible(m_panelConfig->bpe);
+  ui->sigmaSignalNoiseLabel->setVisible(bpe);
+  ui->sigmaSignalNoiseModeLabel->setVisible(bpe);
+  ui->sigmaSignalNoiseModeDbLabel->setVisible(bpe);
 
-  ui->resetBPEButton->setEnabled(m_panelConfig->bpe);
+  ui->displayBayesCheck->setEnabled(!sync);
+  ui->resetBPEButton->setEnabled(bpe);
+
+  ui->addTargetButton->setEnabled(canRun);
+  ui->removeTargetButton->setEnabled(!m_targets.isEmpty());
 }
 
 // Configuration methods
@@ -291,10 +436,34 @@ SNRTool::applyConfig()
   ui->refBwSpin->setValue(m_panelConfig->refbw);
   ui->normalizeCheck->setChecked(m_panelConfig->normalize);
   ui->displayBayesCheck->setChecked(m_panelConfig->bpe);
+  BLOCKSIG(ui->syncCheck, setChecked(m_panelConfig->synchronous));
+  BLOCKSIG(ui->autoNoiseCheck, setChecked(m_panelConfig->autoNoise));
+  BLOCKSIG(ui->autoFreezeCheck, setChecked(m_panelConfig->autoFreeze));
+  BLOCKSIG(
+        ui->freezeIntervalSpin,
+        setValue(SCAST(qreal, m_panelConfig->freezeInterval)));
+
+  BLOCKSIG(ui->logGroup, setChecked(m_panelConfig->logToDir));
+  ui->logDirEdit->setText(QString::fromStdString(m_panelConfig->logDirPath));
+  ui->logFormatCombo->setCurrentIndex(
+        QString::fromStdString(m_panelConfig->logFormat).toLower() == "binary"
+        ? 1
+        : 0);
+  BLOCKSIG(
+        ui->logIntervalSpin,
+        setValue(SCAST(qreal, m_panelConfig->logInterval)));
 
   m_signalNoiseProcessor->setTau(m_panelConfig->tau);
   m_noiseProcessor->setTau(m_panelConfig->tau);
+  m_syncProcessor->setTau(SCAST(qreal, m_panelConfig->tau));
+
+  if (m_panelConfig->refreshRate > 0)
+    m_refreshTimer->setInterval(SCAST(int, 1e3 / m_panelConfig->refreshRate));
+
+  if (m_panelConfig->noiseRelocate > 0)
+    m_relocateTimer->setInterval(SCAST(int, 1e3 * m_panelConfig->noiseRelocate));
 
+  applyAutoNoise();
   refreshUi();
 }
 bool
@@ -315,18 +484,32 @@ SNRTool::event(QEvent *event)
 void
 SNRTool::setState(int, Suscan::Analyzer *analyzer)
 {
+  // Targets cannot follow us to a different analyzer. Detach them from
+  // the old one now, deleteLater() may come too late for it.
+  if (analyzer != m_analyzer) {
+    for (auto &target : m_targets) {
+      target.processor->setAnalyzer(nullptr);
+      target.processor->deleteLater();
+    }
+    m_targets.clear();
+    ui->targetsTable->setRowCount(0);
+  }
+
   m_analyzer = analyzer;
 
   m_signalNoiseProcessor->setAnalyzer(analyzer);
   m_noiseProcessor->setAnalyzer(analyzer);
+  m_syncProcessor->setAnalyzer(analyzer);
 
   if (analyzer != nullptr) {
     auto windowSize = m_mediator->getAnalyzerParams()->windowSize;
     m_signalNoiseProcessor->setFFTSizeHint(windowSize);
     m_noiseProcessor->setFFTSizeHint(windowSize);
+    m_syncProcessor->setFFTSizeHint(windowSize);
     applySpectrumState();
   }
 
+  applyAutoNoise();
   refreshUi();
 }
 
@@ -360,12 +543,21 @@ SNRTool::isFrozen() const
   return ui->freezeButton->isChecked();
 }
 
+bool
+SNRTool::isSynchronous() const
+{
+  return m_panelConfig->synchronous;
+}
+
 void
 SNRTool::refreshSignalNoiseNamedChannel()
 {
+  bool sync = isSynchronous();
   bool shouldHaveNamChan =
          m_analyzer != nullptr
-      && m_signalNoiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING;
+      && (sync
+          ? m_syncProcessor->isRunning()
+          : m_signalNoiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING);
 
   // Check whether we should have a named channel here.
   if (shouldHaveNamChan != m_haveSignalNoiseNamChan) { // Inconsistency!
@@ -374,7 +566,9 @@ SNRTool::refreshSignalNoiseNamedChannel()
     // Make sure we have a named channel
     if (m_haveSignalNoiseNamChan) {
       auto cfFreq = ui->snFrequencySpin->value();
-      auto chBw   = m_signalNoiseProcessor->getTrueBandwidth();
+      auto chBw   = sync
+          ? m_syncProcessor->getTrueWidth(PSD_PROCESSOR_SIGNAL_NOISE)
+          : m_signalNoiseProcessor->getTrueBandwidth();
 
       m_signalNoiseNamChan = this->m_mediator->getMainSpectrum()->addChannel(
             "",
@@ -393,8 +587,13 @@ SNRTool::refreshSignalNoiseNamedChannel()
 
   if (m_haveSignalNoiseNamChan) {
     qint64 cfFreq  = ui->snFrequencySpin->value();
-    auto chBw      = m_signalNoiseProcessor->getTrueBandwidth();
-    bool fullyOpen = m_signalNoiseProcessor->state() > POWER_PROCESSOR_CONFIGURING;
+    auto chBw      = sync
+        ? m_syncProcessor->getTrueWidth(PSD_PROCESSOR_SIGNAL_NOISE)
+        : m_signalNoiseProcessor->getTrueBandwidth();
+    auto maxBw     = sync ? chBw : m_signalNoiseProcessor->getMaxBandwidth();
+    bool fullyOpen = sync
+        ? m_syncProcessor->state() == PSD_PROCESSOR_STREAMING
+        : m_signalNoiseProcessor->state() > POWER_PROCESSOR_CONFIGURING;
 
     QColor color       = fullyOpen ? QColor("#ffa500") : QColor("#7f5200");
     QColor markerColor = fullyOpen ? QColor("#ffa500") : QColor("#7f5200");
@@ -403,7 +602,7 @@ SNRTool::refreshSignalNoiseNamedChannel()
 
     if (fullyOpen) {
       text = "Signal probe ("
-          + SuWidgetsHelpers::formatQuantity(m_signalNoiseProcessor->getMaxBandwidth(), 3, "Hz")
+          + SuWidgetsHelpers::formatQuantity(maxBw, 3, "Hz")
           + ")";
     } else {
       text = "Signal probe (opening)";
@@ -425,9 +624,12 @@ SNRTool::refreshSignalNoiseNamedChannel()
 void
 SNRTool::refreshNoiseNamedChannel()
 {
+  bool sync = isSynchronous();
   bool shouldHaveNamChan =
          m_analyzer != nullptr
-      && m_noiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING;
+      && (sync
+          ? m_syncProcessor->isRunning()
+          : m_noiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING);
 
   // Check whether we should have a named channel here.
   if (shouldHaveNamChan != m_haveNoiseNamChan) { // Inconsistency!
@@ -436,7 +638,9 @@ SNRTool::refreshNoiseNamedChannel()
     // Make sure we have a named channel
     if (m_haveNoiseNamChan) {
       auto cfFreq = ui->nFrequencySpin->value();
-      auto chBw   = m_noiseProcessor->getTrueBandwidth();
+      auto chBw   = sync
+          ? m_syncProcessor->getTrueWidth(PSD_PROCESSOR_NOISE)
+          : m_noiseProcessor->getTrueBandwidth();
 
       m_noiseNamChan = this->m_mediator->getMainSpectrum()->addChannel(
             "",
@@ -455,8 +659,13 @@ SNRTool::refreshNoiseNamedChannel()
 
   if (m_haveNoiseNamChan) {
     qint64 cfFreq  = ui->nFrequencySpin->value();
-    auto chBw      = m_noiseProcessor->getTrueBandwidth();
-    bool fullyOpen = m_noiseProcessor->state() > POWER_PROCESSOR_CONFIGURING;
+    auto chBw      = sync
+        ? m_syncProcessor->getTrueWidth(PSD_PROCESSOR_NOISE)
+        : m_noiseProcessor->getTrueBandwidth();
+    auto maxBw     = sync ? chBw : m_noiseProcessor->getMaxBandwidth();
+    bool fullyOpen = sync
+        ? m_syncProcessor->state() == PSD_PROCESSOR_STREAMING
+        : m_noiseProcessor->state() > POWER_PROCESSOR_CONFIGURING;
 
     QColor color       = fullyOpen ? QColor("#00ffff") : QColor("#007f7f");
     QColor markerColor = fullyOpen ? QColor("#00ffff") : QColor("#007f7f");
@@ -465,7 +674,7 @@ SNRTool::refreshNoiseNamedChannel()
 
     if (fullyOpen) {
       text = "Noise probe ("
-          + SuWidgetsHelpers::formatQuantity(m_noiseProcessor->getMaxBandwidth(), 3, "Hz")
+          + SuWidgetsHelpers::formatQuantity(maxBw, 3, "Hz")
           + ")";
     } else {
       text = "Noise probe (opening)";
@@ -491,6 +700,106 @@ SNRTool::refreshNamedChannels()
   refreshNoiseNamedChannel();
 }
 
+static void
+setQuantityLabel(QLabel *label, qreal value, unsigned digits, const char *units)
+{
+  FormatBuffer<64> text;
+
+  setLabelText(label, text.quantity(value, digits, units));
+}
+
+static void
+setDbLabel(QLabel *label, qreal db, const char *units, bool sign = true)
+{
+  FormatBuffer<32> text;
+
+  setLabelText(label, text.fixed(db, 3, sign, 6).put(' ').put(units));
+}
+
+static void
+setDbIntervalLabel(
+    QLabel *label,
+    qreal db,
+    qreal loDb,
+    qreal hiDb,
+    const char *units)
+{
+  FormatBuffer<64> text;
+
+  text.fixed(db, 3, true, 6).put(' ').put(units).put(" [");
+
+  if (std::isfinite(loDb))
+    text.fixed(loDb, 2, true);
+  else
+    text.put("-inf");
+
+  text.put(", ");
+
+  if (std::isfinite(hiDb))
+    text.fixed(hiDb, 2, true);
+  else
+    text.put("+inf");
+
+  setLabelText(label, text.put(']'));
+}
+
+static inline qreal
+toDb(qreal value)
+{
+  return value > 0 ? 10 * log10(value) : -INFINITY;
+}
+
+//
+// Two-sided interval of a power estimate with nu degrees of freedom
+//
+static void
+powerInterval(qreal power, qreal nu, qreal level, qreal &lo, qreal &hi)
+{
+  qreal upper = chiSquaredQuantile(.5 + .5 * level, nu);
+  qreal lower = chiSquaredQuantile(.5 - .5 * level, nu);
+
+  lo = upper > 0 ? power * nu / upper : 0;
+  hi = lower > 0 ? power * nu / lower : INFINITY;
+}
+
+//
+// The log of a ratio of two independent chi-squared estimates is close to
+// Gaussian, with variance 2 / nu1 + 2 / nu2.
+//
+static void
+ratioInterval(
+    qreal ratio,
+    qreal nu1,
+    qreal nu2,
+    qreal level,
+    qreal &lo,
+    qreal &hi)
+{
+  qreal z = normalQuantile(.5 + .5 * level);
+  qreal k = exp(z * sqrt(2 / nu1 + 2 / nu2));
+
+  lo = ratio / k;
+  hi = ratio * k;
+}
+
+static void
+setItemText(QTableWidget *table, int row, int col, const char *text, size_t size)
+{
+  QTableWidgetItem *item = table->item(row, col);
+  QString string = QString::fromUtf8(text, SCAST(int, size));
+
+  if (item != nullptr && item->text() != string)
+    item->setText(string);
+}
+
+static void
+setRatioLabel(QLabel *label, qreal value)
+{
+  FormatBuffer<32> text;
+
+  setLabelText(label, text.exponential(value, 4));
+}
+
 void
 SNRTool::refreshMeasurements()
 {
@@ -498,11 +807,15 @@ SNRTool::refreshMeasurements()
   qreal esnnr, esnr;
   qreal signalNoise;
   qreal noise;
-  QString units;
+  const char *units;
   const char *dbUnits;
-  bool bpe = ui->displayBayesCheck->isChecked();
+  bool bpe = ui->displayBayesCheck->isChecked() && !isSynchronous();
   qreal snScale, nScale;
   bool haveSignal, haveNoise;
+  qreal level = SCAST(qreal, m_panelConfig->confidence);
+  bool haveIntervals = !bpe && m_signalNoiseDof > 0 && m_noiseDof > 0;
+  qreal lo = 0, hi = 0;
+  qreal snnrLo = 0, snnrHi = 0;
 
   if (ui->normalizeCheck->isChecked()) {
     signalNoise = m_currentSignalNoiseDensity;
@@ -534,16 +847,10 @@ SNRTool::refreshMeasurements()
       qreal modePlusDDb  = 10 * log10(mode + delta);
       qreal deltaDb      = modePlusDDb - modeDb;
 
-      QString strMode    = SuWidgetsHelpers::formatQuantity(mode, 7, units);
-      QString strDelta   = SuWidgetsHelpers::formatQuantity(delta, 7, units);
-
-      QString strModeDb  = QString::asprintf("%+6.3f %s", modeDb, dbUnits);
-      QString strDeltaDb = QString::asprintf("%6.3f %s", deltaDb, dbUnits);
-
-      ui->spnLabel->setText(strMode);
-      ui->spnDbLabel->setText(strModeDb);
-      ui->sigmaSignalNoiseModeLabel->setText(strDelta);
-      ui->sigmaSignalNoiseModeDbLabel->setText(strDeltaDb);
+      setQuantityLabel(ui->spnLabel, mode, 7, units);
+      setDbLabel(ui->spnDbLabel, modeDb, dbUnits);
+      setQuantityLabel(ui->sigmaSignalNoiseModeLabel, delta, 7, units);
+      setDbLabel(ui->sigmaSignalNoiseModeDbLabel, deltaDb, dbUnits, false);
 
       signalNoise = mode;
     } else {
@@ -556,12 +863,21 @@ SNRTool::refreshMeasurements()
     }
   } else {
 
-    if (haveSignal) {
-      ui->spnLabel->setText(
-            SuWidgetsHelpers::formatQuantity(signalNoise, 3, units));
-      ui->spnDbLabel->setText(
-            QString::asprintf("%+6.3f %s",
-              SU_POWER_DB_RAW(SU_ASFLOAT(signalNoise)), dbUnits));
+    if (haveSignal && haveIntervals) {
+      powerInterval(signalNoise, m_signalNoiseDof, level, lo, hi);
+      setQuantityLabel(ui->spnLabel, signalNoise, 3, units);
+      setDbIntervalLabel(
+            ui->spnDbLabel,
+            SU_POWER_DB_RAW(SU_ASFLOAT(signalNoise)),
+            toDb(lo),
+            toDb(hi),
+            dbUnits);
+    } else if (haveSignal) {
+      setQuantityLabel(ui->spnLabel, signalNoise, 3, units);
+      setDbLabel(
+            ui->spnDbLabel,
+            SU_POWER_DB_RAW(SU_ASFLOAT(signalNoise)),
+            dbUnits);
     } else {
       ui->spnLabel->setText("N/A");
       ui->spnDbLabel->setText("N/A");
@@ -577,16 +893,10 @@ SNRTool::refreshMeasurements()
       qreal modePlusDDb  = 10 * log10(mode + delta);
       qreal deltaDb      = modePlusDDb - modeDb;
 
-      QString strMode    = SuWidgetsHelpers::formatQuantity(mode, 7, units);
-      QString strDelta   = SuWidgetsHelpers::formatQuantity(delta, 7, units);
-
-      QString strModeDb  = QString::asprintf("%+6.3f %s", modeDb, dbUnits);
-      QString strDeltaDb = QString::asprintf("%6.3f %s", deltaDb, dbUnits);
-
-      ui->nLabel->setText(strMode);
-      ui->nDbLabel->setText(strModeDb);
-      ui->sigmaNoiseModeLabel->setText(strDelta);
-      ui->sigmaNoiseModeDbLabel->setText(strDeltaDb);
+      setQuantityLabel(ui->nLabel, mode, 7, units);
+      setDbLabel(ui->nDbLabel, modeDb, dbUnits);
+      setQuantityLabel(ui->sigmaNoiseModeLabel, delta, 7, units);
+      setDbLabel(ui->sigmaNoiseModeDbLabel, deltaDb, dbUnits, false);
 
       noise = mode;
     } else {
@@ -598,12 +908,21 @@ SNRTool::refreshMeasurements()
       noise = -1;
     }
   } else {
-    if (haveNoise) {
-      ui->nLabel->setText(
-            SuWidgetsHelpers::formatQuantity(noise, 3, units));
-      ui->nDbLabel->setText(
-            QString::asprintf("%+6.3f %s",
-              SU_POWER_DB_RAW(SU_ASFLOAT(noise)), dbUnits));
+    if (haveNoise && haveIntervals) {
+      powerInterval(noise, m_noiseDof, level, lo, hi);
+      setQuantityLabel(ui->nLabel, noise, 3, units);
+      setDbIntervalLabel(
+            ui->nDbLabel,
+            SU_POWER_DB_RAW(SU_ASFLOAT(noise)),
+            toDb(lo),
+            toDb(hi),
+            dbUnits);
+    } else if (haveNoise) {
+      setQuantityLabel(ui->nLabel, noise, 3, units);
+      setDbLabel(
+            ui->nDbLabel,
+            SU_POWER_DB_RAW(SU_ASFLOAT(noise)),
+            dbUnits);
     } else {
       ui->nLabel->setText("N/A");
       ui->nDbLabel->setText("N/A");
@@ -612,12 +931,20 @@ SNRTool::refreshMeasurements()
 
 
   snnr = signalNoise / noise;
+  if (haveIntervals)
+    ratioInterval(snnr, m_signalNoiseDof, m_noiseDof, level, snnrLo, snnrHi);
+
   if (haveSignal && haveNoise && snnr > 0) {
-    ui->snnrLabel->setText(
-          SuWidgetsHelpers::formatScientific(snnr));
-    ui->snnrDbLabel->setText(
-          QString::asprintf("%+6.3f dB",
-            SU_POWER_DB_RAW(SU_ASFLOAT(snnr))));
+    setRatioLabel(ui->snnrLabel, snnr);
+    if (haveIntervals)
+      setDbIntervalLabel(
+            ui->snnrDbLabel,
+            SU_POWER_DB_RAW(SU_ASFLOAT(snnr)),
+            toDb(snnrLo),
+            toDb(snnrHi),
+            "dB");
+    else
+      setDbLabel(ui->snnrDbLabel, SU_POWER_DB_RAW(SU_ASFLOAT(snnr)), "dB");
   } else {
     ui->snnrLabel->setText("N/A");
     ui->snnrDbLabel->setText("N/A");
@@ -625,11 +952,26 @@ SNRTool::refreshMeasurements()
 
   snr = snnr - 1;
   if (haveSignal && haveNoise && snr > 0) {
-    ui->snrLabel->setText(
-          SuWidgetsHelpers::formatScientific(snr));
-    ui->snrDbLabel->setText(
-          QString::asprintf("%+6.3f dB",
-            SU_POWER_DB_RAW(SU_ASFLOAT(snr))));
+    setRatioLabel(ui->snrLabel, snr);
+    if (haveIntervals) {
+      lo = toDb(snnrLo - 1);
+      hi = toDb(snnrHi - 1);
+      setDbIntervalLabel(
+            ui->snrDbLabel,
+            SU_POWER_DB_RAW(SU_ASFLOAT(snr)),
+            lo,
+            hi,
+            "dB");
+
+      // Stop as soon as we know the SNR well enough
+      if (m_panelConfig->autoFreeze
+          && !this->isFrozen()
+          && std::isfinite(lo)
+          && .5 * (hi - lo) <= SCAST(qreal, m_panelConfig->freezeInterval))
+        ui->freezeButton->setChecked(true);
+    } else {
+      setDbLabel(ui->snrDbLabel, SU_POWER_DB_RAW(SU_ASFLOAT(snr)), "dB");
+    }
   } else {
     ui->snrLabel->setText("N/A");
     ui->snrDbLabel->setText("N/A");
@@ -638,11 +980,18 @@ SNRTool::refreshMeasurements()
   // The eSNR (not the eSNNR) is the easiest one to compute
   esnr = snr * m_signalNoiseWidth / m_panelConfig->refbw;
   if (haveSignal && haveNoise && esnr > 0) {
-    ui->esnrLabel->setText(
-          SuWidgetsHelpers::formatScientific(esnr));
-    ui->esnrDbLabel->setText(
-          QString::asprintf("%+6.3f dB",
-            SU_POWER_DB_RAW(SU_ASFLOAT(esnr))));
+    qreal scale = m_signalNoiseWidth / m_panelConfig->refbw;
+
+    setRatioLabel(ui->esnrLabel, esnr);
+    if (haveIntervals)
+      setDbIntervalLabel(
+            ui->esnrDbLabel,
+            SU_POWER_DB_RAW(SU_ASFLOAT(esnr)),
+            toDb((snnrLo - 1) * scale),
+            toDb((snnrHi - 1) * scale),
+            "dB");
+    else
+      setDbLabel(ui->esnrDbLabel, SU_POWER_DB_RAW(SU_ASFLOAT(esnr)), "dB");
   } else {
     ui->esnrLabel->setText("N/A");
     ui->esnrDbLabel->setText("N/A");
@@ -650,35 +999,70 @@ SNRTool::refreshMeasurements()
 
   esnnr = esnr + 1;
   if (haveSignal && haveNoise && esnnr > 0) {
-    ui->esnnrLabel->setText(
-          SuWidgetsHelpers::formatScientific(esnnr));
-    ui->esnnrDbLabel->setText(
-          QString::asprintf("%+6.3f dB",
-            SU_POWER_DB_RAW(SU_ASFLOAT(esnnr))));
+    setRatioLabel(ui->esnnrLabel, esnnr);
+    setDbLabel(ui->esnnrDbLabel, SU_POWER_DB_RAW(SU_ASFLOAT(esnnr)), "dB");
   } else {
     ui->esnnrLabel->setText("N/A");
     ui->esnnrDbLabel->setText("N/A");
   }
 
-  m_clipBoardText =
-        "S+N:   " + ui->spnLabel->text() + " (" + ui->spnDbLabel->text()
-      + ") in "
-      + SuWidgetsHelpers::formatQuantity(ui->snBandwidthSpin->value(), 6, "Hz")
-      + "\n"
-      + "N:     " + ui->nLabel->text() + " (" + ui->nDbLabel->text()
-      + ") in "
-      + SuWidgetsHelpers::formatQuantity(ui->nBandwidthSpin->value(), 6, "Hz")
-      + "\n"
-      + "SNNR:  " + ui->snnrLabel->text() + " (" + ui->snnrDbLabel->text()
-      + ")\n"
-      + "SNR:   " + ui->snrLabel->text() + " (" + ui->snrDbLabel->text()
-      + ")\n"
-      + "eSNNR: " + ui->esnnrLabel->text() + " (" + ui->esnnrDbLabel->text()
-      + ") in " + SuWidgetsHelpers::formatQuantity(ui->refBwSpin->value(), 6, "Hz")
-      + "\n"
-      + "eSNR:  " + ui->esnrLabel->text() + " (" + ui->esnrDbLabel->text()
-      + ") in " + SuWidgetsHelpers::formatQuantity(ui->refBwSpin->value(), 6, "Hz")
-      + "\n";
+  refreshTargets();
+  refreshLogStatus();
+}
+
+//
+// All targets share the noise probe, so their SNRs are computed from
+// noise densities in a single pass, regardless of their bandwidths.
+//
+void
+SNRTool::refreshTargets()
+{
+  QTableWidget *table = ui->targetsTable;
+  bool haveNoise = m_currentNoise > 0;
+  FormatBuffer<64> text;
+  int row = 0;
+
+  for (auto &target : m_targets) {
+    qreal width = target.processor->getTrueBandwidth();
+    qreal density, snr, esnr;
+
+    if (target.reading > 0 && width > 0) {
+      density = target.reading / width;
+
+      text.clear().fixed(SU_POWER_DB_RAW(SU_ASFLOAT(density)), 3, true).put(" dBpu/Hz");
+      setItemText(table, row, 1, text.data(), text.size());
+
+      snr  = haveNoise ? density / m_currentNoiseDensity - 1 : -1;
+      esnr = snr * width / m_panelConfig->refbw;
+    } else {
+      setItemText(table, row, 1, "N/A", 3);
+      snr = esnr = -1;
+    }
+
+    if (snr > 0) {
+      text.clear().fixed(SU_POWER_DB_RAW(SU_ASFLOAT(snr)), 3, true).put(" dB");
+      setItemText(table, row, 2, text.data(), text.size());
+      text.clear().fixed(SU_POWER_DB_RAW(SU_ASFLOAT(esnr)), 3, true).put(" dB");
+      setItemText(table, row, 3, text.data(), text.size());
+    } else {
+      setItemText(table, row, 2, "N/A", 3);
+      setItemText(table, row, 3, "N/A", 3);
+    }
+
+    ++row;
+  }
+}
+
+void
+SNRTool::scheduleRefresh()
+{
+  // Render right away if idle, otherwise wait for the next tick
+  if (m_refreshTimer->isActive()) {
+    m_dirty = true;
+  } else {
+    refreshMeasurements();
+    m_refreshTimer->start();
+  }
 }
 
 void
@@ -720,9 +1104,13 @@ SNRTool::openNoiseProbe(bool hold)
   auto bandwidth  = m_spectrum->getBandwidth();
   auto loFreq     = m_spectrum->getLoFreq();
   auto centerFreq = m_spectrum->getCenterFreq();
-  auto freq       = centerFreq + loFreq;
+  qreal freq      = centerFreq + loFreq;
+  NoiseWindow window;
   bool result;
 
+  if (m_panelConfig->autoNoise && locateNoiseWindow(freq, bandwidth, window))
+    freq = window.frequency;
+
   bool bwBlocked = ui->nBandwidthSpin->blockSignals(true);
   bool fcBlocked = ui->nFrequencySpin->blockSignals(true);
 
@@ -760,6 +1148,263 @@ SNRTool::cancelNoiseProbe()
   m_noiseProcessor->cancel();
 }
 
+void
+SNRTool::captureSelection(bool noise)
+{
+  auto bandwidth  = m_spectrum->getBandwidth();
+  qreal freq      = m_spectrum->getCenterFreq() + m_spectrum->getLoFreq();
+  auto bwSpin     = noise ? ui->nBandwidthSpin : ui->snBandwidthSpin;
+  auto fcSpin     = noise ? ui->nFrequencySpin : ui->snFrequencySpin;
+  NoiseWindow window;
+
+  if (noise
+      && m_panelConfig->autoNoise
+      && locateNoiseWindow(freq, bandwidth, window))
+    freq = window.frequency;
+
+  BLOCKSIG(bwSpin, setValue(bandwidth));
+  BLOCKSIG(fcSpin, setValue(freq));
+}
+
+//
+// In synchronous mode, a single inspector covers both the S+N and the
+// N probes, and both powers are integrated from the same PSD frames.
+// The noise window must have been picked (with the noise Cont button)
+// before opening.
+//
+bool
+SNRTool::haveSignalNoiseWindow() const
+{
+  if (isSynchronous())
+    return m_syncProcessor->isRunning();
+
+  return m_signalNoiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING;
+}
+
+bool
+SNRTool::haveNoiseWindow() const
+{
+  if (isSynchronous())
+    return m_syncProcessor->isRunning();
+
+  return m_noiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING;
+}
+
+//
+// Automatic noise placement looks around the signal probe, or around the
+// current selection if the signal probe is not open yet. In both cases,
+// the signal itself is excluded from the search.
+//
+bool
+SNRTool::locateNoiseWindow(qreal selFreq, qreal bandwidth, NoiseWindow &window)
+{
+  qreal center    = selFreq;
+  qreal exclusion = .5 * bandwidth;
+
+  if (haveSignalNoiseWindow()) {
+    center    = ui->snFrequencySpin->value();
+    exclusion = .5 * ui->snBandwidthSpin->value();
+  }
+
+  m_noiseLocator->setSearch(
+        center,
+        exclusion,
+        SCAST(qreal, m_panelConfig->noiseSearchSpan));
+
+  return m_noiseLocator->locate(bandwidth, window);
+}
+
+void
+SNRTool::applyAutoNoise()
+{
+  bool enabled = m_panelConfig->autoNoise && m_analyzer != nullptr;
+
+  m_noiseLocator->setAnalyzer(enabled ? m_analyzer : nullptr);
+
+  if (enabled)
+    m_relocateTimer->start();
+  else
+    m_relocateTimer->stop();
+}
+
+bool
+SNRTool::startLogger()
+{
+  SNRLoggerParams params;
+
+  if (m_logger->isRunning())
+    return true;
+
+  params.directory = QString::fromStdString(m_panelConfig->logDirPath);
+  params.format    = QString::fromStdString(m_panelConfig->logFormat).toLower() == "binary"
+      ? SNR_LOG_FORMAT_BINARY
+      : SNR_LOG_FORMAT_CSV;
+
+  m_lastLogTime = -1;
+
+  return m_logger->startLogging(params);
+}
+
+void
+SNRTool::stopLogger()
+{
+  if (m_logger->isRunning())
+    m_logger->stopLogging();
+
+  m_lastLogTime = -1;
+}
+
+//
+// Called on every reading, from the GUI thread. This must remain cheap:
+// the record is queued and all the I/O happens in the logger thread.
+//
+void
+SNRTool::logRecord()
+{
+  struct timeval tv;
+  SNRRecord rec;
+  qreal t, snnr;
+  bool bpe = !isSynchronous();
+
+  if (!m_panelConfig->logToDir || m_analyzer == nullptr)
+    return;
+
+  if (m_currentSignalNoise <= 0 || m_currentNoise <= 0)
+    return;
+
+  tv = m_analyzer->getSourceTimeStamp();
+  t  = tv.tv_sec + 1e-6 * tv.tv_usec;
+
+  // Source time may go backwards (e.g. file replay loop)
+  if (m_lastLogTime >= 0
+      && t >= m_lastLogTime
+      && t - m_lastLogTime < SCAST(qreal, m_panelConfig->logInterval))
+    return;
+
+  if (!startLogger())
+    return;
+
+  m_lastLogTime = t;
+
+  snnr = m_currentSignalNoiseDensity / m_currentNoiseDensity;
+
+  rec.time             = t;
+  rec.signalNoise      = m_currentSignalNoise;
+  rec.noise            = m_currentNoise;
+  rec.signalNoiseWidth = m_signalNoiseWidth;
+  rec.noiseWidth       = m_noiseWidth;
+  rec.snr              = snnr - 1;
+  rec.esnr             = rec.snr * m_signalNoiseWidth / m_panelConfig->refbw;
+
+  if (bpe && m_signalNoiseProcessor->haveBpe()) {
+    rec.snBpeMode  = m_signalNoiseProcessor->powerModeBpe();
+    rec.snBpeDelta = m_signalNoiseProcessor->powerDeltaBpe();
+  } else {
+    rec.snBpeMode  = rec.snBpeDelta = NAN;
+  }
+
+  if (bpe && m_noiseProcessor->haveBpe()) {
+    rec.nBpeMode  = m_noiseProcessor->powerModeBpe();
+    rec.nBpeDelta = m_noiseProcessor->powerDeltaBpe();
+  } else {
+    rec.nBpeMode  = rec.nBpeDelta = NAN;
+  }
+
+  m_logger->push(rec);
+}
+
+//
+// A pass lasts while there are continuous measurements. Each pass gets
+// its own log segment.
+//
+void
+SNRTool::updatePass()
+{
+  bool active;
+
+  if (isSynchronous())
+    active = m_syncProcessor->state() == PSD_PROCESSOR_STREAMING;
+  else
+    active = m_signalNoiseProcessor->state() == POWER_PROCESSOR_STREAMING
+        || m_noiseProcessor->state() == POWER_PROCESSOR_STREAMING;
+
+  if (m_passActive && !active && m_logger->isRunning())
+    m_logger->endPass();
+
+  m_passActive = active;
+}
+
+void
+SNRTool::refreshLogStatus()
+{
+  QString text;
+
+  if (!m_logger->isRunning())
+    return;
+
+  if (m_logger->failed()) {
+    ui->currLogFileEdit->setStyleSheet("font-style: italic");
+    text = "Failed: " + m_logger->lastError();
+  } else {
+    ui->currLogFileEdit->setStyleSheet("");
+    text = m_logger->fileName();
+    if (m_logger->dropped() > 0)
+      text += QString::asprintf(" (%llu dropped)", m_logger->dropped());
+  }
+
+  if (ui->currLogFileEdit->text() != text)
+    ui->currLogFileEdit->setText(text);
+}
+
+void
+SNRTool::openSyncProbe()
+{
+  PSDWindow signalNoise, noise;
+
+  captureSelection(false);
+
+  signalNoise.frequency = ui->snFrequencySpin->value();
+  signalNoise.bandwidth = ui->snBandwidthSpin->value();
+  noise.frequency       = ui->nFrequencySpin->value();
+  noise.bandwidth       = ui->nBandwidthSpin->value();
+
+  if (m_analyzer == nullptr)
+    return;
+
+  if (noise.bandwidth <= 0) {
+    QMessageBox::warning(
+          this,
+          "No noise window",
+          "Please select the noise window first (use the Cont button of the "
+          "noise probe)");
+    return;
+  }
+
+  if (!m_syncProcessor->startStreaming(signalNoise, noise)) {
+    QMessageBox::critical(
+          this,
+          "Cannot open inspector",
+          "Failed to open raw inspector. See log window for details");
+  }
+}
+
+void
+SNRTool::updateSyncWindows()
+{
+  PSDWindow signalNoise, noise;
+
+  if (!m_syncProcessor->isRunning())
+    return;
+
+  signalNoise.frequency = ui->snFrequencySpin->value();
+  signalNoise.bandwidth = ui->snBandwidthSpin->value();
+  noise.frequency       = ui->nFrequencySpin->value();
+  noise.bandwidth       = ui->nBandwidthSpin->value();
+
+  m_syncProcessor->setWindows(signalNoise, noise);
+  refreshNamedChannels();
+}
+
 void
 SNRTool::applySpectrumState()
 {
@@ -782,7 +1427,10 @@ SNRTool::applySpectrumState()
 void
 SNRTool::onSignalNoiseCont()
 {
-  openSignalNoiseProbe(true);
+  if (isSynchronous())
+    openSyncProbe();
+  else
+    openSignalNoiseProbe(true);
 }
 
 void
@@ -794,13 +1442,19 @@ SNRTool::onSignalNoiseSingle()
 void
 SNRTool::onSignalNoiseCancel()
 {
+  m_syncProcessor->cancel();
   cancelSignalNoiseProbe();
 }
 
 void
 SNRTool::onNoiseCont()
 {
-  openNoiseProbe(true);
+  if (isSynchronous()) {
+    captureSelection(true);
+    updateSyncWindows();
+  } else {
+    openNoiseProbe(true);
+  }
 }
 
 void
@@ -812,6 +1466,7 @@ SNRTool::onNoiseSingle()
 void
 SNRTool::onNoiseCancel()
 {
+  m_syncProcessor->cancel();
   cancelNoiseProbe();
 }
 
@@ -830,6 +1485,7 @@ SNRTool::onSignalNoiseStateChanged(int state, QString const &desc)
 
   ui->snStateLabel->setText(desc);
   refreshSignalNoiseNamedChannel();
+  updatePass();
   refreshUi();
 }
 
@@ -839,10 +1495,12 @@ SNRTool::onSignalNoiseMeasurement(qreal reading)
   if (!this->isFrozen()) {
     m_currentSignalNoise = reading;
     m_currentSignalNoiseDensity = reading / m_signalNoiseProcessor->getTrueBandwidth();
+    m_signalNoiseDof = m_signalNoiseProcessor->getDegreesOfFreedom();
     m_signalNoiseWidth = m_signalNoiseProcessor->getTrueBandwidth();
     m_noiseWidth       = m_noiseProcessor->getTrueBandwidth();
     m_widthRatio       = m_signalNoiseWidth / m_noiseWidth;
-    this->refreshMeasurements();
+    this->logRecord();
+    this->scheduleRefresh();
   }
 }
 
@@ -861,6 +1519,7 @@ SNRTool::onNoiseStateChanged(int state, QString const &desc)
 
   ui->nStateLabel->setText(desc);
   refreshNoiseNamedChannel();
+  updatePass();
   refreshUi();
 }
 
@@ -870,10 +1529,245 @@ SNRTool::onNoiseMeasurement(qreal reading)
   if (!this->isFrozen()) {
     m_currentNoise = reading;
     m_currentNoiseDensity = reading / m_noiseProcessor->getTrueBandwidth();
+    m_noiseDof = m_noiseProcessor->getDegreesOfFreedom();
     m_signalNoiseWidth = m_signalNoiseProcessor->getTrueBandwidth();
     m_noiseWidth       = m_noiseProcessor->getTrueBandwidth();
     m_widthRatio       = m_signalNoiseWidth / m_noiseWidth;
-    this->refreshMeasurements();
+    this->logRecord();
+    this->scheduleRefresh();
+  }
+}
+
+void
+SNRTool::onSyncStateChanged(int, QString const &desc)
+{
+  ui->snStateLabel->setText(desc);
+  ui->nStateLabel->setText(desc);
+  refreshNamedChannels();
+  updatePass();
+  refreshUi();
+}
+
+void
+SNRTool::onSyncMeasurement(qreal signalNoise, qreal noise)
+{
+  if (!this->isFrozen()) {
+    m_signalNoiseWidth = m_syncProcessor->getTrueWidth(PSD_PROCESSOR_SIGNAL_NOISE);
+    m_noiseWidth       = m_syncProcessor->getTrueWidth(PSD_PROCESSOR_NOISE);
+    m_widthRatio       = m_signalNoiseWidth / m_noiseWidth;
+
+    m_currentSignalNoise        = signalNoise;
+    m_currentNoise              = noise;
+    m_currentSignalNoiseDensity = signalNoise / m_signalNoiseWidth;
+    m_currentNoiseDensity       = noise / m_noiseWidth;
+    m_signalNoiseDof = m_syncProcessor->getDegreesOfFreedom(PSD_PROCESSOR_SIGNAL_NOISE);
+    m_noiseDof       = m_syncProcessor->getDegreesOfFreedom(PSD_PROCESSOR_NOISE);
+    this->logRecord();
+    this->scheduleRefresh();
+  }
+}
+
+void
+SNRTool::onToggleSynchronous()
+{
+  // Switching modes invalidates whatever was being measured
+  m_syncProcessor->cancel();
+  cancelSignalNoiseProbe();
+  cancelNoiseProbe();
+
+  m_panelConfig->synchronous = ui->syncCheck->isChecked();
+
+  refreshNamedChannels();
+  refreshUi();
+  refreshMeasurements();
+}
+
+void
+SNRTool::onToggleLog()
+{
+  m_panelConfig->logToDir = ui->logGroup->isChecked();
+
+  if (!m_panelConfig->logToDir) {
+    stopLogger();
+    ui->currLogFileEdit->setText("N/A");
+    ui->currLogFileEdit->setStyleSheet("");
+  }
+}
+
+void
+SNRTool::onLogConfigChanged()
+{
+  std::string dir    = ui->logDirEdit->text().toStdString();
+  std::string format = ui->logFormatCombo->currentIndex() == 0
+      ? "csv"
+      : "binary";
+
+  m_panelConfig->logInterval = SU_ASFLOAT(ui->logIntervalSpin->value());
+
+  // The next record will open a log with the new settings
+  if (dir != m_panelConfig->logDirPath || format != m_panelConfig->logFormat) {
+    m_panelConfig->logDirPath = dir;
+    m_panelConfig->logFormat  = format;
+    stopLogger();
+  }
+}
+
+void
+SNRTool::onBrowseLogDirectory()
+{
+  QString dir;
+
+  dir = QFileDialog::getExistingDirectory(
+        this,
+        "Select log directory",
+        QString::fromStdString(m_panelConfig->logDirPath));
+
+  if (dir.size() > 0) {
+    ui->logDirEdit->setText(dir);
+    onLogConfigChanged();
+  }
+}
+
+void
+SNRTool::onToggleAutoNoise()
+{
+  m_panelConfig->autoNoise = ui->autoNoiseCheck->isChecked();
+  applyAutoNoise();
+}
+
+//
+// Moves a continuous noise probe only if the new spot is better than the
+// current one by more than the hysteresis, to avoid hopping around.
+//
+void
+SNRTool::onRelocateTimeout()
+{
+  qreal freq = ui->nFrequencySpin->value();
+  qreal bw   = ui->nBandwidthSpin->value();
+  NoiseWindow current, best;
+
+  if (!haveNoiseWindow() || this->isFrozen())
+    return;
+
+  if (!isSynchronous() && m_noiseProcessor->state() != POWER_PROCESSOR_STREAMING)
+    return;
+
+  if (!locateNoiseWindow(freq, bw, best))
+    return;
+
+  if (m_noiseLocator->evaluate(freq, bw, current)
+      && best.score + SCAST(qreal, m_panelConfig->noiseHysteresis) >= current.score)
+    return;
+
+  // This triggers onNoiseAdjust, which does the rest
+  ui->nFrequencySpin->setValue(best.frequency);
+}
+
+void
+SNRTool::onAddTarget()
+{
+  auto bandwidth  = m_spectrum->getBandwidth();
+  auto loFreq     = m_spectrum->getLoFreq();
+  auto centerFreq = m_spectrum->getCenterFreq();
+  auto freq       = centerFreq + loFreq;
+  QTableWidget *table = ui->targetsTable;
+  FormatBuffer<64> text;
+  SNRTarget target;
+  int row;
+
+  if (m_analyzer == nullptr)
+    return;
+
+  target.processor = new PowerProcessor(m_mediator, this);
+  target.frequency = freq;
+
+  target.processor->setAnalyzer(m_analyzer);
+  target.processor->setFFTSizeHint(m_mediator->getAnalyzerParams()->windowSize);
+  target.processor->setTau(SCAST(qreal, m_panelConfig->tau));
+
+  connect(
+        target.processor,
+        SIGNAL(stateChanged(int, QString const &)),
+        this,
+        SLOT(onTargetStateChanged(int, QString const &)));
+
+  connect(
+        target.processor,
+        SIGNAL(measurement(qreal)),
+        this,
+        SLOT(onTargetMeasurement(qreal)));
+
+  if (!target.processor->startStreaming(freq, bandwidth)) {
+    target.processor->cancel();
+    target.processor->deleteLater();
+    QMessageBox::critical(
+          this,
+          "Cannot open inspector",
+          "Failed to open power inspector. See log window for details");
+    return;
+  }
+
+  m_targets.append(target);
+
+  row = table->rowCount();
+  table->insertRow(row);
+
+  text.quantity(freq, 9, "Hz");
+  table->setItem(row, 0, new QTableWidgetItem(QString::fromUtf8(text.data(), SCAST(int, text.size()))));
+  table->setItem(row, 1, new QTableWidgetItem("N/A"));
+  table->setItem(row, 2, new QTableWidgetItem("N/A"));
+  table->setItem(row, 3, new QTableWidgetItem("N/A"));
+
+  refreshUi();
+}
+
+void
+SNRTool::onRemoveTarget()
+{
+  int row = ui->targetsTable->currentRow();
+
+  if (row < 0 || row >= m_targets.size())
+    return;
+
+  m_targets[row].processor->cancel();
+  m_targets[row].processor->deleteLater();
+  m_targets.remove(row);
+  ui->targetsTable->removeRow(row);
+
+  refreshUi();
+}
+
+int
+SNRTool::findTarget(QObject *processor) const
+{
+  for (int i = 0; i < m_targets.size(); ++i)
+    if (m_targets[i].processor == processor)
+      return i;
+
+  return -1;
+}
+
+void
+SNRTool::onTargetStateChanged(int, QString const &desc)
+{
+  int row = findTarget(sender());
+  QTableWidgetItem *item;
+
+  if (row >= 0 && (item = ui->targetsTable->item(row, 0)) != nullptr)
+    item->setToolTip(desc);
+}
+
+void
+SNRTool::onTargetMeasurement(qreal reading)
+{
+  int row;
+
+  if (this->isFrozen())
+    return;
+
+  if ((row = findTarget(sender())) >= 0) {
+    m_targets[row].reading = reading;
+    this->scheduleRefresh();
   }
 }
 
@@ -884,11 +1778,20 @@ SNRTool::onTauChanged(qreal time, qreal)
 
   m_signalNoiseProcessor->setTau(time);
   m_noiseProcessor->setTau(time);
+  m_syncProcessor->setTau(time);
+
+  for (auto &target : m_targets)
+    target.processor->setTau(time);
 }
 
 void
 SNRTool::onSignalNoiseAdjust()
 {
+  if (isSynchronous()) {
+    updateSyncWindows();
+    return;
+  }
+
   if (m_signalNoiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING) {
     m_signalNoiseProcessor->setBandwidth(ui->snBandwidthSpin->value());
     m_signalNoiseProcessor->setFrequency(ui->snFrequencySpin->value());
@@ -898,6 +1801,11 @@ SNRTool::onSignalNoiseAdjust()
 void
 SNRTool::onNoiseAdjust()
 {
+  if (isSynchronous()) {
+    updateSyncWindows();
+    return;
+  }
+
   if (m_noiseProcessor->state() >= POWER_PROCESSOR_CONFIGURING) {
     m_noiseProcessor->setBandwidth(ui->nBandwidthSpin->value());
     m_noiseProcessor->setFrequency(ui->nFrequencySpin->value());
@@ -916,6 +1824,8 @@ SNRTool::onConfigChanged()
 {
   m_panelConfig->normalize = ui->normalizeCheck->isChecked();
   m_panelConfig->refbw     = ui->refBwSpin->value();
+  m_panelConfig->autoFreeze     = ui->autoFreezeCheck->isChecked();
+  m_panelConfig->freezeInterval = SU_ASFLOAT(ui->freezeIntervalSpin->value());
 
   if (m_panelConfig->bpe != ui->displayBayesCheck->isChecked()) {
     m_panelConfig->bpe       = ui->displayBayesCheck->isChecked();
@@ -928,7 +1838,46 @@ SNRTool::onConfigChanged()
 void
 SNRTool::onCopyAll()
 {
-  QApplication::clipboard()->setText(m_clipBoardText);
+  QString text;
+
+  if (m_dirty) {
+    m_dirty = false;
+    refreshMeasurements();
+  }
+
+  text =
+        "S+N:   " + ui->spnLabel->text() + " (" + ui->spnDbLabel->text()
+      + ") in "
+      + SuWidgetsHelpers::formatQuantity(ui->snBandwidthSpin->value(), 6, "Hz")
+      + "\n"
+      + "N:     " + ui->nLabel->text() + " (" + ui->nDbLabel->text()
+      + ") in "
+      + SuWidgetsHelpers::formatQuantity(ui->nBandwidthSpin->value(), 6, "Hz")
+      + "\n"
+      + "SNNR:  " + ui->snnrLabel->text() + " (" + ui->snnrDbLabel->text()
+      + ")\n"
+      + "SNR:   " + ui->snrLabel->text() + " (" + ui->snrDbLabel->text()
+      + ")\n"
+      + "eSNNR: " + ui->esnnrLabel->text() + " (" + ui->esnnrDbLabel->text()
+      + ") in " + SuWidgetsHelpers::formatQuantity(ui->refBwSpin->value(), 6, "Hz")
+      + "\n"
+      + "eSNR:  " + ui->esnrLabel->text() + " (" + ui->esnrDbLabel->text()
+      + ") in " + SuWidgetsHelpers::formatQuantity(ui->refBwSpin->value(), 6, "Hz")
+      + "\n"
+      + "Intervals at " + QString::number(100 * m_panelConfig->confidence) + "% confidence\n";
+
+  QApplication::clipboard()->setText(text);
+}
+
+void
+SNRTool::onRefreshTimeout()
+{
+  if (m_dirty) {
+    m_dirty = false;
+    refreshMeasurements();
+  } else {
+    m_refreshTimer->stop();
+  }
 }
 
 void
@@ -21,8 +21,11 @@
 
 #include <SNRToolFactory.h>
 #include <QWidget>
+#include <QVector>
 #include <WFHelpers.h>
 
+class QTimer;
+
 namespace Ui {
   class SNRTool;
 }
@@ -34,7 +37,21 @@ namespace Suscan {
 
 namespace SigDigger {
   class PowerProcessor;
+  class PSDProcessor;
+  class NoiseWindowLocator;
+  class SNRLogger;
+  struct NoiseWindow;
   class MainSpectrum;
+
+  //
+  // Additional S+N probes, all measured against the same noise probe
+  //
+  struct SNRTarget {
+    PowerProcessor *processor = nullptr;
+    qreal frequency = 0;
+    qreal reading   = -1; // Last S+N reading (power)
+  };
+
   class SNRToolConfig : public Suscan::Serializable {
   public:
     float tau = 1;
@@ -42,6 +59,20 @@ namespace SigDigger {
     bool normalize = true;
     float refbw = 1;
     bool bpe = false;
+    float refreshRate = 20; // Hz
+    bool synchronous = false;
+    bool autoNoise = false;
+    float noiseSearchSpan = 50e3; // Hz, around the signal probe
+    float noiseRelocate = 5;      // Seconds between re-evaluations
+    float noiseHysteresis = 1;    // dB
+    float confidence = 0.95;      // Confidence level of the intervals
+    bool autoFreeze = false;
+    float freezeInterval = 0.5;   // dB, half-width of the SNR interval
+
+    bool logToDir = false;
+    std::string logDirPath = "";
+    std::string logFormat = "csv";
+    float logInterval = 1;        // Seconds of source time, 0: every reading
 
     // Overriden methods
     void deserialize(Suscan::Object const &conf) override;
@@ -65,6 +96,8 @@ namespace SigDigger {
     qreal m_widthRatio                = +1;
     qreal m_signalNoiseWidth          = +1;
     qreal m_noiseWidth                = +1;
+    qreal m_signalNoiseDof            = 0; // Degrees of freedom
+    qreal m_noiseDof                  = 0;
 
     NamedChannelSetIterator m_signalNoiseNamChan;
     bool m_haveSignalNoiseNamChan = false;
@@ -74,9 +107,21 @@ namespace SigDigger {
 
     PowerProcessor *m_signalNoiseProcessor = nullptr;
     PowerProcessor *m_noiseProcessor = nullptr;
+    PSDProcessor   *m_syncProcessor = nullptr;
+    NoiseWindowLocator *m_noiseLocator = nullptr;
+    QTimer         *m_relocateTimer = nullptr;
+
+    // SNR logging
+    SNRLogger      *m_logger = nullptr;
+    qreal           m_lastLogTime = -1;
+    bool            m_passActive = false;
+    QVector<SNRTarget> m_targets;
 
     SNRToolConfig *m_panelConfig = nullptr;
-    QString m_clipBoardText;
+
+    // Measurements are rendered at most at refreshRate
+    QTimer *m_refreshTimer = nullptr;
+    bool    m_dirty = false;
     // In hold mode:
     //    We set the integration time to T_i = MAX(100 ms, 1 / equiv_fs)
     //    We configure the alpha to tau / T_i
@@ -95,9 +140,28 @@ namespace SigDigger {
     void cancelSignalNoiseProbe();
     void cancelNoiseProbe();
 
+    bool isSynchronous() const;
+    void captureSelection(bool noise);
+    void openSyncProbe();
+    void updateSyncWindows();
+
+    bool haveSignalNoiseWindow() const;
+    bool haveNoiseWindow() const;
+    bool locateNoiseWindow(qreal selFreq, qreal bandwidth, NoiseWindow &);
+    void applyAutoNoise();
+
+    bool startLogger();
+    void stopLogger();
+    void logRecord();
+    void updatePass();
+    void refreshLogStatus();
+
     void refreshUi();
     void connectAll();
     void refreshMeasurements();
+    void refreshTargets();
+    void scheduleRefresh();
+    int  findTarget(QObject *) const;
     bool isFrozen() const;
     void refreshSignalNoiseNamedChannel();
     void refreshNoiseNamedChannel();
@@ -139,11 +203,26 @@ namespace SigDigger {
     void onNoiseStateChanged(int, QString const &);
     void onNoiseMeasurement(qreal);
 
+    void onSyncStateChanged(int, QString const &);
+    void onSyncMeasurement(qreal, qreal);
+    void onToggleSynchronous();
+    void onToggleAutoNoise();
+    void onRelocateTimeout();
+    void onToggleLog();
+    void onLogConfigChanged();
+    void onBrowseLogDirectory();
+
+    void onAddTarget();
+    void onRemoveTarget();
+    void onTargetStateChanged(int, QString const &);
+    void onTargetMeasurement(qreal);
+
     void onTauChanged(qreal, qreal);
     void onConfigChanged();
     void onResetBpe();
 
     void onCopyAll();
+    void onRefreshTimeout();
 
   private:
     Ui::SNRTool *ui;
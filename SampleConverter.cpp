@@ -0,0 +1,203 @@
+//
+//    SampleConverter.cpp: Output sample format conversion
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SampleConverter.h"
+#include <volk/volk.h>
+#include <algorithm>
+
+// Triangular dither of +/-1 LSB, read at a random offset for each block
+#define SAMPLE_CONVERTER_DITHER_SIZE 65536
+
+using namespace SigDigger;
+
+static const char *g_formatNames[] = {"cf32", "cf64", "cs16", "cs8"};
+
+uint32_t
+SampleConverter::nextRandom()
+{
+  // xorshift32, more than enough for dither
+  m_rng ^= m_rng << 13;
+  m_rng ^= m_rng >> 17;
+  m_rng ^= m_rng << 5;
+
+  return m_rng;
+}
+
+void
+SampleConverter::makeDitherTable()
+{
+  const float k = 1.f / 4294967296.f;
+
+  m_ditherTable.resize(SAMPLE_CONVERTER_DITHER_SIZE);
+
+  for (auto &d : m_ditherTable)
+    d = k * static_cast<float>(nextRandom())
+      - k * static_cast<float>(nextRandom());
+}
+
+void
+SampleConverter::setFormat(SampleFormat format, float scale, bool dither)
+{
+  m_format = format;
+  m_scale  = scale;
+  m_dither = dither && (format == SAMPLE_FORMAT_CS16 || format == SAMPLE_FORMAT_CS8);
+
+  if (m_dither && m_ditherTable.empty())
+    makeDitherTable();
+}
+
+SampleFormat
+SampleConverter::format() const
+{
+  return m_format;
+}
+
+unsigned
+SampleConverter::sampleSize() const
+{
+  switch (m_format) {
+    case SAMPLE_FORMAT_CF64:
+      return 2 * sizeof(double);
+
+    case SAMPLE_FORMAT_CS16:
+      return 2 * sizeof(int16_t);
+
+    case SAMPLE_FORMAT_CS8:
+      return 2 * sizeof(int8_t);
+
+    default:
+      return 2 * sizeof(float);
+  }
+}
+
+// Scales the block to integer units and adds dither if enabled. Values
+// are left in the scratch buffer, ready for a conversion with scalar 1.
+const float *
+SampleConverter::prepare(const float *input, size_t count, float fullScale)
+{
+  unsigned n = static_cast<unsigned>(count);
+
+  m_scratch.resize(count);
+  volk_32f_s32f_multiply_32f(m_scratch.data(), input, m_scale * fullScale, n);
+
+  if (m_dither) {
+    size_t p = 0;
+
+    while (p < count) {
+      size_t offset = nextRandom() % (SAMPLE_CONVERTER_DITHER_SIZE / 2);
+      size_t chunk  = std::min(count - p, m_ditherTable.size() - offset);
+
+      volk_32f_x2_add_32f(
+            m_scratch.data() + p,
+            m_scratch.data() + p,
+            m_ditherTable.data() + offset,
+            static_cast<unsigned>(chunk));
+
+      p += chunk;
+    }
+  }
+
+  return m_scratch.data();
+}
+
+const void *
+SampleConverter::convert(const SUCOMPLEX *samples, size_t count, size_t &bytes)
+{
+  const float *input;
+  size_t n = 2 * count; // Real and imaginary parts
+
+  bytes = count * sampleSize();
+
+  // sigutils may be built with double precision
+  if (sizeof(SUCOMPLEX) != 2 * sizeof(float)) {
+    const SUFLOAT *values = reinterpret_cast<const SUFLOAT *>(samples);
+
+    m_scratch.resize(n);
+    for (size_t i = 0; i < n; ++i)
+      m_scratch[i] = static_cast<float>(values[i]);
+
+    input = m_scratch.data();
+  } else {
+    input = reinterpret_cast<const float *>(samples);
+  }
+
+  if (m_format == SAMPLE_FORMAT_CF32 && m_scale == 1.f)
+    return input;
+
+  m_buffer.resize(bytes);
+
+  switch (m_format) {
+    case SAMPLE_FORMAT_CF32:
+      volk_32f_s32f_multiply_32f(
+            reinterpret_cast<float *>(m_buffer.data()),
+            input,
+            m_scale,
+            static_cast<unsigned>(n));
+      break;
+
+    case SAMPLE_FORMAT_CF64:
+      volk_32f_convert_64f(
+            reinterpret_cast<double *>(m_buffer.data()),
+            input,
+            static_cast<unsigned>(n));
+
+      if (m_scale != 1.f) {
+        double *out = reinterpret_cast<double *>(m_buffer.data());
+        for (size_t i = 0; i < n; ++i)
+          out[i] *= m_scale;
+      }
+      break;
+
+    case SAMPLE_FORMAT_CS16:
+      volk_32f_s32f_convert_16i(
+            reinterpret_cast<int16_t *>(m_buffer.data()),
+            prepare(input, n, 32767.f),
+            1.f,
+            static_cast<unsigned>(n));
+      break;
+
+    case SAMPLE_FORMAT_CS8:
+      volk_32f_s32f_convert_8i(
+            reinterpret_cast<int8_t *>(m_buffer.data()),
+            prepare(input, n, 127.f),
+            1.f,
+            static_cast<unsigned>(n));
+      break;
+  }
+
+  return m_buffer.data();
+}
+
+QString
+SampleConverter::formatName(SampleFormat format)
+{
+  return g_formatNames[format];
+}
+
+bool
+SampleConverter::parseFormat(QString const &name, SampleFormat &format)
+{
+  for (unsigned i = 0; i < sizeof(g_formatNames) / sizeof(g_formatNames[0]); ++i) {
+    if (name == g_formatNames[i]) {
+      format = static_cast<SampleFormat>(i);
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,69 @@
+//
+//    SampleConverter.h: Output sample format conversion
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SAMPLECONVERTER_H
+#define SAMPLECONVERTER_H
+
+#include <sigutils/types.h>
+#include <QString>
+#include <vector>
+#include <cstdint>
+
+namespace SigDigger {
+  enum SampleFormat {
+    SAMPLE_FORMAT_CF32, // Interleaved 32-bit floats, native
+    SAMPLE_FORMAT_CF64, // Interleaved 64-bit floats
+    SAMPLE_FORMAT_CS16, // Interleaved signed 16-bit integers
+    SAMPLE_FORMAT_CS8,  // Interleaved signed 8-bit integers
+  };
+
+  //
+  // Turns the inspector's SUCOMPLEX blocks into the format the consumer
+  // wants. Conversions run on volk kernels into a buffer that is reused
+  // between calls. For integer formats, a scale of 1 maps the unit
+  // circle to full scale; values beyond it are clipped.
+  //
+  class SampleConverter
+  {
+    SampleFormat m_format = SAMPLE_FORMAT_CF32;
+    float        m_scale  = 1;
+    bool         m_dither = false;
+
+    std::vector<uint8_t> m_buffer;
+    std::vector<float>   m_scratch;
+    std::vector<float>   m_ditherTable;
+    uint32_t             m_rng = 0x2545f491;
+
+    uint32_t nextRandom();
+    void     makeDitherTable();
+    const float *prepare(const float *, size_t, float fullScale);
+
+  public:
+    void setFormat(SampleFormat, float scale = 1, bool dither = false);
+    SampleFormat format() const;
+    unsigned sampleSize() const;
+
+    // Returns a pointer to the converted block, valid until the next call
+    const void *convert(const SUCOMPLEX *, size_t count, size_t &bytes);
+
+    static QString formatName(SampleFormat);
+    static bool    parseFormat(QString const &, SampleFormat &);
+  };
+}
+
+#endif // SAMPLECONVERTER_H
@@ -0,0 +1,810 @@
+//
+//    SampleWriter.cpp: Writer thread for forwarded samples
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SampleWriter.h"
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define SAMPLE_WRITER_SLOTS    4096 // Power of two
+#define SAMPLE_WRITER_MAX_IOV  16
+#define SAMPLE_WRITER_POLL_MS  100
+#define SAMPLE_WRITER_RECLAIM_MS 2
+#define SAMPLE_WRITER_MASK     (SAMPLE_WRITER_SLOTS - 1)
+
+#if defined(__linux__) && defined(SPLICE_F_GIFT)
+#  define SAMPLE_WRITER_HAVE_VMSPLICE
+#endif
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0 // Darwin: SO_NOSIGPIPE is set by the sink
+#endif
+
+using namespace SigDigger;
+
+static inline qint64
+monotonicNs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+SampleWriter::SampleWriter(QObject *parent) : QThread(parent)
+{
+  m_slots.resize(SAMPLE_WRITER_SLOTS);
+  m_spare.reserve(SAMPLE_WRITER_SLOTS);
+}
+
+SampleWriter::~SampleWriter()
+{
+  stopWriting();
+  freeBuffers();
+}
+
+// Pages still in a pipe survive the unmap: the pipe holds them
+void
+SampleWriter::freeBuffers()
+{
+  for (auto &block : m_slots) {
+    if (block.data != nullptr)
+      munmap(block.data, block.capacity);
+
+    block.data     = nullptr;
+    block.capacity = 0;
+  }
+
+  for (auto &buffer : m_spare)
+    munmap(buffer.data, buffer.capacity);
+
+  m_spare.clear();
+  m_spareBytes = 0;
+  m_harvest    = 0;
+}
+
+void
+SampleWriter::startWriting(
+    int fd,
+    size_t capacity,
+    ForwarderOverflowPolicy policy,
+    SampleWriterMode mode)
+{
+  stopWriting();
+
+  // The previous reader may still be draining the last pages we lent
+  freeBuffers();
+
+  m_fd         = fd;
+  m_mode       = mode;
+  m_capacity   = capacity;
+  m_overflow   = policy;
+  m_paused     = false;
+  m_headOffset = 0;
+  m_dequeued   = 0;
+
+  m_head.storeRelease(0);
+  m_tail.storeRelease(0);
+  m_released.storeRelease(0);
+  m_pending.storeRelease(0);
+  m_written.storeRelease(0);
+  m_dropped.storeRelease(0);
+  m_lost.storeRelease(0);
+  m_discarded.storeRelease(0);
+  m_discardedAt.storeRelease(0);
+  m_latency.storeRelease(0);
+  m_broken.storeRelease(0);
+  m_stopping.storeRelease(0);
+  m_sleeping.storeRelease(0);
+  m_trim.storeRelease(0);
+  m_holding.storeRelease(0);
+  m_keep.storeRelease(0);
+
+  fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+  resetPipe();
+
+  start();
+}
+
+// A new descriptor references none of our slots. Lending them is only
+// possible if we can tell when the reader is done with them.
+void
+SampleWriter::resetPipe()
+{
+  m_piped  = 0;
+  m_lent   = false;
+  m_splice = false;
+
+#ifdef SAMPLE_WRITER_HAVE_VMSPLICE
+  if (m_mode == SAMPLE_WRITER_PIPE) {
+    int queued;
+    m_splice = ioctl(m_fd, FIONREAD, &queued) != -1;
+  }
+#endif
+
+  m_released.storeRelease(m_tail.loadAcquire());
+}
+
+void
+SampleWriter::setRetain(bool retain)
+{
+  m_retain = retain;
+}
+
+// Moves the queue to a new descriptor. The block that was being written
+// to the old one is dropped, as its beginning went to a reader that no
+// longer exists.
+void
+SampleWriter::switchTo(int fd)
+{
+  if (isRunning()) {
+    m_keep.storeRelease(1);
+    m_stopping.storeRelease(1);
+    wake();
+    wait();
+  }
+
+  discardPartial();
+
+  m_fd = fd;
+
+  m_broken.storeRelease(0);
+  m_holding.storeRelease(0);
+  m_stopping.storeRelease(0);
+  m_sleeping.storeRelease(0);
+  m_keep.storeRelease(0);
+
+  fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+  resetPipe();
+
+  start();
+}
+
+void
+SampleWriter::stopWriting()
+{
+  if (!isRunning())
+    return;
+
+  m_stopping.storeRelease(1);
+  wake();
+  wait();
+}
+
+void
+SampleWriter::wake()
+{
+  QMutexLocker locker(&m_mutex);
+  m_cond.wakeOne();
+}
+
+// Producer side. Slots behind m_released are no longer referenced by
+// the writer nor by the pipe.
+void
+SampleWriter::harvest(quint32 released)
+{
+  for (; m_harvest != released; ++m_harvest) {
+    SampleBlock &block = m_slots[m_harvest & SAMPLE_WRITER_MASK];
+
+    if (block.data == nullptr)
+      continue;
+
+    if (m_spareBytes + block.capacity <= m_capacity) {
+      m_spare.push_back({block.data, block.capacity});
+      m_spareBytes += block.capacity;
+    } else {
+      munmap(block.data, block.capacity);
+    }
+
+    block.data     = nullptr;
+    block.capacity = 0;
+  }
+}
+
+// Gives the slot a buffer of at least size bytes: the last spare if it
+// fits and is not much larger, fresh pages otherwise.
+bool
+SampleWriter::attachBuffer(SampleBlock &block, size_t size)
+{
+  size_t page     = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t capacity = (size + page - 1) / page * page;
+  void *data;
+
+  if (!m_spare.empty()) {
+    SampleBuffer buffer = m_spare.back();
+
+    m_spare.pop_back();
+    m_spareBytes -= buffer.capacity;
+
+    if (buffer.capacity >= capacity && buffer.capacity <= 2 * capacity) {
+      block.data     = buffer.data;
+      block.capacity = buffer.capacity;
+      return true;
+    }
+
+    munmap(buffer.data, buffer.capacity);
+  }
+
+  // Fresh pages rather than heap memory: a buffer may be unmapped while
+  // a pipe still references it, and nothing else must reuse them.
+  data = mmap(
+        nullptr,
+        capacity,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  block.data     = static_cast<char *>(data);
+  block.capacity = capacity;
+
+  return true;
+}
+
+bool
+SampleWriter::push(const void *data, size_t size)
+{
+  return push(nullptr, 0, data, size);
+}
+
+bool
+SampleWriter::push(
+    const void *header,
+    size_t hdrSize,
+    const void *data,
+    size_t size)
+{
+  quint32 head, released;
+  quint64 pending;
+  bool drop = false;
+
+  if (m_broken.loadAcquire()) {
+    m_dropped.fetchAndAddRelaxed(hdrSize + size);
+    m_lost.fetchAndAddRelaxed(size);
+    return false;
+  }
+
+  head     = m_head.loadAcquire();
+  released = m_released.loadAcquire();
+  pending  = m_pending.loadAcquire();
+
+  if (m_paused && 2 * pending <= m_capacity)
+    m_paused = false;
+
+  if (m_paused) {
+    drop = true;
+  } else if (pending + size > m_capacity) {
+    switch (m_overflow) {
+      case FORWARDER_OVERFLOW_DROP_OLDEST:
+        // The writer makes room. Meanwhile we may go over budget, but
+        // never beyond twice the capacity.
+        m_trim.storeRelease(1);
+        drop = pending + size > 2 * m_capacity;
+        if (m_sleeping.loadAcquire())
+          wake();
+        break;
+
+      case FORWARDER_OVERFLOW_PAUSE:
+        m_paused = true;
+        drop = true;
+        break;
+
+      default:
+        drop = true;
+    }
+  }
+
+  if (drop || head - released >= SAMPLE_WRITER_SLOTS) {
+    m_dropped.fetchAndAddRelaxed(hdrSize + size);
+    m_lost.fetchAndAddRelaxed(size);
+    return false;
+  }
+
+  harvest(released);
+
+  SampleBlock &block = m_slots[head & SAMPLE_WRITER_MASK];
+
+  if (!attachBuffer(block, hdrSize + size)) {
+    m_dropped.fetchAndAddRelaxed(hdrSize + size);
+    m_lost.fetchAndAddRelaxed(size);
+    return false;
+  }
+
+  if (hdrSize > 0)
+    memcpy(block.data, header, hdrSize);
+
+  memcpy(block.data + hdrSize, data, size);
+  block.payload = size;
+  size         += hdrSize;
+  block.size    = size;
+  block.queued  = monotonicNs();
+
+  m_pending.fetchAndAddOrdered(size);
+  m_head.fetchAndStoreOrdered(head + 1);
+
+  // Pairs with the writer raising m_sleeping and re-checking m_head
+  if (m_sleeping.loadAcquire())
+    wake();
+
+  return true;
+}
+
+// Writer side of DROP_OLDEST. The block being written is never touched,
+// so the stream stays aligned to whole samples.
+void
+SampleWriter::trim()
+{
+  quint32 head = m_head.loadAcquire();
+  quint32 tail = m_tail.loadAcquire();
+
+  if (m_headOffset > 0)
+    return;
+
+  while (tail != head && m_pending.loadAcquire() > m_capacity) {
+    discard(tail, m_slots[tail & SAMPLE_WRITER_MASK].size);
+    retire(tail, m_piped);
+    m_tail.storeRelease(++tail);
+  }
+}
+
+void
+SampleWriter::discardAll()
+{
+  quint32 head = m_head.loadAcquire();
+  quint32 tail = m_tail.loadAcquire();
+
+  if (tail != head && m_headOffset > 0) {
+    discard(tail, m_slots[tail & SAMPLE_WRITER_MASK].size - m_headOffset);
+    retire(tail++, m_piped);
+  }
+
+  while (tail != head) {
+    discard(tail, m_slots[tail & SAMPLE_WRITER_MASK].size);
+    retire(tail++, m_piped);
+  }
+
+  m_headOffset = 0;
+  m_tail.storeRelease(tail);
+}
+
+void
+SampleWriter::discardPartial()
+{
+  quint32 tail = m_tail.loadAcquire();
+
+  if (m_headOffset > 0) {
+    discard(tail, m_slots[tail & SAMPLE_WRITER_MASK].size - m_headOffset);
+    m_headOffset = 0;
+    retire(tail, m_piped);
+    m_tail.storeRelease(tail + 1);
+  }
+}
+
+// Writer side. A late reset from latency() may hide one sample, which
+// is fine for a statistic.
+void
+SampleWriter::observe(qint64 latency)
+{
+  if (latency > m_latency.loadAcquire())
+    m_latency.storeRelease(latency);
+}
+
+// A stalled reader stalls the queue, and nothing gets written that
+// could tell. The block at the front is the one that waited longest.
+void
+SampleWriter::observeOldest()
+{
+  quint32 tail = m_tail.loadAcquire();
+
+  if (tail != m_head.loadAcquire())
+    observe(monotonicNs() - m_slots[tail & SAMPLE_WRITER_MASK].queued);
+}
+
+// A write to a pipe without reader leaves a SIGPIPE pending on this
+// thread (see run()). Take it, so it is not delivered if the mask is
+// ever lifted.
+static void
+consumeBrokenPipe()
+{
+  sigset_t pending;
+  sigset_t set;
+  int sig;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+
+  if (sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE))
+    sigwait(&set, &sig);
+}
+
+void
+SampleWriter::retire(quint32 slot, quint64 end)
+{
+  m_slots[slot & SAMPLE_WRITER_MASK].end = end;
+}
+
+// Writer side. Drops the last left bytes of a queued block. Only the
+// samples among them are lost: the header comes first.
+void
+SampleWriter::discard(quint32 slot, size_t left)
+{
+  SampleBlock &block = m_slots[slot & SAMPLE_WRITER_MASK];
+  size_t samples = left < block.payload ? left : block.payload;
+
+  m_pending.fetchAndSubOrdered(left);
+  m_dropped.fetchAndAddRelaxed(left);
+
+  if (samples > 0) {
+    m_lost.fetchAndAddRelaxed(samples);
+    m_discardedAt.storeRelease(m_dequeued + block.payload - samples);
+    m_discarded.fetchAndAddOrdered(samples);
+  }
+
+  m_dequeued += block.payload;
+}
+
+// Hands back to the producer the slots the reader has already consumed.
+// Without a reader, whatever is left in the pipe will never be read.
+void
+SampleWriter::reclaim()
+{
+  quint32 tail     = m_tail.loadAcquire();
+  quint32 released = m_released.loadAcquire();
+  quint64 consumed;
+  int queued = 0;
+
+  if (released == tail)
+    return;
+
+  if (!m_lent
+      || m_holding.loadAcquire()
+      || m_broken.loadAcquire()
+      || ioctl(m_fd, FIONREAD, &queued) == -1) {
+    m_released.storeRelease(tail);
+    return;
+  }
+
+  consumed = m_piped - static_cast<quint64>(queued);
+
+  while (released != tail && m_slots[released & SAMPLE_WRITER_MASK].end <= consumed)
+    ++released;
+
+  m_released.storeRelease(released);
+}
+
+ssize_t
+SampleWriter::transmit(struct iovec *iov, unsigned count)
+{
+#ifdef SAMPLE_WRITER_HAVE_VMSPLICE
+  if (m_splice) {
+    size_t total = 0;
+    ssize_t got;
+
+    for (unsigned i = 0; i < count; ++i)
+      total += iov[i].iov_len;
+
+    // Every segment takes a pipe buffer of its own, so small blocks are
+    // better copied.
+    if (total >= count * static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+      got = vmsplice(m_fd, iov, count, SPLICE_F_NONBLOCK | SPLICE_F_GIFT);
+
+      if (got >= 0) {
+        m_lent = true;
+        return got;
+      }
+
+      if (errno != EINVAL && errno != ENOSYS)
+        return got;
+
+      m_splice = false;
+    }
+  }
+#endif
+
+  if (m_mode == SAMPLE_WRITER_SOCKET) {
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = count;
+
+    return sendmsg(m_fd, &msg, MSG_NOSIGNAL);
+  }
+
+  return writev(m_fd, iov, static_cast<int>(count));
+}
+
+// One datagram per block. Datagrams are never partially sent: if one
+// is refused (nobody listening on a local port), it is counted as
+// dropped and we move on.
+bool
+SampleWriter::drainDatagrams()
+{
+  for (;;) {
+    quint32 head  = m_head.loadAcquire();
+    quint32 tail  = m_tail.loadAcquire();
+    unsigned count = 0;
+    qint64 now;
+    int sent;
+
+    if (tail == head)
+      return true;
+
+#ifdef __linux__
+    struct mmsghdr msgs[SAMPLE_WRITER_MAX_IOV];
+    struct iovec   iov[SAMPLE_WRITER_MAX_IOV];
+
+    memset(msgs, 0, sizeof(msgs));
+
+    for (quint32 i = tail; i != head && count < SAMPLE_WRITER_MAX_IOV; ++i) {
+      SampleBlock &block = m_slots[i & SAMPLE_WRITER_MASK];
+
+      iov[count].iov_base = block.data;
+      iov[count].iov_len  = block.size;
+      msgs[count].msg_hdr.msg_iov    = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      ++count;
+    }
+
+    sent = sendmmsg(m_fd, msgs, count, MSG_NOSIGNAL);
+#else
+    SampleBlock &first = m_slots[tail & SAMPLE_WRITER_MASK];
+
+    count = 1;
+    sent  = send(m_fd, first.data, first.size, MSG_NOSIGNAL) < 0 ? -1 : 1;
+#endif
+
+    if (sent < 0) {
+      if (errno == EINTR)
+        continue;
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+        return false;
+
+      // Lose this datagram only
+      discard(tail, m_slots[tail & SAMPLE_WRITER_MASK].size);
+      m_tail.storeRelease(tail + 1);
+      continue;
+    }
+
+    now = monotonicNs();
+
+    for (int i = 0; i < sent; ++i) {
+      size_t size = m_slots[tail & SAMPLE_WRITER_MASK].size;
+
+      observe(now - m_slots[tail & SAMPLE_WRITER_MASK].queued);
+      m_written.fetchAndAddRelaxed(size);
+      m_pending.fetchAndSubOrdered(size);
+      m_dequeued += m_slots[tail & SAMPLE_WRITER_MASK].payload;
+      ++tail;
+    }
+
+    m_tail.storeRelease(tail);
+  }
+}
+
+// Writes as much as the descriptor takes. Returns false if it is full.
+bool
+SampleWriter::drain()
+{
+  if (m_mode == SAMPLE_WRITER_DATAGRAM)
+    return drainDatagrams();
+
+  struct iovec iov[SAMPLE_WRITER_MAX_IOV];
+
+  for (;;) {
+    quint32 head  = m_head.loadAcquire();
+    quint32 tail  = m_tail.loadAcquire();
+    unsigned count = 0;
+    qint64 now;
+    ssize_t got;
+
+    if (tail == head)
+      return true;
+
+    for (quint32 i = tail; i != head && count < SAMPLE_WRITER_MAX_IOV; ++i) {
+      SampleBlock &block = m_slots[i & SAMPLE_WRITER_MASK];
+      size_t skip = count == 0 ? m_headOffset : 0;
+
+      iov[count].iov_base = block.data + skip;
+      iov[count].iov_len  = block.size - skip;
+      ++count;
+    }
+
+    got = transmit(iov, count);
+
+    if (got < 0) {
+      int error = errno;
+
+      if (error == EINTR)
+        continue;
+
+      if (error == EAGAIN || error == EWOULDBLOCK)
+        return false;
+
+      if (error == EPIPE)
+        consumeBrokenPipe();
+
+      // The reader is gone (EPIPE) or the descriptor is unusable
+      if (m_retain) {
+        discardPartial();
+        m_holding.storeRelease(1);
+        return true;
+      }
+
+      m_broken.storeRelease(error);
+      discardAll();
+      return true;
+    }
+
+    m_written.fetchAndAddRelaxed(static_cast<quint64>(got));
+    m_pending.fetchAndSubOrdered(static_cast<quint64>(got));
+    now = monotonicNs();
+
+    while (got > 0) {
+      size_t left = m_slots[tail & SAMPLE_WRITER_MASK].size - m_headOffset;
+
+      if (static_cast<size_t>(got) < left) {
+        m_headOffset += static_cast<size_t>(got);
+        m_piped      += static_cast<quint64>(got);
+        got = 0;
+      } else {
+        got     -= static_cast<ssize_t>(left);
+        m_piped += left;
+        m_headOffset = 0;
+        m_dequeued  += m_slots[tail & SAMPLE_WRITER_MASK].payload;
+        observe(now - m_slots[tail & SAMPLE_WRITER_MASK].queued);
+        retire(tail++, m_piped);
+      }
+    }
+
+    m_tail.storeRelease(tail);
+  }
+}
+
+void
+SampleWriter::run()
+{
+  struct pollfd pfd;
+  sigset_t set;
+
+  // writev() and vmsplice() on a pipe whose reader is gone raise SIGPIPE,
+  // and its default action takes SigDigger down with the consumer. The
+  // signal goes to the thread that wrote, so blocking it here is enough
+  // to get EPIPE instead, whatever the rest of the process does with it.
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+  pfd.fd     = m_fd;
+  pfd.events = POLLOUT;
+
+  while (!m_stopping.loadAcquire()) {
+    if (m_trim.fetchAndStoreOrdered(0))
+      trim();
+
+    observeOldest();
+
+    if (m_broken.loadAcquire()) {
+      discardAll();
+    } else if (!m_holding.loadAcquire() && !drain()) {
+      // Full. Wait for room, but keep an eye on trims and stops.
+      reclaim();
+      poll(&pfd, 1, SAMPLE_WRITER_POLL_MS);
+      continue;
+    }
+
+    reclaim();
+
+    m_sleeping.fetchAndStoreOrdered(1);
+
+    {
+      QMutexLocker locker(&m_mutex);
+
+      // Lent slots come back as the reader consumes them, which nothing
+      // signals. Look again shortly.
+      unsigned long timeout =
+          m_released.loadAcquire() != m_tail.loadAcquire()
+          ? SAMPLE_WRITER_RECLAIM_MS
+          : SAMPLE_WRITER_POLL_MS;
+
+      if ((m_head.loadAcquire() == m_tail.loadAcquire()
+           || m_holding.loadAcquire())
+          && !m_stopping.loadAcquire())
+        m_cond.wait(&m_mutex, timeout);
+    }
+
+    m_sleeping.storeRelease(0);
+  }
+
+  if (!m_keep.loadAcquire())
+    discardAll();
+}
+
+quint64
+SampleWriter::written() const
+{
+  return m_written.loadAcquire();
+}
+
+quint64
+SampleWriter::dropped() const
+{
+  return m_dropped.loadAcquire();
+}
+
+quint64
+SampleWriter::lost() const
+{
+  return m_lost.loadAcquire();
+}
+
+quint64
+SampleWriter::discarded() const
+{
+  return m_discarded.loadAcquire();
+}
+
+quint64
+SampleWriter::discardedAt() const
+{
+  return m_discardedAt.loadAcquire();
+}
+
+size_t
+SampleWriter::pending() const
+{
+  return static_cast<size_t>(m_pending.loadAcquire());
+}
+
+bool
+SampleWriter::broken() const
+{
+  return m_broken.loadAcquire() != 0;
+}
+
+int
+SampleWriter::error() const
+{
+  return m_broken.loadAcquire();
+}
+
+bool
+SampleWriter::holding() const
+{
+  return m_holding.loadAcquire() != 0;
+}
+
+qint64
+SampleWriter::latency()
+{
+  return m_latency.fetchAndStoreOrdered(0);
+}
@@ -0,0 +1,195 @@
+//
+//    SampleWriter.h: Writer thread for forwarded samples
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SAMPLEWRITER_H
+#define SAMPLEWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <vector>
+#include <sys/types.h>
+#include "ForwarderSink.h"
+
+struct iovec;
+
+namespace SigDigger {
+  enum SampleWriterMode {
+    SAMPLE_WRITER_STREAM,   // Files: writev()
+    SAMPLE_WRITER_PIPE,     // Pipes: vmsplice() where available, or writev()
+    SAMPLE_WRITER_SOCKET,   // Stream sockets: sendmsg(), no SIGPIPE
+    SAMPLE_WRITER_DATAGRAM, // Connected datagram sockets, one block each
+  };
+
+  struct SampleBuffer {
+    char   *data;
+    size_t  capacity;
+  };
+
+  struct SampleBlock {
+    char   *data     = nullptr; // Whole pages, owned while queued
+    size_t  capacity = 0;
+    size_t  size     = 0;
+    size_t  payload  = 0;       // Sample bytes, header excluded
+    quint64 end      = 0;       // Pipe offset right after its last byte
+    qint64  queued   = 0;       // When it was pushed, monotonic ns
+  };
+
+  //
+  // Moves sample blocks from the GUI thread to a file descriptor (the
+  // write end of a pipe, a socket...) from a thread of its own.
+  //
+  // Blocks go through a single-producer, single-consumer ring of slots
+  // indexed by two atomics: push() never takes a lock unless the writer
+  // is asleep, and never waits for the descriptor. The writer gathers
+  // consecutive blocks into one writev() and, while the descriptor is
+  // full, sleeps in poll() so it can still trim the queue and be stopped.
+  //
+  // The byte budget and overflow policy work as in the sinks: the
+  // producer drops new blocks, the writer trims old ones.
+  //
+  // Datagram sockets send every block as one datagram, batched with
+  // sendmmsg() where available.
+  //
+  // dropped() counts whole blocks, headers included, like pending() and
+  // written(). lost() only counts sample bytes, which is what framed
+  // streams report to the consumer. Sample bytes the writer discards
+  // after push() accepted them are also counted by discarded(), along
+  // with where the last run of them began in the accepted stream.
+  //
+  // Blocks are stamped when queued, so the writer can tell how long
+  // they waited for the descriptor.
+  //
+  // Slots do not keep their buffers. Once released, the producer takes
+  // them back into a list of spares, which never holds more than the
+  // byte budget, so memory follows what is in flight rather than the
+  // number of slots.
+  //
+  // In retain mode, losing the reader does not empty the queue: blocks
+  // keep accumulating (within budget) until switchTo() hands us the
+  // descriptor of the next reader.
+  //
+  // On Linux, pipes are fed with vmsplice(): the pages of the slots are
+  // lent to the pipe instead of copied into it. A slot lent this way
+  // cannot be refilled until the reader has consumed it, so the producer
+  // only reuses slots behind m_released, which the writer advances by
+  // asking the pipe how much is still unread (FIONREAD).
+  //
+  class SampleWriter : public QThread
+  {
+    Q_OBJECT
+
+    int    m_fd       = -1;
+    size_t m_capacity = 0;
+    SampleWriterMode m_mode = SAMPLE_WRITER_STREAM;
+    ForwarderOverflowPolicy m_overflow = FORWARDER_OVERFLOW_DROP_OLDEST;
+
+    std::vector<SampleBlock> m_slots;
+    QAtomicInteger<quint32>  m_head;     // Next slot to fill (producer)
+    QAtomicInteger<quint32>  m_tail;     // Next slot to write (writer)
+    QAtomicInteger<quint32>  m_released; // First slot the pipe may reference
+    QAtomicInteger<quint64>  m_pending;  // Bytes queued, not yet written
+    QAtomicInteger<quint64>  m_written;
+    QAtomicInteger<quint64>  m_dropped;
+    QAtomicInteger<quint64>  m_lost;        // Sample bytes only
+    QAtomicInteger<quint64>  m_discarded;   // Sample bytes, by the writer
+    QAtomicInteger<quint64>  m_discardedAt;
+    QAtomicInteger<qint64>   m_latency;  // Worst wait since latency()
+    QAtomicInteger<int>      m_broken;   // errno of the failure, 0 if none
+    QAtomicInteger<int>      m_stopping;
+    QAtomicInteger<int>      m_sleeping;
+    QAtomicInteger<int>      m_trim;
+    QAtomicInteger<int>      m_holding;  // Reader gone, waiting for another
+    QAtomicInteger<int>      m_keep;     // Stop without discarding
+    bool                     m_retain = false;
+
+    // Producer only
+    bool   m_paused = false;
+    quint32 m_harvest = 0;   // Next released slot whose buffer we take back
+    size_t m_spareBytes = 0;
+    std::vector<SampleBuffer> m_spare;
+
+    // Only used to park the writer when there is nothing to do
+    QMutex         m_mutex;
+    QWaitCondition m_cond;
+
+    // Writer only
+    size_t  m_headOffset = 0; // Bytes of the tail slot already written
+    quint64 m_dequeued   = 0; // Sample bytes written or discarded
+    quint64 m_piped      = 0; // Bytes written to the current pipe
+    bool    m_splice     = false;
+    bool    m_lent       = false; // Some slot went through vmsplice()
+
+    void wake();
+    void harvest(quint32 released);
+    bool attachBuffer(SampleBlock &, size_t size);
+    void freeBuffers();
+    void retire(quint32 slot, quint64 end);
+    void discard(quint32 slot, size_t left);
+    void observe(qint64 latency);
+    void observeOldest();
+    void reclaim();
+    void trim();
+    ssize_t transmit(struct iovec *, unsigned);
+    bool drain();
+    bool drainDatagrams();
+    void discardAll();
+    void discardPartial();
+    void resetPipe();
+
+  protected:
+    void run() override;
+
+  public:
+    SampleWriter(QObject *parent = nullptr);
+    ~SampleWriter() override;
+
+    // The descriptor is made non-blocking. It is not closed.
+    void startWriting(
+        int fd,
+        size_t capacity,
+        ForwarderOverflowPolicy,
+        SampleWriterMode = SAMPLE_WRITER_STREAM);
+    void stopWriting();
+
+    void setRetain(bool);
+    void switchTo(int fd);
+
+    bool push(const void *data, size_t size);
+
+    // Queues header and data as a single block
+    bool push(const void *header, size_t hdrSize, const void *data, size_t size);
+
+    quint64 written() const;
+    quint64 dropped() const;
+    quint64 lost() const;
+    quint64 discarded() const;
+    quint64 discardedAt() const;
+    size_t  pending() const;
+    bool    broken() const;
+    int     error() const;
+    bool    holding() const;
+
+    // Longest a block waited to be written since the last call (ns),
+    // including the one at the front of the queue if still waiting.
+    qint64  latency();
+  };
+}
+
+#endif // SAMPLEWRITER_H
@@ -0,0 +1,458 @@
+//
+//    SegmentedLog.cpp: Log files split in rotated, compressed segments
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SegmentedLog.h"
+#include "AmateurDSNHelpers.h"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QVector>
+#include <sigutils/log.h>
+#include <sigutils/types.h>
+#include <zlib.h>
+#include <ctime>
+#include <cmath>
+
+#define ADSN_COMPRESS_CHUNK 65536
+#define SEGMENTED_LOG_COUNT_WIDTH 12
+
+using namespace SigDigger;
+
+///////////////////////////// Compression task /////////////////////////////////
+namespace SigDigger {
+  //
+  // Gzips a closed segment in the global thread pool. On success, its
+  // manifest line is marked as compressed and the original is removed.
+  //
+  class SegmentCompressTask : public QRunnable
+  {
+    QString m_path;
+    QString m_manifestPath;
+    qint64  m_field; // Offset of the compression field, -1 if none
+
+    bool markCompressed();
+
+  public:
+    SegmentCompressTask(
+        QString const &path,
+        QString const &manifestPath,
+        qint64 field) :
+      m_path(path), m_manifestPath(manifestPath), m_field(field) { }
+    void run() override;
+  };
+}
+
+// Both values have the same length, so the line is patched in place
+// while the log may still be appending to the manifest.
+bool
+SegmentCompressTask::markCompressed()
+{
+  QFile manifest(m_manifestPath);
+
+  if (m_field < 0)
+    return true;
+
+  if (!manifest.open(QIODevice::ReadWrite)
+      || !manifest.seek(m_field)
+      || manifest.write("gzip", 4) != 4) {
+    SU_ERROR(
+          "Cannot update manifest %s: %s\n",
+          m_manifestPath.toStdString().c_str(),
+          manifest.errorString().toStdString().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void
+SegmentCompressTask::run()
+{
+  QFile in(m_path);
+  QByteArray gzPath = QFile::encodeName(m_path + ".gz");
+  QVector<char> buffer(ADSN_COMPRESS_CHUNK);
+  gzFile out;
+  qint64 got;
+  bool ok = true;
+
+  if (!in.open(QIODevice::ReadOnly)) {
+    SU_ERROR(
+          "Cannot compress %s: %s\n",
+          m_path.toStdString().c_str(),
+          in.errorString().toStdString().c_str());
+    return;
+  }
+
+  if ((out = gzopen(gzPath.constData(), "wb")) == nullptr) {
+    SU_ERROR("Cannot create %s\n", gzPath.constData());
+    return;
+  }
+
+  while ((got = in.read(buffer.data(), buffer.size())) > 0) {
+    if (gzwrite(out, buffer.data(), SCAST(unsigned, got)) != got) {
+      ok = false;
+      break;
+    }
+  }
+
+  if (got < 0)
+    ok = false;
+
+  if (gzclose(out) != Z_OK)
+    ok = false;
+
+  // Until the manifest says so, the original is the segment
+  if (ok && markCompressed()) {
+    in.remove();
+  } else {
+    SU_ERROR("Failed to compress %s, keeping it\n", m_path.toStdString().c_str());
+    QFile::remove(QFile::decodeName(gzPath));
+  }
+}
+
+////////////////////////////// SegmentedLog ////////////////////////////////////
+SegmentedLog::SegmentedLog()
+{
+}
+
+SegmentedLog::~SegmentedLog()
+{
+  close();
+}
+
+bool
+SegmentedLog::openSegment(qreal unixTime)
+{
+  time_t secs = SCAST(time_t, floor(unixTime));
+  struct tm parts;
+  QString stem;
+  QString path;
+  long counter = 0;
+
+  gmtime_r(&secs, &parts);
+
+  do {
+    stem = m_params.prefix + QString::asprintf(
+          "_%04d%02d%02d_%02d%02d%02d_%04ld",
+          parts.tm_year + 1900,
+          parts.tm_mon + 1,
+          parts.tm_mday,
+          parts.tm_hour,
+          parts.tm_min,
+          parts.tm_sec,
+          ++counter);
+    path = m_params.directory + "/" + stem + "." + m_params.extension;
+  } while (QFile::exists(path) || QFile::exists(path + ".gz"));
+
+  m_file.setFileName(path);
+  if (!m_file.open(
+        m_params.binary
+        ? QIODevice::ReadWrite
+        : QIODevice::ReadWrite | QIODevice::Text)) {
+    m_lastError = path + ": " + m_file.errorString();
+    return false;
+  }
+
+  if (!m_params.header.isEmpty()
+      && m_file.write(m_params.header) != m_params.header.size()) {
+    m_lastError = path + ": " + m_file.errorString();
+    m_file.close();
+    return false;
+  }
+
+  if (m_params.indexInterval > 0) {
+    m_index.setFileName(path + ".idx");
+    if (!m_index.open(QIODevice::WriteOnly | QIODevice::Text)) {
+      SU_ERROR(
+            "Cannot create index %s: %s\n",
+            m_index.fileName().toStdString().c_str(),
+            m_index.errorString().toStdString().c_str());
+    } else {
+      m_index.write("# mjd,offset\n");
+    }
+  }
+
+  if (m_segments == 0)
+    m_manifestPath = m_params.directory + "/" + stem + ".manifest";
+
+  m_fileName = stem + "." + m_params.extension;
+  m_bytes    = SCAST(quint64, m_params.header.size());
+  m_records  = 0;
+  m_firstMjd = m_lastMjd = unix2mjd(unixTime);
+  m_hour     = SCAST(qint64, floor(unixTime / 3600));
+
+  ++m_segments;
+
+  beginManifestEntry();
+
+  return true;
+}
+
+// Manifest line of the current segment. Counters are zero-padded so
+// that the line keeps its length as the segment grows, and can be
+// rewritten in place when the segment is closed.
+QByteArray
+SegmentedLog::manifestLine(const char *compression) const
+{
+  FormatBuffer<160> line;
+
+  line
+      .put(',').fixed(m_firstMjd, 7)
+      .put(',').fixed(m_lastMjd, 7)
+      .put(',').integer(SCAST(int64_t, m_records), SEGMENTED_LOG_COUNT_WIDTH)
+      .put(',').integer(SCAST(int64_t, m_bytes), SEGMENTED_LOG_COUNT_WIDTH)
+      .put(',').put(compression)
+      .put('\n');
+
+  return m_fileName.toUtf8()
+      + QByteArray(line.data(), SCAST(int, line.size()));
+}
+
+// The segment is listed as "open" as soon as it is created, so that it
+// is not lost from the manifest if we never get to close it.
+void
+SegmentedLog::beginManifestEntry()
+{
+  QFile manifest(m_manifestPath);
+  QByteArray line = manifestLine("open");
+  bool isNew = !manifest.exists();
+
+  m_lineStart = -1;
+
+  // Binary, so offsets are those of the file everywhere
+  if (!manifest.open(QIODevice::Append)) {
+    SU_ERROR(
+          "Cannot update manifest %s: %s\n",
+          m_manifestPath.toStdString().c_str(),
+          manifest.errorString().toStdString().c_str());
+    return;
+  }
+
+  if (isNew)
+    manifest.write("# segment,first_mjd,last_mjd,records,bytes,compression\n");
+
+  m_lineStart = manifest.size();
+  m_lineSize  = line.size();
+
+  if (manifest.write(line) != line.size())
+    m_lineStart = -1;
+}
+
+// Closed segments are listed uncompressed. SegmentCompressTask corrects
+// the line once the compressed file is there. Returns the offset of the
+// compression field, or -1 if the line could not be written.
+qint64
+SegmentedLog::finishManifestEntry()
+{
+  QFile manifest(m_manifestPath);
+  QByteArray line = manifestLine("none");
+  qint64 start;
+
+  // The open line is only replaced if the new one fits exactly (i.e.
+  // unless the counters overflowed their width). Otherwise, the new
+  // line is appended and supersedes it.
+  if (m_lineStart >= 0 && line.size() == m_lineSize) {
+    if (!manifest.open(QIODevice::ReadWrite)
+        || !manifest.seek(m_lineStart)) {
+      SU_ERROR(
+            "Cannot update manifest %s: %s\n",
+            m_manifestPath.toStdString().c_str(),
+            manifest.errorString().toStdString().c_str());
+      return -1;
+    }
+    start = m_lineStart;
+  } else {
+    if (!manifest.open(QIODevice::Append)) {
+      SU_ERROR(
+            "Cannot update manifest %s: %s\n",
+            m_manifestPath.toStdString().c_str(),
+            manifest.errorString().toStdString().c_str());
+      return -1;
+    }
+    start = manifest.size();
+  }
+
+  if (manifest.write(line) != line.size())
+    return -1;
+
+  return start + line.size() - 5;
+}
+
+void
+SegmentedLog::appendToIndex(qreal mjd)
+{
+  FormatBuffer<64> line;
+
+  line
+      .fixed(mjd, 7).put(',')
+      .integer(SCAST(int64_t, m_bytes)).put('\n');
+
+  if (m_index.write(line.data(), SCAST(qint64, line.size())) < 0) {
+    SU_ERROR(
+          "Cannot write to index %s, disabling it\n",
+          m_index.fileName().toStdString().c_str());
+    m_index.close();
+  }
+}
+
+void
+SegmentedLog::closeSegment()
+{
+  QString path = m_file.fileName();
+  qint64 field;
+
+  m_file.close();
+  if (m_index.isOpen())
+    m_index.close();
+  field = finishManifestEntry();
+
+  if (m_params.compress && m_bytes > 0)
+    QThreadPool::globalInstance()->start(
+          new SegmentCompressTask(path, m_manifestPath, field));
+}
+
+bool
+SegmentedLog::needsRotation(size_t len, qreal unixTime) const
+{
+  if (m_records == 0)
+    return false;
+
+  if (m_params.maxSize > 0 && m_bytes + len > m_params.maxSize)
+    return true;
+
+  if (m_params.rotateHourly
+      && SCAST(qint64, floor(unixTime / 3600)) != m_hour)
+    return true;
+
+  return false;
+}
+
+void
+SegmentedLog::setParams(SegmentedLogParams const &params)
+{
+  m_params = params;
+}
+
+SegmentedLogParams const &
+SegmentedLog::params() const
+{
+  return m_params;
+}
+
+bool
+SegmentedLog::open(qreal unixTime)
+{
+  if (m_open)
+    return false;
+
+  m_segments = 0;
+
+  if (!openSegment(unixTime))
+    return false;
+
+  m_open = true;
+
+  return true;
+}
+
+bool
+SegmentedLog::write(const char *data, size_t len, qreal unixTime)
+{
+  qreal mjd;
+
+  if (!m_open)
+    return false;
+
+  if (needsRotation(len, unixTime)) {
+    closeSegment();
+    if (!openSegment(unixTime)) {
+      m_open = false;
+      return false;
+    }
+  }
+
+  mjd = unix2mjd(unixTime);
+
+  if (m_index.isOpen() && m_records % m_params.indexInterval == 0)
+    appendToIndex(mjd);
+
+  if (m_file.write(data, SCAST(qint64, len)) != SCAST(qint64, len)) {
+    m_lastError = m_file.fileName() + ": " + m_file.errorString();
+    return false;
+  }
+
+  if (m_records == 0)
+    m_firstMjd = mjd;
+
+  m_lastMjd = mjd;
+  m_bytes  += len;
+  ++m_records;
+
+  return true;
+}
+
+void
+SegmentedLog::flush()
+{
+  if (m_open)
+    m_file.flush();
+}
+
+void
+SegmentedLog::close()
+{
+  if (m_open) {
+    closeSegment();
+    m_open = false;
+  }
+}
+
+bool
+SegmentedLog::isOpen() const
+{
+  return m_open;
+}
+
+unsigned
+SegmentedLog::segmentCount() const
+{
+  return m_segments;
+}
+
+QString
+SegmentedLog::fileName() const
+{
+  return m_fileName;
+}
+
+QString
+SegmentedLog::filePath() const
+{
+  return m_file.fileName();
+}
+
+QString
+SegmentedLog::manifestPath() const
+{
+  return m_manifestPath;
+}
+
+QString
+SegmentedLog::lastError() const
+{
+  return m_lastError;
+}
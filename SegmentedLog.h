@@ -0,0 +1,104 @@
+//
+//    SegmentedLog.h: Log files split in rotated, compressed segments
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SEGMENTEDLOG_H
+#define SEGMENTEDLOG_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+namespace SigDigger {
+  struct SegmentedLogParams {
+    QString  directory;
+    QString  prefix        = "UNKNOWN";
+    QString  extension     = "log";
+    quint64  maxSize       = 0;     // Segment size limit in bytes (0: none)
+    bool     rotateHourly  = false; // Start a new segment every UTC hour
+    bool     compress      = false; // Gzip segments once they are closed
+    unsigned indexInterval = 0;     // Index one record out of N (0: none)
+    bool     binary        = false; // No newline translation
+    QByteArray header;              // Starts every segment, not a record
+  };
+
+  //
+  // A log made of one or more segment files. Segments are named after the
+  // prefix and the UTC time of their first record, exactly as single
+  // log files were named before. Every segment gets a line in a manifest
+  // file (named after the first segment) with its MJD range, so long
+  // archives can be scanned without opening every segment. The line is
+  // written when the segment is created, with compression "open", and
+  // completed in place when it is closed. After a crash, the last segment
+  // keeps its "open" line, which SegmentedLogReader takes as unbounded.
+  //
+  // If an index interval is set, every segment also gets a sparse
+  // <segment>.idx sidecar mapping the MJD of every Nth record to its byte
+  // offset in the (uncompressed) segment. Records must start with their
+  // MJD and be written in time order. See SegmentedLogReader.
+  //
+  class SegmentedLog
+  {
+    SegmentedLogParams m_params;
+
+    QFile    m_file;
+    QFile    m_index;
+    QString  m_fileName;
+    QString  m_manifestPath;
+    QString  m_lastError;
+    bool     m_open = false;
+    unsigned m_segments = 0;
+
+    // Current segment
+    quint64  m_bytes   = 0;
+    quint64  m_records = 0;
+    qreal    m_firstMjd = 0;
+    qreal    m_lastMjd  = 0;
+    qint64   m_hour     = 0;
+    qint64   m_lineStart = -1; // Manifest line offset, -1 if none
+    int      m_lineSize  = 0;
+
+    bool openSegment(qreal unixTime);
+    void closeSegment();
+    bool needsRotation(size_t len, qreal unixTime) const;
+    QByteArray manifestLine(const char *compression) const;
+    void beginManifestEntry();
+    qint64 finishManifestEntry();
+    void appendToIndex(qreal mjd);
+
+  public:
+    SegmentedLog();
+    ~SegmentedLog();
+
+    void setParams(SegmentedLogParams const &);
+    SegmentedLogParams const &params() const;
+
+    bool open(qreal unixTime);
+    bool write(const char *data, size_t len, qreal unixTime);
+    void flush();
+    void close();
+
+    bool isOpen() const;
+    unsigned segmentCount() const;
+    QString fileName() const;
+    QString filePath() const;
+    QString manifestPath() const;
+    QString lastError() const;
+  };
+}
+
+#endif // SEGMENTEDLOG_H
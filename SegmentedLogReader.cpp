@@ -0,0 +1,270 @@
+//
+//    SegmentedLogReader.cpp: Time range queries over segmented logs
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SegmentedLogReader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <sigutils/types.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define ADSN_READER_LINE_MAX 1024
+
+// The index and the manifest store MJDs with 7 decimals, computed before
+// the record is printed. Records may print theirs with fewer decimals
+// (e.g. 6 in drift logs), and rounding can move them past the indexed
+// value. We widen every lookup by a bit more than that rounding error.
+#define ADSN_READER_MJD_SLACK 1e-6
+
+using namespace SigDigger;
+
+//
+// Records start with their MJD, followed by a comma (CSV) or by
+// whitespace (STRF). Comments and malformed lines yield NaN.
+//
+static qreal
+parseMjd(const char *line, size_t len)
+{
+  size_t start = 0;
+  size_t end;
+  bool ok;
+  qreal mjd;
+
+  while (start < len && line[start] == ' ')
+    ++start;
+
+  if (start == len || line[start] == '#')
+    return NAN;
+
+  end = start;
+  while (end < len && strchr(", \t\r\n", line[end]) == nullptr)
+    ++end;
+
+  mjd = QByteArray::fromRawData(line + start, SCAST(int, end - start)).toDouble(&ok);
+
+  return ok ? mjd : NAN;
+}
+
+QString
+SegmentedLogReader::resolvePath(QString const &path)
+{
+  if (!QFile::exists(path) && QFile::exists(path + ".gz"))
+    return path + ".gz";
+
+  return path;
+}
+
+bool
+SegmentedLogReader::loadIndex(
+    QString const &path,
+    QVector<SegmentedLogIndexEntry> &index)
+{
+  QFile file(path + ".idx");
+  SegmentedLogIndexEntry entry;
+
+  index.clear();
+
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return false;
+
+  while (!file.atEnd()) {
+    QByteArray line = file.readLine();
+    QList<QByteArray> fields;
+    bool okMjd, okOff;
+
+    if (line.startsWith('#'))
+      continue;
+
+    fields = line.trimmed().split(',');
+    if (fields.size() != 2)
+      continue;
+
+    entry.mjd    = fields[0].toDouble(&okMjd);
+    entry.offset = fields[1].toULongLong(&okOff);
+
+    if (okMjd && okOff)
+      index.push_back(entry);
+  }
+
+  return true;
+}
+
+quint64
+SegmentedLogReader::lookupOffset(
+    QVector<SegmentedLogIndexEntry> const &index,
+    qreal mjd)
+{
+  // Last entry strictly before mjd: records with the same MJD as an
+  // indexed one may precede it. Index entries are more precise than the
+  // record they point to, so we leave some slack.
+  auto it = std::lower_bound(
+        index.begin(),
+        index.end(),
+        mjd - ADSN_READER_MJD_SLACK,
+        [] (SegmentedLogIndexEntry const &entry, qreal value) {
+          return entry.mjd < value;
+        });
+
+  if (it == index.begin())
+    return 0;
+
+  return (it - 1)->offset;
+}
+
+bool
+SegmentedLogReader::openManifest(QString const &path)
+{
+  QFile manifest(path);
+  QDir dir = QFileInfo(path).absoluteDir();
+
+  clear();
+
+  if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    m_lastError = path + ": " + manifest.errorString();
+    return false;
+  }
+
+  while (!manifest.atEnd()) {
+    QByteArray line = manifest.readLine();
+    QList<QByteArray> fields;
+    SegmentedLogSegment segment;
+
+    if (line.startsWith('#'))
+      continue;
+
+    fields = line.trimmed().split(',');
+    if (fields.size() < 5)
+      continue;
+
+    segment.path     = dir.filePath(QString::fromUtf8(fields[0]));
+    segment.firstMjd = fields[1].toDouble();
+    segment.lastMjd  = fields[2].toDouble();
+    segment.records  = fields[3].toULongLong();
+    segment.bytes    = fields[4].toULongLong();
+
+    // Still being written (or never closed): the end is unknown
+    if (fields.size() > 5 && fields[5] == "open")
+      segment.lastMjd = +INFINITY;
+
+    // A later line for the same segment supersedes the open one
+    if (!m_segments.isEmpty() && m_segments.last().path == segment.path)
+      m_segments.last() = segment;
+    else
+      m_segments.push_back(segment);
+  }
+
+  return true;
+}
+
+void
+SegmentedLogReader::addSegment(QString const &path)
+{
+  SegmentedLogSegment segment;
+
+  // Unknown range (e.g. the segment being written right now)
+  segment.path     = path;
+  segment.firstMjd = -INFINITY;
+  segment.lastMjd  = +INFINITY;
+
+  m_segments.push_back(segment);
+}
+
+void
+SegmentedLogReader::clear()
+{
+  m_segments.clear();
+}
+
+QVector<SegmentedLogSegment> const &
+SegmentedLogReader::segments() const
+{
+  return m_segments;
+}
+
+bool
+SegmentedLogReader::readSegment(
+    SegmentedLogSegment const &segment,
+    qreal from,
+    qreal to,
+    QByteArray &out)
+{
+  QVector<SegmentedLogIndexEntry> index;
+  QString path = resolvePath(segment.path);
+  QByteArray encoded = QFile::encodeName(path);
+  char line[ADSN_READER_LINE_MAX];
+  quint64 offset = 0;
+  gzFile fp;
+  qreal mjd;
+  size_t len;
+
+  if (loadIndex(segment.path, index))
+    offset = lookupOffset(index, from);
+
+  // gzopen reads uncompressed files transparently
+  if ((fp = gzopen(encoded.constData(), "rb")) == nullptr) {
+    m_lastError = path + ": cannot open segment";
+    return false;
+  }
+
+  if (offset > 0 && gzseek(fp, SCAST(z_off_t, offset), SEEK_SET) < 0) {
+    m_lastError = path + ": seek failed";
+    gzclose(fp);
+    return false;
+  }
+
+  while (gzgets(fp, line, sizeof(line)) != nullptr) {
+    len = strlen(line);
+    mjd = parseMjd(line, len);
+
+    if (std::isnan(mjd) || mjd < from)
+      continue;
+
+    if (mjd > to)
+      break;
+
+    out.append(line, SCAST(int, len));
+  }
+
+  gzclose(fp);
+
+  return true;
+}
+
+bool
+SegmentedLogReader::readRange(qreal from, qreal to, QByteArray &out)
+{
+  for (auto &segment : m_segments) {
+    if (segment.lastMjd < from - ADSN_READER_MJD_SLACK
+        || segment.firstMjd > to + ADSN_READER_MJD_SLACK)
+      continue;
+
+    if (!readSegment(segment, from, to, out))
+      return false;
+  }
+
+  return true;
+}
+
+QString
+SegmentedLogReader::lastError() const
+{
+  return m_lastError;
+}
@@ -0,0 +1,83 @@
+//
+//    SegmentedLogReader.h: Time range queries over segmented logs
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SEGMENTEDLOGREADER_H
+#define SEGMENTEDLOGREADER_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+namespace SigDigger {
+  struct SegmentedLogSegment {
+    QString path;           // Uncompressed segment path
+    qreal   firstMjd = 0;
+    qreal   lastMjd  = 0;
+    quint64 records  = 0;
+    quint64 bytes    = 0;
+  };
+
+  struct SegmentedLogIndexEntry {
+    qreal   mjd    = 0;
+    quint64 offset = 0;
+  };
+
+  //
+  // Reads back the records of a SegmentedLog that fall in a given MJD
+  // range. The manifest is used to skip segments outside the range, and
+  // the .idx sidecar of each segment to seek right before the first
+  // record of interest. Segments without index are read from the start,
+  // and gzipped segments are decompressed transparently (seeking in them
+  // is correct, but not free). Records are matched on the MJD they print.
+  //
+  // This is a library class only: the plugin builds no standalone tools,
+  // so range extraction from the command line is left to whatever links
+  // against it.
+  //
+  class SegmentedLogReader
+  {
+    QVector<SegmentedLogSegment> m_segments;
+    QString m_lastError;
+
+    static QString resolvePath(QString const &path);
+    bool readSegment(
+        SegmentedLogSegment const &,
+        qreal from,
+        qreal to,
+        QByteArray &out);
+
+  public:
+    bool openManifest(QString const &path);
+    void addSegment(QString const &path);
+    void clear();
+
+    QVector<SegmentedLogSegment> const &segments() const;
+
+    static bool loadIndex(
+        QString const &path,
+        QVector<SegmentedLogIndexEntry> &index);
+    static quint64 lookupOffset(
+        QVector<SegmentedLogIndexEntry> const &index,
+        qreal mjd);
+
+    bool readRange(qreal from, qreal to, QByteArray &out);
+    QString lastError() const;
+  };
+}
+
+#endif // SEGMENTEDLOGREADER_H
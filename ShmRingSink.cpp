@@ -0,0 +1,303 @@
+//
+//    ShmRingSink.cpp: Shared-memory ring sink
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "ShmRingSink.h"
+#include "DetachableProcess.h"
+#include <QCoreApplication>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#  include <sys/mman.h>
+#  include <sys/eventfd.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include "AmateurDSNRing.h"
+#endif
+
+#define SHM_RING_SINK_DEFAULT_SIZE (16 << 20)
+
+using namespace SigDigger;
+
+ShmRingSink::~ShmRingSink()
+{
+  close();
+}
+
+#ifdef __linux__
+void
+ShmRingSink::setInheritable(bool inheritable)
+{
+  int fds[] = {m_shmFd, m_eventFd};
+
+  for (auto fd : fds) {
+    int flags = fcntl(fd, F_GETFD);
+
+    if (flags == -1)
+      continue;
+
+    if (inheritable)
+      flags &= ~FD_CLOEXEC;
+    else
+      flags |= FD_CLOEXEC;
+
+    fcntl(fd, F_SETFD, flags);
+  }
+}
+
+bool
+ShmRingSink::open(ForwarderSinkParams const &params)
+{
+  long pageSize   = sysconf(_SC_PAGESIZE);
+  uint64_t offset = ADSN_RING_HEADER_SIZE;
+  uint64_t capacity = params.bufferSize;
+  adsn_ring_header *hdr;
+
+  close();
+  ForwarderSink::open(params);
+
+  if (pageSize <= 0)
+    pageSize = 4096;
+
+  if (offset < static_cast<uint64_t>(pageSize))
+    offset = static_cast<uint64_t>(pageSize);
+
+  if (capacity == 0)
+    capacity = SHM_RING_SINK_DEFAULT_SIZE;
+
+  // Both halves of the mirror must start at a page boundary
+  capacity = (capacity + pageSize - 1) / pageSize * pageSize;
+
+  m_shmFd = memfd_create("amateurdsn-ring", MFD_CLOEXEC);
+  if (m_shmFd == -1) {
+    m_lastError = QString("memfd_create failed: ") + strerror(errno);
+    goto fail;
+  }
+
+  if (ftruncate(m_shmFd, static_cast<off_t>(offset + capacity)) == -1) {
+    m_lastError = QString("Cannot size ring: ") + strerror(errno);
+    goto fail;
+  }
+
+  m_eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (m_eventFd == -1) {
+    m_lastError = QString("eventfd failed: ") + strerror(errno);
+    goto fail;
+  }
+
+  m_ring = new adsn_ring;
+  if (adsn_ring_map(m_ring, m_shmFd, offset, capacity) == -1) {
+    m_lastError = QString("Cannot map ring: ") + strerror(errno);
+    delete m_ring;
+    m_ring = nullptr;
+    goto fail;
+  }
+
+  m_ring->evfd = m_eventFd;
+  m_overflow   = params.overflow;
+  m_paused     = false;
+  m_capacity   = capacity;
+  m_writePos   = 0;
+
+  hdr = m_ring->hdr;
+  hdr->version     = ADSN_RING_VERSION;
+  hdr->data_offset = offset;
+  hdr->capacity    = capacity;
+  hdr->sample_size = params.sampleSize;
+  hdr->sample_rate = params.sampleRate;
+
+  // Readers check the magic last
+  __atomic_store_n(&hdr->magic, ADSN_RING_MAGIC, __ATOMIC_RELEASE);
+
+  return true;
+
+fail:
+  close();
+  return false;
+}
+
+void
+ShmRingSink::close()
+{
+  if (m_ring != nullptr) {
+    uint64_t one = 1;
+
+    // Let the reader know we are gone. It keeps its own mapping.
+    __atomic_fetch_or(&m_ring->hdr->flags, ADSN_RING_FLAG_EOS, __ATOMIC_SEQ_CST);
+    if (::write(m_eventFd, &one, sizeof(one)) < 0) {
+      // Counter saturated, the reader is awake anyway
+    }
+
+    adsn_ring_unmap(m_ring);
+    delete m_ring;
+    m_ring = nullptr;
+  }
+
+  if (m_eventFd != -1) {
+    ::close(m_eventFd);
+    m_eventFd = -1;
+  }
+
+  if (m_shmFd != -1) {
+    ::close(m_shmFd);
+    m_shmFd = -1;
+  }
+}
+
+// A consumer may store anything in read_pos. Whatever it says, we never
+// consider more than the whole ring unread, which is also what keeps the
+// copy below inside the mirror.
+uint64_t
+ShmRingSink::readPos() const
+{
+  uint64_t r = __atomic_load_n(&m_ring->hdr->read_pos, __ATOMIC_ACQUIRE);
+
+  if (m_writePos - r > m_capacity)
+    r = m_writePos - m_capacity;
+
+  return r;
+}
+
+bool
+ShmRingSink::write(const void *data, size_t size)
+{
+  adsn_ring_header *hdr;
+  uint64_t w, r;
+
+  if (m_ring == nullptr)
+    return false;
+
+  hdr = m_ring->hdr;
+  w   = m_writePos;
+  r   = readPos();
+
+  if (m_paused && 2 * (w - r) <= m_capacity)
+    m_paused = false;
+
+  if (m_paused || size > m_capacity - (w - r)) {
+    m_paused   = m_overflow == FORWARDER_OVERFLOW_PAUSE;
+    m_dropped += size;
+    __atomic_store_n(&hdr->dropped, m_dropped, __ATOMIC_RELAXED);
+    return false;
+  }
+
+  // Thanks to the mirror, the block is always contiguous
+  memcpy(m_ring->data + w % m_capacity, data, size);
+
+  // This store and the exchange below pair with the reader raising
+  // reader_waiting and then re-checking write_pos.
+  m_writePos = w + size;
+  __atomic_store_n(&hdr->write_pos, m_writePos, __ATOMIC_SEQ_CST);
+  m_written += size;
+
+  if (__atomic_exchange_n(&hdr->reader_waiting, 0, __ATOMIC_SEQ_CST)) {
+    uint64_t one = 1;
+    if (::write(m_eventFd, &one, sizeof(one)) < 0) {
+      // Counter saturated, the reader is awake anyway
+    }
+  }
+
+  return true;
+}
+
+QString
+ShmRingSink::expandArgument(QString const &arg) const
+{
+  QString result = arg;
+
+  result.replace("%SHMFD%", QString::number(m_shmFd));
+  result.replace("%EVENTFD%", QString::number(m_eventFd));
+  result.replace(
+        "%SHMPATH%",
+        "/proc/"
+        + QString::number(QCoreApplication::applicationPid())
+        + "/fd/"
+        + QString::number(m_shmFd));
+
+  return result;
+}
+
+// QProcess forks inside start(), so the descriptors only need to be
+// inheritable for that call.
+void
+ShmRingSink::aboutToLaunch(DetachableProcess &)
+{
+  setInheritable(true);
+}
+
+void
+ShmRingSink::launched(DetachableProcess &)
+{
+  setInheritable(false);
+}
+
+size_t
+ShmRingSink::pending() const
+{
+  if (m_ring == nullptr)
+    return 0;
+
+  return static_cast<size_t>(m_writePos - readPos());
+}
+
+#else
+void
+ShmRingSink::setInheritable(bool)
+{
+}
+
+bool
+ShmRingSink::open(ForwarderSinkParams const &)
+{
+  m_lastError = "Shared memory rings are only supported on Linux";
+  return false;
+}
+
+void
+ShmRingSink::close()
+{
+}
+
+bool
+ShmRingSink::write(const void *, size_t)
+{
+  return false;
+}
+
+QString
+ShmRingSink::expandArgument(QString const &arg) const
+{
+  return arg;
+}
+
+void
+ShmRingSink::aboutToLaunch(DetachableProcess &)
+{
+}
+
+void
+ShmRingSink::launched(DetachableProcess &)
+{
+}
+
+size_t
+ShmRingSink::pending() const
+{
+  return 0;
+}
+#endif
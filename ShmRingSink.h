@@ -0,0 +1,68 @@
+//
+//    ShmRingSink.h: Shared-memory ring sink
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SHMRINGSINK_H
+#define SHMRINGSINK_H
+
+#include "ForwarderSink.h"
+#include <cstdint>
+
+struct adsn_ring;
+
+namespace SigDigger {
+  //
+  // Single-producer, single-consumer ring in a memfd. Consumers map it
+  // and read the samples in place (see AmateurDSNRing.h). We never
+  // overwrite unread data: blocks that do not fit are dropped, so
+  // FORWARDER_OVERFLOW_DROP_OLDEST behaves as DROP_NEWEST here.
+  // The ring is a plain byte stream: framing does not apply, readers
+  // get the stream parameters from the ring header. A restarted
+  // consumer inherits the same ring and resumes where the last one left.
+  //
+  // The header is writable by the consumer, so we keep our own copy of
+  // what we wrote there and only read read_pos back, as a hint.
+  //
+  class ShmRingSink : public ForwarderSink
+  {
+    int        m_shmFd   = -1;
+    int        m_eventFd = -1;
+    adsn_ring *m_ring    = nullptr;
+    ForwarderOverflowPolicy m_overflow = FORWARDER_OVERFLOW_DROP_NEWEST;
+    bool       m_paused  = false;
+    uint64_t   m_capacity = 0;
+    uint64_t   m_writePos = 0;
+
+    void setInheritable(bool);
+    uint64_t readPos() const;
+
+  public:
+    ~ShmRingSink() override;
+
+    bool open(ForwarderSinkParams const &) override;
+    void close() override;
+    bool write(const void *data, size_t size) override;
+
+    QString expandArgument(QString const &) const override;
+    void aboutToLaunch(DetachableProcess &) override;
+    void launched(DetachableProcess &) override;
+
+    size_t pending() const override;
+  };
+}
+
+#endif // SHMRINGSINK_H
@@ -0,0 +1,268 @@
+//
+//    SigMFSidecar.cpp: SigMF metadata for forwarded streams
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SigMFSidecar.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QDateTime>
+#include <algorithm>
+
+// Metadata is rewritten at most every this many seconds of source time.
+// Saving commits (and syncs) a whole file from the GUI thread, and the
+// file is written again when closed anyway.
+#define SIGMF_SIDECAR_SAVE_INTERVAL 30.
+
+using namespace SigDigger;
+
+QString
+SigMFSidecar::datatype(SampleFormat format)
+{
+  // Integer samples are written in host order, which SigMF has no name
+  // for. Every platform we build on is little endian.
+  switch (format) {
+    case SAMPLE_FORMAT_CF32:
+      return "cf32_le";
+
+    case SAMPLE_FORMAT_CF64:
+      return "cf64_le";
+
+    case SAMPLE_FORMAT_CS16:
+      return "ci16_le";
+
+    case SAMPLE_FORMAT_CS8:
+      return "ci8";
+  }
+
+  return "cf32_le";
+}
+
+bool
+SigMFSidecar::open(
+    QString const &path,
+    SampleFormat format,
+    qreal sampleRate,
+    QString const &description)
+{
+  close();
+
+  m_path        = path;
+  m_datatype    = datatype(format);
+  m_description = description;
+  m_sampleRate  = sampleRate;
+  m_captures    = QJsonArray();
+  m_annotations = QJsonArray();
+  m_gaps.clear();
+  m_samples     = 0;
+  m_lost        = 0;
+  m_lastSave    = 0;
+  m_dirty       = false;
+  m_open        = true;
+
+  // Leave an empty description now, so a bad path fails early
+  if (!save()) {
+    m_open = false;
+    return false;
+  }
+
+  return true;
+}
+
+void
+SigMFSidecar::addCapture(ForwarderBlockInfo const &info)
+{
+  QJsonObject capture;
+
+  capture["core:sample_start"] = static_cast<qint64>(m_samples);
+  capture["core:frequency"]    = info.frequency;
+  capture["core:datetime"]     =
+      QDateTime::fromMSecsSinceEpoch(
+        static_cast<qint64>(info.timestamp * 1e3),
+        Qt::UTC).toString(Qt::ISODateWithMs);
+
+  m_captures.append(capture);
+  m_frequency = info.frequency;
+  m_dirty     = true;
+}
+
+void
+SigMFSidecar::append(
+    ForwarderBlockInfo const &info,
+    uint64_t count,
+    bool delivered)
+{
+  if (!m_open)
+    return;
+
+  if (!delivered) {
+    m_lost += count;
+    return;
+  }
+
+  if (m_lost > 0) {
+    QJsonObject annotation;
+
+    annotation["core:sample_start"] = static_cast<qint64>(m_samples);
+    annotation["core:sample_count"] = 0;
+    annotation["core:comment"]      =
+        QString::number(m_lost) + " samples dropped before this point";
+    m_annotations.append(annotation);
+  }
+
+  if (m_captures.isEmpty()
+      || m_lost > 0
+      || info.retune
+      || info.frequency != m_frequency)
+    addCapture(info);
+
+  m_lost     = 0;
+  m_samples += count;
+
+  if (m_dirty && info.timestamp - m_lastSave >= SIGMF_SIDECAR_SAVE_INTERVAL) {
+    m_lastSave = info.timestamp;
+    save();
+  }
+}
+
+void
+SigMFSidecar::discard(uint64_t at, uint64_t count)
+{
+  QJsonObject annotation;
+
+  if (!m_open || count == 0)
+    return;
+
+  m_gaps.push_back({at, count});
+
+  // Right after the gap, once translated
+  annotation["core:sample_start"] = static_cast<qint64>(at + count);
+  annotation["core:sample_count"] = 0;
+  annotation["core:comment"]      =
+      QString::number(count) + " samples dropped before this point";
+  m_annotations.append(annotation);
+  m_dirty = true;
+}
+
+// Entries are translated in order of their accepted index. Gaps come
+// in stream order too, as the sink trims the oldest blocks first.
+// Segments whose samples were all discarded collapse onto the next one,
+// which is the one that describes what follows.
+QJsonArray
+SigMFSidecar::translate(QJsonArray const &entries, bool collapse) const
+{
+  std::vector<std::pair<uint64_t, QJsonObject>> objects;
+  QJsonArray result;
+  uint64_t removed = 0;
+  qint64 last = -1;
+  size_t i = 0;
+
+  for (auto const &entry : entries) {
+    QJsonObject object = entry.toObject();
+    objects.emplace_back(
+          object["core:sample_start"].toVariant().toULongLong(),
+          object);
+  }
+
+  std::stable_sort(
+        objects.begin(),
+        objects.end(),
+        [] (std::pair<uint64_t, QJsonObject> const &a,
+            std::pair<uint64_t, QJsonObject> const &b) {
+          return a.first < b.first;
+        });
+
+  for (auto &entry : objects) {
+    uint64_t accepted = entry.first;
+    uint64_t inside   = 0;
+    qint64 start;
+
+    while (i < m_gaps.size() && m_gaps[i].at + m_gaps[i].count <= accepted)
+      removed += m_gaps[i++].count;
+
+    if (i < m_gaps.size() && m_gaps[i].at < accepted)
+      inside = accepted - m_gaps[i].at;
+
+    start = static_cast<qint64>(accepted - removed - inside);
+    entry.second["core:sample_start"] = start;
+
+    if (collapse && start == last)
+      result.removeLast();
+
+    result.append(entry.second);
+    last = start;
+  }
+
+  return result;
+}
+
+bool
+SigMFSidecar::save()
+{
+  QJsonObject global;
+  QJsonObject root;
+  QSaveFile file(m_path);
+  QByteArray json;
+
+  global["core:datatype"]     = m_datatype;
+  global["core:sample_rate"]  = m_sampleRate;
+  global["core:version"]      = "1.0.0";
+  global["core:num_channels"] = 1;
+  global["core:recorder"]     = "AmateurDSN";
+  if (!m_description.isEmpty())
+    global["core:description"] = m_description;
+
+  root["global"]      = global;
+  root["captures"]    = translate(m_captures, true);
+  root["annotations"] = translate(m_annotations, false);
+
+  json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+  // Readers never see a half-written file
+  if (!file.open(QIODevice::WriteOnly)
+      || file.write(json) != json.size()
+      || !file.commit()) {
+    m_lastError = "Cannot write " + m_path + ": " + file.errorString();
+    return false;
+  }
+
+  m_dirty = false;
+
+  return true;
+}
+
+void
+SigMFSidecar::close()
+{
+  if (m_open) {
+    if (m_dirty)
+      save();
+    m_open = false;
+  }
+}
+
+bool
+SigMFSidecar::isOpen() const
+{
+  return m_open;
+}
+
+QString
+SigMFSidecar::lastError() const
+{
+  return m_lastError;
+}
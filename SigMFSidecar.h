@@ -0,0 +1,85 @@
+//
+//    SigMFSidecar.h: SigMF metadata for forwarded streams
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SIGMFSIDECAR_H
+#define SIGMFSIDECAR_H
+
+#include <QString>
+#include <QJsonArray>
+#include <vector>
+#include "ForwarderSink.h"
+#include "SampleConverter.h"
+
+namespace SigDigger {
+  //
+  // Describes a forwarded stream in a SigMF .sigmf-meta file, so that a
+  // consumer writing the samples to disk leaves a self-describing
+  // recording. Sample indices refer to the samples that actually reached
+  // the consumer: every gap and every retune starts a new capture
+  // segment with the source time and frequency of its first sample.
+  //
+  // Samples are counted as they are accepted by the sink. Blocks the
+  // sink discards afterwards (drop-oldest) are reported by discard(),
+  // and every index is translated to what the consumer got when the
+  // file is saved. Those gaps are annotated but start no capture
+  // segment: the source time of the sample after them is gone with them.
+  //
+  class SigMFSidecar
+  {
+    struct Gap {
+      uint64_t at;    // Accepted samples before it
+      uint64_t count;
+    };
+
+    QString    m_path;
+    QString    m_lastError;
+    QString    m_datatype;
+    QString    m_description;
+    qreal      m_sampleRate = 0;
+    qreal      m_frequency  = 0;
+    QJsonArray m_captures;
+    QJsonArray m_annotations;
+    std::vector<Gap> m_gaps;
+    uint64_t   m_samples = 0; // Accepted so far
+    uint64_t   m_lost    = 0; // In the current gap
+    qreal      m_lastSave = 0;
+    bool       m_dirty   = false;
+    bool       m_open    = false;
+
+    void addCapture(ForwarderBlockInfo const &);
+    QJsonArray translate(QJsonArray const &, bool collapse) const;
+
+  public:
+    static QString datatype(SampleFormat);
+
+    bool open(
+        QString const &path,
+        SampleFormat,
+        qreal sampleRate,
+        QString const &description);
+    void append(ForwarderBlockInfo const &, uint64_t count, bool delivered);
+    void discard(uint64_t at, uint64_t count);
+    bool save();
+    void close();
+
+    bool isOpen() const;
+    QString lastError() const;
+  };
+}
+
+#endif // SIGMFSIDECAR_H
@@ -0,0 +1,343 @@
+//
+//    SocketSink.cpp: Socket sink for forwarded samples
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#include "SocketSink.h"
+#include "SampleWriter.h"
+#include "AmateurDSNFrame.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define SOCKET_SINK_DEFAULT_SIZE  (16 << 20)
+#define SOCKET_SINK_SNDBUF        (4 << 20)
+#define SOCKET_SINK_DATAGRAM_SIZE 32768 // Well below the loopback MTU
+#define SOCKET_SINK_CONNECT_MS    3000
+
+using namespace SigDigger;
+
+// We are called from the GUI thread: an unreachable host must not
+// freeze it for the whole SYN timeout of the kernel. Returns 0 or the
+// errno of the failure.
+static int
+connectWithin(int fd, const struct sockaddr *addr, socklen_t len, int ms)
+{
+  int flags = fcntl(fd, F_GETFL);
+  int error = 0;
+  socklen_t size = sizeof(error);
+  struct pollfd pfd;
+  int ret;
+
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+  if (::connect(fd, addr, len) == -1) {
+    if (errno != EINPROGRESS)
+      return errno;
+
+    pfd.fd     = fd;
+    pfd.events = POLLOUT;
+
+    do
+      ret = poll(&pfd, 1, ms);
+    while (ret == -1 && errno == EINTR);
+
+    if (ret == 0)
+      return ETIMEDOUT;
+
+    if (ret == -1)
+      return errno;
+
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size) == -1)
+      return errno;
+
+    if (error != 0)
+      return error;
+  }
+
+  fcntl(fd, F_SETFL, flags);
+
+  return 0;
+}
+
+SocketSink::SocketSink()
+{
+  m_writer = new SampleWriter();
+}
+
+SocketSink::~SocketSink()
+{
+  close();
+  delete m_writer;
+}
+
+bool
+SocketSink::connectTo(QString const &address)
+{
+  int sep = address.indexOf(':');
+  QString scheme = address.left(sep);
+  QString target = address.mid(sep + 1);
+  int error = 0;
+
+  if (sep < 1) {
+    m_lastError = "Invalid address " + address;
+    return false;
+  }
+
+  if (scheme == "unix") {
+    struct sockaddr_un sun;
+    QByteArray path = target.toLocal8Bit();
+
+    if (static_cast<size_t>(path.size()) >= sizeof(sun.sun_path)) {
+      m_lastError = "Socket path too long";
+      return false;
+    }
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    memcpy(sun.sun_path, path.constData(), static_cast<size_t>(path.size()));
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_fd == -1) {
+      m_lastError = "Cannot create socket: " + QString(strerror(errno));
+      return false;
+    }
+
+    error = connectWithin(
+          m_fd,
+          reinterpret_cast<struct sockaddr *>(&sun),
+          sizeof(sun),
+          SOCKET_SINK_CONNECT_MS);
+    if (error != 0) {
+      m_lastError = "Cannot connect to " + target + ": " + strerror(error);
+      return false;
+    }
+  } else if (scheme == "tcp" || scheme == "udp") {
+    struct addrinfo hints, *list = nullptr, *ai;
+    int colon = target.lastIndexOf(':');
+    QByteArray host, port;
+    int ret;
+
+    if (colon < 0) {
+      m_lastError = "No port in address " + address;
+      return false;
+    }
+
+    host = target.left(colon).remove('[').remove(']').toLocal8Bit();
+    port = target.mid(colon + 1).toLocal8Bit();
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = scheme == "tcp" ? SOCK_STREAM : SOCK_DGRAM;
+
+    ret = getaddrinfo(
+          host.isEmpty() ? "localhost" : host.constData(),
+          port.constData(),
+          &hints,
+          &list);
+    if (ret != 0) {
+      m_lastError = "Cannot resolve " + target + ": " + gai_strerror(ret);
+      return false;
+    }
+
+    for (ai = list; ai != nullptr; ai = ai->ai_next) {
+      m_fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (m_fd == -1)
+        continue;
+
+      error = connectWithin(
+            m_fd,
+            ai->ai_addr,
+            ai->ai_addrlen,
+            SOCKET_SINK_CONNECT_MS);
+      if (error == 0)
+        break;
+
+      ::close(m_fd);
+      m_fd = -1;
+    }
+
+    freeaddrinfo(list);
+
+    if (m_fd == -1) {
+      m_lastError = "Cannot connect to " + target + ": " + strerror(error);
+      return false;
+    }
+
+    m_datagram = scheme == "udp";
+  } else {
+    m_lastError = "Unknown socket type " + scheme;
+    return false;
+  }
+
+  return true;
+}
+
+bool
+SocketSink::open(ForwarderSinkParams const &params)
+{
+  int sndbuf = SOCKET_SINK_SNDBUF;
+
+  close();
+  ForwarderSink::open(params);
+
+  m_datagram = false;
+  m_address  = params.address;
+
+  if (!connectTo(params.address)) {
+    close();
+    return false;
+  }
+
+  setsockopt(m_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt(m_fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+  m_maxPayload = SOCKET_SINK_DATAGRAM_SIZE;
+  if (params.framed)
+    m_maxPayload -= sizeof(adsn_frame_header);
+  if (params.metadata)
+    m_maxPayload -= sizeof(adsn_frame_metadata);
+  m_maxPayload -= m_maxPayload % params.sampleSize;
+
+  m_writer->startWriting(
+        m_fd,
+        params.bufferSize > 0 ? params.bufferSize : SOCKET_SINK_DEFAULT_SIZE,
+        params.overflow,
+        m_datagram ? SAMPLE_WRITER_DATAGRAM : SAMPLE_WRITER_SOCKET);
+
+  return true;
+}
+
+void
+SocketSink::close()
+{
+  m_writer->stopWriting();
+
+  if (m_fd != -1) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+// One packet, skip samples into the current block. Its sequence number
+// is used even if the packet is dropped, so the consumer sees the gap.
+bool
+SocketSink::send(const void *data, size_t size, uint64_t skip)
+{
+  uint8_t hdr[FORWARDER_SINK_MAX_HEADER];
+  size_t hdrSize = makeHeader(hdr, size, skip);
+
+  if (hdrSize == 0)
+    return m_writer->push(data, size);
+
+  return m_writer->push(hdr, hdrSize, data, size);
+}
+
+bool
+SocketSink::write(const void *data, size_t size)
+{
+  const char *bytes = static_cast<const char *>(data);
+  uint64_t skip = 0;
+  bool ok = true;
+
+  if (m_fd == -1)
+    return false;
+
+  if (!m_datagram) {
+    ok = send(data, size, 0);
+  } else {
+    while (size > 0) {
+      size_t chunk = size < m_maxPayload ? size : m_maxPayload;
+
+      ok     = send(bytes, chunk, skip) && ok;
+      bytes += chunk;
+      size  -= chunk;
+      skip  += chunk / m_params.sampleSize;
+    }
+  }
+
+  // The consumer went away. The writer refuses (and counts) everything
+  // from now on, failed() tells the forwarder.
+  if (!ok && m_writer->broken())
+    m_lastError = QString("Connection lost: ") + strerror(m_writer->error());
+
+  return ok;
+}
+
+QString
+SocketSink::expandArgument(QString const &arg) const
+{
+  QString result = arg;
+
+  return result.replace("%ADDRESS%", m_address);
+}
+
+size_t
+SocketSink::pending() const
+{
+  return m_writer->pending();
+}
+
+uint64_t
+SocketSink::written() const
+{
+  return m_writer->written();
+}
+
+uint64_t
+SocketSink::dropped() const
+{
+  return m_writer->dropped();
+}
+
+bool
+SocketSink::failed() const
+{
+  return m_writer->broken();
+}
+
+uint64_t
+SocketSink::lost() const
+{
+  return m_writer->lost();
+}
+
+uint64_t
+SocketSink::discarded() const
+{
+  return m_writer->discarded();
+}
+
+uint64_t
+SocketSink::discardedAt() const
+{
+  return m_writer->discardedAt();
+}
+
+int64_t
+SocketSink::latency()
+{
+  return m_writer->latency();
+}
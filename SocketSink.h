@@ -0,0 +1,74 @@
+//
+//    SocketSink.h: Socket sink for forwarded samples
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+#ifndef SOCKETSINK_H
+#define SOCKETSINK_H
+
+#include "ForwarderSink.h"
+
+namespace SigDigger {
+  class SampleWriter;
+
+  //
+  // Streams samples to a consumer that is already listening, over a
+  // Unix domain socket (unix:PATH), TCP (tcp:HOST:PORT) or UDP
+  // (udp:HOST:PORT). Sends happen in a SampleWriter thread, which
+  // gathers several blocks per system call.
+  //
+  // With framing, every packet carries an adsn_frame_header (see
+  // AmateurDSNFrame.h) with a sequence number and, optionally, the
+  // stream metadata. UDP packets are cut to whole samples and sized for
+  // the loopback interface.
+  //
+  // Connecting gives up after a few seconds. Once the consumer closes a
+  // stream connection, the sink fails (see failed()) and every later
+  // block is counted as dropped.
+  //
+  class SocketSink : public ForwarderSink
+  {
+    SampleWriter *m_writer     = nullptr;
+    int           m_fd         = -1;
+    bool          m_datagram   = false;
+    size_t        m_maxPayload = 0;
+    QString       m_address;
+
+    bool connectTo(QString const &);
+    bool send(const void *data, size_t size, uint64_t skip);
+
+  public:
+    SocketSink();
+    ~SocketSink() override;
+
+    bool open(ForwarderSinkParams const &) override;
+    void close() override;
+    bool write(const void *data, size_t size) override;
+
+    QString expandArgument(QString const &) const override;
+
+    size_t   pending() const override;
+    uint64_t written() const override;
+    uint64_t dropped() const override;
+    bool     failed() const override;
+    uint64_t lost() const override;
+    uint64_t discarded() const override;
+    uint64_t discardedAt() const override;
+    int64_t  latency() override;
+  };
+}
+
+#endif // SOCKETSINK_H
@@ -0,0 +1,203 @@
+//
+//    FormatBench.cpp: Number formatting benchmark
+//    Copyright (C) 2023 Gonzalo José Carracedo Carballal
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as
+//    published by the Free Software Foundation, either version 3 of the
+//    License, or (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful, but
+//    WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public
+//    License along with this program.  If not, see
+//    <http://www.gnu.org/licenses/>
+//
+
+//
+// Compares the FormatBuffer formatters against the QString::asprintf and
+// QString::arg paths they replaced, on the values the drift and SNR tools
+// actually print. Every formatted string is also checked against the old
+// output, so a run doubles as a consistency test.
+//
+//   qmake bench/FormatBench.pro && make && ./FormatBench [count]
+//
+
+#include "AmateurDSNHelpers.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace SigDigger;
+
+#define FORMAT_BENCH_DEFAULT_COUNT 1000000
+
+struct Sample {
+  double mjd;
+  double freq;
+  double rel;
+  double db;
+};
+
+static volatile size_t g_sink;
+
+static void
+report(const char *name, qint64 oldNs, qint64 newNs, size_t count, size_t bad)
+{
+  printf(
+        "%-28s %8.1f ns %8.1f ns %6.1fx  %zu mismatches\n",
+        name,
+        SCAST(double, oldNs) / SCAST(double, count),
+        SCAST(double, newNs) / SCAST(double, count),
+        SCAST(double, oldNs) / SCAST(double, newNs > 0 ? newNs : 1),
+        bad);
+}
+
+template <typename OldFunc, typename NewFunc>
+static void
+compare(
+    const char *name,
+    QVector<Sample> const &samples,
+    OldFunc oldFormat,
+    NewFunc newFormat)
+{
+  QElapsedTimer timer;
+  qint64 oldNs, newNs;
+  size_t bad = 0;
+  size_t sum = 0;
+
+  timer.start();
+  for (auto &s : samples)
+    sum += SCAST(size_t, oldFormat(s).size());
+  oldNs = timer.nsecsElapsed();
+
+  timer.start();
+  for (auto &s : samples) {
+    FormatBuffer<128> buf;
+    newFormat(buf, s);
+    sum += buf.size();
+  }
+  newNs = timer.nsecsElapsed();
+
+  g_sink = sum;
+
+  for (auto &s : samples) {
+    FormatBuffer<128> buf;
+    newFormat(buf, s);
+    if (oldFormat(s) != QByteArray(buf.data(), SCAST(int, buf.size())))
+      ++bad;
+  }
+
+  report(name, oldNs, newNs, SCAST(size_t, samples.size()), bad);
+}
+
+int
+main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<double> mjd(59000, 61000);
+  std::uniform_real_distribution<double> freq(8.4e9, 8.5e9);
+  std::uniform_real_distribution<double> rel(-5e4, 5e4);
+  std::uniform_real_distribution<double> db(-40, 40);
+  QVector<Sample> samples;
+  int count = argc > 1 ? atoi(argv[1]) : FORMAT_BENCH_DEFAULT_COUNT;
+
+  if (count <= 0) {
+    fprintf(stderr, "%s: invalid sample count\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  samples.resize(count);
+  for (auto &s : samples) {
+    s.mjd  = mjd(rng);
+    s.freq = freq(rng);
+    s.rel  = rel(rng);
+    s.db   = db(rng);
+  }
+
+  printf("%d samples\n", count);
+  printf("%-28s %11s %11s %7s\n", "", "old", "new", "speedup");
+
+  compare(
+        "%.7f (MJD)",
+        samples,
+        [] (Sample const &s) {
+          return QString::asprintf("%.7lf", s.mjd).toUtf8();
+        },
+        [] (FormatBuffer<128> &buf, Sample const &s) {
+          buf.fixed(s.mjd, 7);
+        });
+
+  compare(
+        "arg(x, 0, 'f', 7) (MJD)",
+        samples,
+        [] (Sample const &s) {
+          return QString("%1").arg(s.mjd, 0, 'f', 7).toUtf8();
+        },
+        [] (FormatBuffer<128> &buf, Sample const &s) {
+          buf.fixed(s.mjd, 7);
+        });
+
+  compare(
+        "%.12e (frequency)",
+        samples,
+        [] (Sample const &s) {
+          return QString::asprintf("%.12le", s.freq).toUtf8();
+        },
+        [] (FormatBuffer<128> &buf, Sample const &s) {
+          buf.exponential(s.freq, 12);
+        });
+
+  compare(
+        "%+6.3f dB (label)",
+        samples,
+        [] (Sample const &s) {
+          return QString::asprintf("%+6.3f dB", s.db).toUtf8();
+        },
+        [] (FormatBuffer<128> &buf, Sample const &s) {
+          buf.fixed(s.db, 3, true, 6).put(" dB");
+        });
+
+  compare(
+        "CSV drift line",
+        samples,
+        [] (Sample const &s) {
+          return (QString::asprintf("%.7lf", s.mjd) + ","
+              + QString::asprintf("%.12le", s.freq) + ","
+              + QString::asprintf("%.12le", s.rel) + "\n").toUtf8();
+        },
+        [] (FormatBuffer<128> &buf, Sample const &s) {
+          buf
+              .fixed(s.mjd, 7).put(',')
+              .exponential(s.freq, 12).put(',')
+              .exponential(s.rel, 12).put('\n');
+        });
+
+  compare(
+        "STRF drift line",
+        samples,
+        [] (Sample const &s) {
+          return (QString::asprintf("%12.6lf", s.mjd) + "\t"
+              + QString::asprintf("%14.3lf", s.freq) + "\t"
+              + QString::asprintf("%8.3lf", 0.) + "\t"
+              + QString::asprintf("%04d", 1234) + "\n").toUtf8();
+        },
+        [] (FormatBuffer<128> &buf, Sample const &s) {
+          buf
+              .fixed(s.mjd, 6, false, 12).put('\t')
+              .fixed(s.freq, 3, false, 14).put('\t')
+              .fixed(0., 3, false, 8).put('\t')
+              .integer(1234, 4).put('\n');
+        });
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,22 @@
+# Standalone benchmark of the AmateurDSNHelpers number formatters. It is
+# not part of the plugin build: run qmake on this file explicitly.
+
+QT += core widgets gui
+
+TEMPLATE = app
+TARGET = FormatBench
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += sigutils
+
+SOURCES += \
+    ../AmateurDSNHelpers.cpp \
+    FormatBench.cpp
+
+HEADERS += \
+    ../AmateurDSNHelpers.h